@@ -99,10 +99,14 @@ const gui_objects = [
 	maek.CPP("src/gui/animate.cpp"),
 ];
 const geom_objects = [
+	maek.CPP("src/geometry/element_arena.cpp"),
 	maek.CPP("src/geometry/halfedge-utility.cpp"),
 	maek.CPP("src/geometry/halfedge-local.cpp"),
 	maek.CPP("src/geometry/halfedge-global.cpp"),
+	maek.CPP("src/geometry/compiled.cpp"),
+	maek.CPP("src/geometry/mesh_bvh.cpp"),
 	maek.CPP("src/geometry/indexed.cpp"),
+	maek.CPP("src/geometry/subdivision.cpp"),
 	maek.CPP("src/geometry/util.cpp"),
 	maek.CPP("src/geometry/spline.cpp"),
 ];
@@ -111,6 +115,7 @@ const rasterizer_objects = [
 	maek.CPP("src/rasterizer/rasterizer.cpp"),
 	maek.CPP("src/rasterizer/framebuffer.cpp"),
 	maek.CPP("src/rasterizer/sample_pattern.cpp"),
+	maek.CPP("src/rasterizer/benchmark.cpp"),
 ];
 const pathtracer_objects = [
 	maek.CPP("src/pathtracer/pathtracer.cpp"),
@@ -121,6 +126,8 @@ const pathtracer_objects = [
 ];
 const util_objects = [
 	maek.CPP("src/util/hdr_image.cpp"),
+	maek.CPP("src/util/image_writer.cpp"),
+	maek.CPP("src/util/ppm_writer.cpp"),
 	maek.CPP("src/util/viewer.cpp"),
 	maek.CPP("src/util/thread_pool.cpp"),
 	maek.CPP("src/util/rand.cpp"),
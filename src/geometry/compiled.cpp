@@ -0,0 +1,237 @@
+#include "compiled.h"
+#include "halfedge.h"
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+//prefix sums of counts -> begin offsets (with a final entry for the total):
+std::vector< uint32_t > offsets_of(std::vector< uint32_t > const &counts) {
+	std::vector< uint32_t > begin;
+	begin.reserve(counts.size() + 1);
+	uint32_t total = 0;
+	for (uint32_t c : counts) {
+		begin.emplace_back(total);
+		total += c;
+	}
+	begin.emplace_back(total);
+	return begin;
+}
+
+} //namespace
+
+Compiled_Mesh::Compiled_Mesh(Halfedge_Mesh const &mesh) {
+	constexpr uint32_t None = -1U;
+
+	auto invalid = [](std::string const &what) {
+		throw std::runtime_error("Compiled_Mesh: " + what + " (is the mesh valid?)");
+	};
+
+	//copy data, and links as element ids, in one pass over each list:
+	// (linked lists can't be split between threads, so this is the only serial walk over the mesh)
+	uint32_t V = uint32_t(mesh.vertices.size());
+	uint32_t E = uint32_t(mesh.edges.size());
+	uint32_t F = uint32_t(mesh.faces.size());
+	uint32_t H = uint32_t(mesh.halfedges.size());
+
+	std::vector< uint32_t > vertex_start; //vertex->halfedge (None for vertices without one)
+	x.reserve(V); y.reserve(V); z.reserve(V);
+	vertex_id.reserve(V);
+	vertex_start.reserve(V);
+	for (auto const &vertex : mesh.vertices) {
+		x.emplace_back(vertex.position.x);
+		y.emplace_back(vertex.position.y);
+		z.emplace_back(vertex.position.z);
+		vertex_id.emplace_back(vertex.id);
+		vertex_start.emplace_back(vertex.halfedge == mesh.halfedges.end() ? None : vertex.halfedge->id);
+	}
+
+	edge_halfedge.reserve(E);
+	edge_sharp.reserve(E);
+	edge_id.reserve(E);
+	for (auto const &edge : mesh.edges) {
+		edge_halfedge.emplace_back(edge.halfedge->id);
+		edge_sharp.emplace_back(edge.sharp ? 1 : 0);
+		edge_id.emplace_back(edge.id);
+	}
+
+	std::vector< uint32_t > face_start; //face->halfedge
+	face_boundary.reserve(F);
+	face_id.reserve(F);
+	face_start.reserve(F);
+	for (auto const &face : mesh.faces) {
+		face_boundary.emplace_back(face.boundary ? 1 : 0);
+		face_id.emplace_back(face.id);
+		face_start.emplace_back(face.halfedge->id);
+	}
+
+	halfedge_twin.reserve(H);
+	halfedge_next.reserve(H);
+	halfedge_vertex.reserve(H);
+	halfedge_edge.reserve(H);
+	halfedge_face.reserve(H);
+	halfedge_id.reserve(H);
+	corner_normal.reserve(H);
+	corner_uv.reserve(H);
+	for (auto const &halfedge : mesh.halfedges) {
+		halfedge_twin.emplace_back(halfedge.twin->id);
+		halfedge_next.emplace_back(halfedge.next->id);
+		halfedge_vertex.emplace_back(halfedge.vertex->id);
+		halfedge_edge.emplace_back(halfedge.edge->id);
+		halfedge_face.emplace_back(halfedge.face->id);
+		halfedge_id.emplace_back(halfedge.id);
+		corner_normal.emplace_back(halfedge.corner_normal);
+		corner_uv.emplace_back(halfedge.corner_uv);
+	}
+
+	//element id -> position in its list:
+	// (ids only grow as a mesh is edited, so very sparse ids get a hash table instead of an array)
+	uint32_t max_id = 0;
+	uint32_t count = V + E + F + H;
+	for (auto const *ids : {&vertex_id, &edge_id, &face_id, &halfedge_id}) {
+		for (uint32_t id : *ids) max_id = std::max(max_id, id);
+	}
+	bool dense = (max_id < 8u * uint64_t(count) + 1024u);
+	std::vector< uint32_t > position_of(dense ? max_id + 1 : 0, None);
+	std::unordered_map< uint32_t, uint32_t > sparse_position_of;
+	if (!dense) sparse_position_of.reserve(count);
+	for (auto const *ids : {&vertex_id, &edge_id, &face_id, &halfedge_id}) {
+		for (uint32_t position = 0; position < ids->size(); ++position) {
+			uint32_t id = (*ids)[position];
+			bool fresh = (dense ? std::exchange(position_of[id], position) == None : sparse_position_of.emplace(id, position).second);
+			if (!fresh) invalid("element id " + std::to_string(id) + " is used more than once");
+		}
+	}
+
+	//links from ids to positions:
+	// (a link to an element that isn't in the mesh -- e.g., one that was erased -- has an id no element has)
+	auto link = [&](uint32_t id) {
+		uint32_t position = None;
+		if (dense) {
+			if (id <= max_id) position = position_of[id];
+		} else {
+			auto found = sparse_position_of.find(id);
+			if (found != sparse_position_of.end()) position = found->second;
+		}
+		if (position == None) invalid("link to element id " + std::to_string(id) + ", which is not in the mesh");
+		return position;
+	};
+	Halfedge_Mesh::parallel_for(V, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t v = begin; v < end; ++v) {
+			if (vertex_start[v] != None) vertex_start[v] = link(vertex_start[v]);
+		}
+	});
+	Halfedge_Mesh::parallel_for(E, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t e = begin; e < end; ++e) {
+			edge_halfedge[e] = link(edge_halfedge[e]);
+		}
+	});
+	Halfedge_Mesh::parallel_for(F, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t f = begin; f < end; ++f) {
+			face_start[f] = link(face_start[f]);
+		}
+	});
+	Halfedge_Mesh::parallel_for(H, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t h = begin; h < end; ++h) {
+			halfedge_twin[h] = link(halfedge_twin[h]);
+			halfedge_next[h] = link(halfedge_next[h]);
+			halfedge_vertex[h] = link(halfedge_vertex[h]);
+			halfedge_edge[h] = link(halfedge_edge[h]);
+			halfedge_face[h] = link(halfedge_face[h]);
+		}
+	});
+
+	//neighborhoods: (in a valid mesh, a vertex's ring holds every halfedge leaving it, and a face's corners every halfedge on it)
+	std::vector< uint32_t > vertex_degree(V, 0);
+	std::vector< uint32_t > face_degree(F, 0);
+	for (uint32_t h = 0; h < H; ++h) {
+		vertex_degree[halfedge_vertex[h]] += 1;
+		face_degree[halfedge_face[h]] += 1;
+	}
+	ring_begin = offsets_of(vertex_degree);
+	face_begin = offsets_of(face_degree);
+
+	ring_halfedge.resize(H);
+	ring_vertex.resize(H);
+	Halfedge_Mesh::parallel_for(V, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t v = begin; v < end; ++v) {
+			//(vertices no face uses have no halfedge, and an empty ring)
+			if (ring_begin[v] == ring_begin[v + 1]) continue;
+			uint32_t start = vertex_start[v];
+			uint32_t at = ring_begin[v];
+			uint32_t h = start;
+			do {
+				if (at == ring_begin[v + 1]) invalid("vertex " + std::to_string(vertex_id[v]) + " has more ring halfedges than halfedges leaving it");
+				ring_halfedge[at] = h;
+				ring_vertex[at] = halfedge_vertex[halfedge_twin[h]];
+				++at;
+				h = halfedge_next[halfedge_twin[h]];
+			} while (h != start);
+			if (at != ring_begin[v + 1]) invalid("vertex " + std::to_string(vertex_id[v]) + " has fewer ring halfedges than halfedges leaving it");
+		}
+	});
+
+	face_halfedge.resize(H);
+	face_vertex.resize(H);
+	Halfedge_Mesh::parallel_for(F, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t f = begin; f < end; ++f) {
+			uint32_t start = face_start[f];
+			uint32_t at = face_begin[f];
+			uint32_t h = start;
+			do {
+				if (at == face_begin[f + 1]) invalid("face " + std::to_string(face_id[f]) + " has more corners than halfedges on it");
+				face_halfedge[at] = h;
+				face_vertex[at] = halfedge_vertex[h];
+				++at;
+				h = halfedge_next[h];
+			} while (h != start);
+			if (at != face_begin[f + 1]) invalid("face " + std::to_string(face_id[f]) + " has fewer corners than halfedges on it");
+		}
+	});
+}
+
+Vec3 Compiled_Mesh::face_normal(uint32_t f) const {
+	//(same sum, in the same order, as Face::normal())
+	Vec3 n;
+	for (uint32_t c = face_begin[f]; c < face_begin[f + 1]; ++c) {
+		uint32_t j = (c + 1 < face_begin[f + 1] ? c + 1 : face_begin[f]);
+		n += cross(position(face_vertex[c]), position(face_vertex[j]));
+	}
+	return n.unit();
+}
+
+std::vector< Vec3 > Compiled_Mesh::face_normals() const {
+	std::vector< Vec3 > normals(faces());
+	Halfedge_Mesh::parallel_for(faces(), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t f = begin; f < end; ++f) {
+			normals[f] = face_normal(f);
+		}
+	});
+	return normals;
+}
+
+void Compiled_Mesh::store_positions(Halfedge_Mesh &mesh) const {
+	if (mesh.vertices.size() != vertices()) {
+		throw std::runtime_error("Compiled_Mesh::store_positions: mesh has " + std::to_string(mesh.vertices.size()) + " vertices, compiled mesh has " + std::to_string(vertices()) + ".");
+	}
+	uint32_t v = 0;
+	for (auto &vertex : mesh.vertices) {
+		vertex.position = position(v);
+		++v;
+	}
+}
+
+void Compiled_Mesh::store_corner_data(Halfedge_Mesh &mesh) const {
+	if (mesh.halfedges.size() != halfedges()) {
+		throw std::runtime_error("Compiled_Mesh::store_corner_data: mesh has " + std::to_string(mesh.halfedges.size()) + " halfedges, compiled mesh has " + std::to_string(halfedges()) + ".");
+	}
+	uint32_t h = 0;
+	for (auto &halfedge : mesh.halfedges) {
+		halfedge.corner_normal = corner_normal[h];
+		halfedge.corner_uv = corner_uv[h];
+		++h;
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+/*
+ * A Compiled_Mesh is a read-only, array-based copy of a Halfedge_Mesh's
+ * connectivity and data. Elements are numbered by their position in the
+ * mesh's lists, links are stored as indices, and neighborhoods that analysis
+ * passes walk over and over (vertex one-rings, face corners) are laid out
+ * contiguously ("compressed sparse row" style).
+ *
+ * Building one is a single O(n) pass; after that, per-vertex or per-face
+ * passes are plain loops over arrays and can be split across threads freely.
+ * Results are written back to the mesh it was built from with the store_*()
+ * functions (which require the mesh's connectivity to be unchanged).
+ *
+ * Building one costs about twice a direct walk of the lists, so it is used by
+ * passes that visit neighborhoods: set_corner_normals, smooth_tangentially,
+ * and Indexed_Mesh's WeldCorners conversion.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "../lib/mathlib.h"
+
+class Halfedge_Mesh;
+
+class Compiled_Mesh {
+public:
+	Compiled_Mesh() = default;
+	explicit Compiled_Mesh(Halfedge_Mesh const &mesh);
+
+	uint32_t vertices() const { return uint32_t(x.size()); }
+	uint32_t edges() const { return uint32_t(edge_halfedge.size()); }
+	uint32_t faces() const { return uint32_t(face_boundary.size()); }
+	uint32_t halfedges() const { return uint32_t(halfedge_next.size()); }
+
+	//--- vertices (in mesh.vertices order) ---
+	std::vector< float > x, y, z; //positions
+	std::vector< uint32_t > vertex_id;
+
+	Vec3 position(uint32_t v) const { return Vec3(x[v], y[v], z[v]); }
+
+	//one-ring of vertex v is [ring_begin[v], ring_begin[v+1]) of: (empty for vertices no face uses)
+	// ring_halfedge: halfedges leaving v, in the order Vertex::normal() walks them (h, h->twin->next, ...)
+	// ring_vertex: the vertex each of those halfedges leads to
+	std::vector< uint32_t > ring_begin;
+	std::vector< uint32_t > ring_halfedge;
+	std::vector< uint32_t > ring_vertex;
+
+	//--- faces (in mesh.faces order, boundary faces included) ---
+	std::vector< uint8_t > face_boundary;
+	std::vector< uint32_t > face_id;
+
+	//corners of face f are [face_begin[f], face_begin[f+1]) of:
+	// face_halfedge: halfedges around the face, starting at face->halfedge
+	// face_vertex: the vertex each of those halfedges leaves
+	std::vector< uint32_t > face_begin;
+	std::vector< uint32_t > face_halfedge;
+	std::vector< uint32_t > face_vertex;
+
+	//--- edges (in mesh.edges order) ---
+	std::vector< uint32_t > edge_halfedge;
+	std::vector< uint8_t > edge_sharp;
+	std::vector< uint32_t > edge_id;
+
+	//--- halfedges (in mesh.halfedges order) ---
+	std::vector< uint32_t > halfedge_twin;
+	std::vector< uint32_t > halfedge_next;
+	std::vector< uint32_t > halfedge_vertex;
+	std::vector< uint32_t > halfedge_edge;
+	std::vector< uint32_t > halfedge_face;
+	std::vector< uint32_t > halfedge_id;
+	std::vector< Vec3 > corner_normal;
+	std::vector< Vec2 > corner_uv;
+
+	//--- analysis ---
+	//(matches Face::normal(), for one face or for every face)
+	Vec3 face_normal(uint32_t f) const;
+	std::vector< Vec3 > face_normals() const;
+
+	//--- writing results back ---
+	//(throw std::runtime_error if mesh's element counts differ from the compiled mesh's)
+	void store_positions(Halfedge_Mesh &mesh) const;
+	void store_corner_data(Halfedge_Mesh &mesh) const;
+};
@@ -0,0 +1,40 @@
+
+#include "element_arena.h"
+
+#include <algorithm>
+
+Element_Arena::~Element_Arena() {
+	for (void *chunk : chunks) {
+		::operator delete(chunk);
+	}
+}
+
+Element_Arena::Pool &Element_Arena::add_pool(size_t size) {
+	Pool p;
+	p.size = size;
+	//keep slots aligned for any element type (and large enough to hold a free-list link):
+	constexpr size_t align = alignof(std::max_align_t);
+	p.slot_size = (std::max(size, sizeof(Slot)) + align - 1) / align * align;
+	pools.emplace_back(p);
+	return pools.back();
+}
+
+void Element_Arena::grow(Pool &p) {
+	//(::operator new returns memory aligned for std::max_align_t)
+	char *chunk = static_cast< char * >(::operator new(p.slot_size * p.chunk_slots));
+	chunks.emplace_back(chunk);
+	std::pair< uintptr_t, uintptr_t > range(reinterpret_cast< uintptr_t >(chunk), reinterpret_cast< uintptr_t >(chunk + p.slot_size * p.chunk_slots));
+	chunk_ranges.insert(std::upper_bound(chunk_ranges.begin(), chunk_ranges.end(), range), range);
+	p.next = chunk;
+	p.end = chunk + p.slot_size * p.chunk_slots;
+	p.chunk_slots = std::min< size_t >(p.chunk_slots * 2, 65536);
+}
+
+bool Element_Arena::owns(void const *ptr) const {
+	uintptr_t address = reinterpret_cast< uintptr_t >(ptr);
+	//last chunk starting at or before address:
+	auto after = std::upper_bound(chunk_ranges.begin(), chunk_ranges.end(), address, [](uintptr_t a, std::pair< uintptr_t, uintptr_t > const &range) {
+		return a < range.first;
+	});
+	return after != chunk_ranges.begin() && address < std::prev(after)->second;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+/*
+ * Element_Arena hands out fixed-size slots carved from large chunks. Halfedge_Mesh uses one
+ * per mesh for the nodes of its element lists, so:
+ *  - elements created together sit next to each other in memory (and so do their neighbors,
+ *    for meshes built in one go), which keeps traversals cache-friendly;
+ *  - creating an element pops a free slot or bumps a pointer instead of calling malloc;
+ *  - erased slots are reused, and all memory is released at once with the last list using it.
+ *
+ * An arena is not thread-safe; it belongs to a single mesh.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class Element_Arena {
+public:
+	Element_Arena() = default;
+	~Element_Arena();
+
+	Element_Arena(Element_Arena const &) = delete;
+	Element_Arena &operator=(Element_Arena const &) = delete;
+
+	void *allocate(size_t size) {
+		Pool &p = pool(size);
+		if (p.free) {
+			Slot *slot = p.free;
+			p.free = slot->next;
+			return slot;
+		}
+		if (p.next == p.end) grow(p);
+		void *slot = p.next;
+		p.next += p.slot_size;
+		return slot;
+	}
+
+	void deallocate(void *ptr, size_t size) {
+		Pool &p = pool(size);
+		Slot *slot = static_cast< Slot * >(ptr);
+		slot->next = p.free;
+		p.free = slot;
+	}
+
+	//does ptr point into memory this arena handed out? (never reads *ptr, so it is safe on dangling
+	// pointers; used to check references before following them)
+	bool owns(void const *ptr) const;
+
+private:
+	struct Slot {
+		Slot *next;
+	};
+	struct Pool {
+		size_t size = 0; //requested size
+		size_t slot_size = 0; //(rounded up for alignment)
+		Slot *free = nullptr; //freed slots
+		char *next = nullptr, *end = nullptr; //unused part of the newest chunk
+		size_t chunk_slots = 256; //slots in the next chunk (grows geometrically)
+	};
+
+	//there is one pool per node type (so, only a handful):
+	Pool &pool(size_t size) {
+		for (Pool &p : pools) {
+			if (p.size == size) return p;
+		}
+		return add_pool(size);
+	}
+	Pool &add_pool(size_t size);
+	void grow(Pool &p);
+
+	std::vector< Pool > pools;
+	std::vector< void * > chunks;
+	//[begin, end) address of every chunk, sorted by begin:
+	std::vector< std::pair< uintptr_t, uintptr_t > > chunk_ranges;
+};
+
+//allocator for containers whose nodes live in an Element_Arena (or the heap, if arena is null):
+template< typename T >
+class Arena_Allocator {
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	Arena_Allocator() = default;
+	Arena_Allocator(std::shared_ptr< Element_Arena > arena_) : arena(std::move(arena_)) {
+	}
+	template< typename U >
+	Arena_Allocator(Arena_Allocator< U > const &other) : arena(other.arena) {
+	}
+
+	T *allocate(size_t n) {
+		if (arena && n == 1) return static_cast< T * >(arena->allocate(sizeof(T)));
+		return static_cast< T * >(::operator new(n * sizeof(T)));
+	}
+	void deallocate(T *ptr, size_t n) {
+		if (arena && n == 1) arena->deallocate(ptr, sizeof(T));
+		else ::operator delete(ptr);
+	}
+
+	std::shared_ptr< Element_Arena > arena;
+};
+
+template< typename T, typename U >
+bool operator==(Arena_Allocator< T > const &a, Arena_Allocator< U > const &b) {
+	return a.arena == b.arena;
+}
+template< typename T, typename U >
+bool operator!=(Arena_Allocator< T > const &a, Arena_Allocator< U > const &b) {
+	return a.arena != b.arena;
+}
@@ -1,5 +1,8 @@
 #include "halfedge.h"
+#include "compiled.h"
+#include "simplify.h"
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -185,6 +188,7 @@ void Halfedge_Mesh::isotropic_remesh(Isotropic_Remesh_Parameters const &params)
 	//     the total distance (so, smoothing_step of 1 would move all the way,
 	//     smoothing_step of 0 would not move).
 	// -> Repeat the tangential smoothing part params.smoothing_iterations times.
+	//     (smooth_tangentially(params.smoothing_step, params.smoothing_iterations, params.preserve_features) does this)
 
 	//NOTE: many of the steps in this function will be modifying the element
 	//      lists they are looping over. Take care to avoid use-after-free
@@ -219,27 +223,10 @@ bool operator<(const Edge_Record& r1, const Edge_Record& r2) {
 	return &*e1 < &*e2;
 }
 
-template<class T> struct MutablePriorityQueue {
-	void insert(const T& item) {
-		queue.insert(item);
-	}
-	void remove(const T& item) {
-		if (queue.find(item) != queue.end()) {
-			queue.erase(item);
-		}
-	}
-	const T& top() const {
-		return *(queue.begin());
-	}
-	void pop() {
-		queue.erase(queue.begin());
-	}
-	size_t size() {
-		return queue.size();
-	}
-
-	std::set<T> queue;
-};
+//(MutablePriorityQueue is in simplify.h; it files each Edge_Record under its edge's id:)
+inline uint32_t queue_index(const Edge_Record& r) {
+	return r.edge->id;
+}
 
 /*
  * simplify: reduce edge count through collapses
@@ -320,6 +307,46 @@ void Halfedge_Mesh::catmark_subdivide_helper(
 		}
 	}
 
+	//flatten into per-index arrays for the array version of the helper:
+	std::vector< Vec3 > vertex_array, edge_array, face_array;
+	vertex_array.reserve(vertices.size());
+	for (VertexCRef v = vertices.begin(); v != vertices.end(); ++v) {
+		vertex_array.emplace_back(vertex_positions.at(v));
+	}
+	edge_array.reserve(edges.size());
+	for (EdgeCRef e = edges.begin(); e != edges.end(); ++e) {
+		edge_array.emplace_back(edge_vertex_positions.at(e));
+	}
+	face_array.reserve(faces.size());
+	for (FaceCRef f = faces.begin(); f != faces.end(); ++f) {
+		face_array.emplace_back(f->boundary ? Vec3{} : face_vertex_positions.at(f));
+	}
+
+	catmark_subdivide_helper(vertex_array, edge_array, face_array);
+}
+
+/*
+ * catmark_subdivide_helper (array version): as above, but with positions
+ *   stored by list index instead of in maps.
+ *
+ * Works on all valid meshes.
+ */
+void Halfedge_Mesh::catmark_subdivide_helper(
+	std::vector< Vec3 > const &vertex_positions, //[i] is position for i-th vertex after subdivision
+	std::vector< Vec3 > const &edge_vertex_positions, //[i] is position for new vertex added in i-th edge
+	std::vector< Vec3 > const &face_vertex_positions //[i] is position for new vertex added in i-th face (ignored if boundary)
+	) {
+
+	//check that a position was supplied for every element:
+	if (vertex_positions.size() != vertices.size()) {
+		throw std::runtime_error("Supplied " + std::to_string(vertex_positions.size()) + " vertex positions for " + std::to_string(vertices.size()) + " vertices.");
+	}
+	if (edge_vertex_positions.size() != edges.size()) {
+		throw std::runtime_error("Supplied " + std::to_string(edge_vertex_positions.size()) + " edge vertex positions for " + std::to_string(edges.size()) + " edges.");
+	}
+	if (face_vertex_positions.size() != faces.size()) {
+		throw std::runtime_error("Supplied " + std::to_string(face_vertex_positions.size()) + " face vertex positions for " + std::to_string(faces.size()) + " faces.");
+	}
 
 	{ //check that mesh is in a valid state to start with:
 		auto error = validate();
@@ -334,13 +361,11 @@ void Halfedge_Mesh::catmark_subdivide_helper(
 		return;
 	}
 
-	//store the old last vertex, face, and edge to allow iterating over only the old elements later:
+	//store the old element counts to allow iterating over only the old elements later:
 	//(this works because the emplace_* functions add to the end of the element lists)
-	VertexRef last_old_vertex = std::prev(vertices.end());
-	EdgeRef last_old_edge = std::prev(edges.end());
-	FaceRef last_old_face = std::prev(faces.end());
-	
-	//(can't store .end() iterators because emplace_back puts things "before the end")
+	size_t old_vertices = vertices.size();
+	size_t old_edges = edges.size();
+	size_t old_faces = faces.size();
 
 	//------------------------
 	//split every edge:
@@ -356,7 +381,8 @@ void Halfedge_Mesh::catmark_subdivide_helper(
 	//  v1 --e-- vm --e2-- v2
 	//     <-t2-    <--t--
 
-	for (EdgeRef e = edges.begin(); e != std::next(last_old_edge); ++e) {
+	size_t edge_index = 0;
+	for (EdgeRef e = edges.begin(); edge_index < old_edges; ++e, ++edge_index) {
 		HalfedgeRef h = e->halfedge;
 		HalfedgeRef t = h->twin; assert(t->edge == e);
 		VertexRef v1 = h->vertex;
@@ -370,7 +396,7 @@ void Halfedge_Mesh::catmark_subdivide_helper(
 
 		//middle vertex:
 		vm->halfedge = h2; //could also use t2
-		vm->position = edge_vertex_positions.at(e);
+		vm->position = edge_vertex_positions[edge_index];
 		interpolate_data({v1, v2}, vm);
 
 		//second edge:
@@ -431,11 +457,18 @@ void Halfedge_Mesh::catmark_subdivide_helper(
 	// (each new eN has new halfedges as you'd expect,
 	//  with eN->halfedge being directed toward the central vertex.)
 
-	for (FaceRef f = faces.begin(); f != std::next(last_old_face); ++f) {
+	//(scratch space reused across faces)
+	std::vector< HalfedgeRef > face_halfedges;
+	std::vector< HalfedgeCRef > from_corners;
+	std::vector< VertexCRef > from_vertices;
+	std::vector< EdgeRef > inner_edges;
+
+	size_t face_index = 0;
+	for (FaceRef f = faces.begin(); face_index < old_faces; ++f, ++face_index) {
 		if (f->boundary) continue; //skip boundary faces
 
 		//get face halfedges:
-		std::vector< HalfedgeRef > face_halfedges;
+		face_halfedges.clear();
 		{
 			HalfedgeRef h = f->halfedge;
 			do {
@@ -447,8 +480,8 @@ void Halfedge_Mesh::catmark_subdivide_helper(
 
 		//get face vertices and corners to interpolate data from:
 		// (skip the odd vertices/halfedges -- they were just added)
-		std::vector< HalfedgeCRef > from_corners;
-		std::vector< VertexCRef > from_vertices;
+		from_corners.clear();
+		from_vertices.clear();
 		for (uint32_t i = 0; i < face_halfedges.size(); i += 2) {
 			from_corners.emplace_back(face_halfedges[i]);
 			from_vertices.emplace_back(face_halfedges[i]->vertex);
@@ -456,11 +489,11 @@ void Halfedge_Mesh::catmark_subdivide_helper(
 
 		//add central vertex:
 		VertexRef vm = emplace_vertex();
-		vm->position = face_vertex_positions.at(f);
+		vm->position = face_vertex_positions[face_index];
 		interpolate_data(from_vertices, vm);
 
 		//add halfedges and edges around the central vertex:
-		std::vector< EdgeRef > inner_edges;
+		inner_edges.clear();
 		for (uint32_t i = 0; i + 1 < face_halfedges.size(); i += 2) {
 			EdgeRef e = emplace_edge(false);
 			HalfedgeRef c = emplace_halfedge();
@@ -526,8 +559,9 @@ void Halfedge_Mesh::catmark_subdivide_helper(
 
 	//--------------------------
 	//update positions for vertices
-	for (VertexRef v = vertices.begin(); v != std::next(last_old_vertex); ++v) {
-		v->position = vertex_positions.at(v);
+	size_t vertex_index = 0;
+	for (VertexRef v = vertices.begin(); vertex_index < old_vertices; ++v, ++vertex_index) {
+		v->position = vertex_positions[vertex_index];
 	}
 
 	{ //PARANOIA: sanity check:
@@ -539,6 +573,82 @@ void Halfedge_Mesh::catmark_subdivide_helper(
 	}
 }
 
+/*
+ * smooth_tangentially: move vertices toward their neighborhood centers, in their tangent planes
+ *
+ * Works on all valid meshes.
+ */
+void Halfedge_Mesh::smooth_tangentially(float step, uint32_t iterations, bool preserve_features) {
+	if (iterations == 0 || vertices.empty()) return;
+
+	//index-based copy of the connectivity; one-rings are in the order Vertex::normal() walks them:
+	Compiled_Mesh compiled(*this);
+	uint32_t count = compiled.vertices();
+	std::vector< uint32_t > const &ring_begin = compiled.ring_begin;
+	std::vector< uint32_t > const &ring = compiled.ring_vertex;
+
+	//ring_face[ring_begin[i] + k] says whether the face between neighbors k and k+1 is a real (non-boundary) face:
+	std::vector< uint8_t > ring_face(ring.size());
+	std::vector< uint8_t > fixed(count, 0);
+	parallel_for(count, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			for (uint32_t r = ring_begin[i]; r < ring_begin[i+1]; ++r) {
+				uint32_t h = compiled.ring_halfedge[r];
+				uint32_t t = compiled.halfedge_twin[h];
+				bool boundary = compiled.face_boundary[compiled.halfedge_face[h]] || compiled.face_boundary[compiled.halfedge_face[t]];
+				if (preserve_features && (compiled.edge_sharp[compiled.halfedge_edge[h]] || boundary)) fixed[i] = 1;
+				ring_face[r] = compiled.face_boundary[compiled.halfedge_face[t]] ? 0 : 1;
+			}
+		}
+	});
+
+	std::vector< Vec3 > positions(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		positions[i] = compiled.position(i);
+	}
+	std::vector< Vec3 > next_positions(count);
+
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		parallel_for(count, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i) {
+				Vec3 p = positions[i];
+				uint32_t r_begin = ring_begin[i], r_end = ring_begin[i+1];
+				if (fixed[i] || r_begin == r_end) {
+					next_positions[i] = p;
+					continue;
+				}
+				Vec3 center = Vec3(0.0f, 0.0f, 0.0f);
+				Vec3 normal = Vec3(0.0f, 0.0f, 0.0f);
+				for (uint32_t r = r_begin; r < r_end; ++r) {
+					Vec3 pk = positions[ring[r]];
+					center += pk;
+					if (ring_face[r]) {
+						Vec3 pj = positions[ring[r + 1 < r_end ? r + 1 : r_begin]];
+						normal += cross(pj - p, pk - p);
+					}
+				}
+				center /= float(r_end - r_begin);
+
+				//remove the normal component of the move:
+				Vec3 move = center - p;
+				if (normal != Vec3(0.0f, 0.0f, 0.0f)) {
+					normal = normal.unit();
+					move -= dot(move, normal) * normal;
+				}
+				next_positions[i] = p + step * move;
+			}
+		});
+		std::swap(positions, next_positions);
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		compiled.x[i] = positions[i].x;
+		compiled.y[i] = positions[i].y;
+		compiled.z[i] = positions[i].z;
+	}
+	compiled.store_positions(*this);
+}
+
 /*
  * flip_orientation: flip direction of all halfedges
  *
@@ -594,185 +704,165 @@ void Halfedge_Mesh::flip_orientation() {
  * works on all valid meshes.
  */
 void Halfedge_Mesh::set_corner_normals(float threshold) {
-	//first, figure out which edges to consider sharp for this operation:
-	std::unordered_set< Edge const * > sharp_edges;
-	sharp_edges.reserve(edges.size());
+	//index-based copy of the mesh, so vertices can be handled independently:
+	Compiled_Mesh compiled(*this);
 
-	//all edges between boundary and non-boundary get marked sharp regardless of mode:
-	for (auto const &edge : edges) {
-		if (edge.halfedge->face->boundary != edge.halfedge->twin->face->boundary) {
-			sharp_edges.emplace(&edge);
-		}
-	}
+	//face normals are needed by every corner of the face, so compute them once:
+	std::vector< Vec3 > face_normals = compiled.face_normals();
 
-	if (threshold >= 180.0f) {
-		//"smooth mode" -- all other edges are considered smooth
-	} else {
-		//"flat mode" / "auto mode" -- any edges which are marked sharp or have face angle <= threshold get marked sharp:
-		float cos_threshold = std::cos( Radians( std::clamp(threshold, 0.0f, 180.0f) ) );
-		if (threshold <= 0.0f) cos_threshold = 2.0f; //make sure everything is sharp
-		for (auto const &edge : edges) {
+	//first, figure out which edges to consider sharp for this operation:
+	std::vector< uint8_t > sharp_edges(compiled.edges(), 0);
+
+	float cos_threshold = std::cos( Radians( std::clamp(threshold, 0.0f, 180.0f) ) );
+	if (threshold <= 0.0f) cos_threshold = 2.0f; //make sure everything is sharp
+	parallel_for(compiled.edges(), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t e = begin; e < end; ++e) {
 			//get adjacent halfedges:
-			HalfedgeRef h1 = edge.halfedge;
-			HalfedgeRef h2 = h1->twin;
-			if (h1->face->boundary || h2->face->boundary) {
-				//don't care about edges boundary-boundary, and inside-boundary already marked.
-				//thus: nothing to do here
-			} else if (edge.sharp) {
+			uint32_t h1 = compiled.edge_halfedge[e];
+			uint32_t h2 = compiled.halfedge_twin[h1];
+			uint32_t f1 = compiled.halfedge_face[h1];
+			uint32_t f2 = compiled.halfedge_face[h2];
+			if (compiled.face_boundary[f1] != compiled.face_boundary[f2]) {
+				//all edges between boundary and non-boundary get marked sharp regardless of mode:
+				sharp_edges[e] = 1;
+			} else if (threshold >= 180.0f) {
+				//"smooth mode" -- all other edges are considered smooth
+			} else if (compiled.face_boundary[f1]) {
+				//"flat mode" / "auto mode" -- don't care about edges boundary-boundary
+			} else if (compiled.edge_sharp[e]) {
 				//flagged as sharp, so mark it sharp:
-				sharp_edges.emplace(&edge);
+				sharp_edges[e] = 1;
 			} else {
 				//inside-inside edge, non-marked, check angle:
-				Vec3 n1 = h1->face->normal();
-				Vec3 n2 = h2->face->normal();
-				float cos = dot(n1,n2);
+				float cos = dot(face_normals[f1], face_normals[f2]);
 				if (cos <= cos_threshold) {
 					//treat as sharp:
-					sharp_edges.emplace(&edge);
+					sharp_edges[e] = 1;
 				}
 			}
 		}
-	}
-
-	//clear current corner normals:
-	for (auto h = halfedges.begin(); h != halfedges.end(); ++h) {
-		h->corner_normal = Vec3{0.0f, 0.0f, 0.0f};
-	}
+	});
 
 	//now circulate all vertices to set normals:
-	for (auto const &v : vertices) {
-		//get halfedge leaving this vertex:
-		HalfedgeRef begin = v.halfedge;
-		assert(&*begin->vertex == &v);
-
-		//circulate begin until it is at a sharp edge (thus, the next corner starts a smoothing group):
-		do {
-			if (sharp_edges.count(&*begin->edge)) break;
-			begin = begin->twin->next;
-		} while (begin != v.halfedge); //could be all one big happy smoothing group
-
-		//store all corners around the vertex:
-		struct Corner {
-			HalfedgeRef in; //halfedge pointing to v
-			HalfedgeRef out; //halfedge pointing away from v
-			Vec3 weighted_normal; //face normal at corner, weighted... somehow (see below)
-		};
-
-		std::vector< std::vector< Corner > > groups;
-		HalfedgeRef h = begin;
-		do {
-			//start a new smoothing group on sharp edges (or at the very first edge):
-			if (h == begin || sharp_edges.count(&*h->edge)) {
-				groups.emplace_back();
+	// (each vertex only writes the corners of the halfedges leaving it, so vertices can run in parallel)
+	parallel_for(compiled.vertices(), [&](uint32_t begin, uint32_t end) {
+		std::vector< Vec3 > weighted_normals;
+		for (uint32_t v = begin; v < end; ++v) {
+			uint32_t ring_begin = compiled.ring_begin[v];
+			uint32_t degree = compiled.ring_begin[v + 1] - ring_begin;
+			if (degree == 0) continue;
+			auto ring_halfedge = [&](uint32_t k) { return compiled.ring_halfedge[ring_begin + k % degree]; };
+			auto ring_vertex = [&](uint32_t k) { return compiled.ring_vertex[ring_begin + k % degree]; };
+			Vec3 p = compiled.position(v);
+
+			//clear current corner normals:
+			for (uint32_t k = 0; k < degree; ++k) {
+				compiled.corner_normal[ring_halfedge(k)] = Vec3{0.0f, 0.0f, 0.0f};
 			}
-			//add corner after h to current smoothing group:
-			Corner corner;
-			corner.in = h->twin;
-			corner.out = h->twin->next;
-			assert(corner.in->face == corner.out->face); //PARANOIA
-			{ //compute some sort of weighted normal:
-				assert(&*corner.in->vertex != &v);
-				assert(&*corner.in->twin->vertex == &v);
-				Vec3 from = corner.in->vertex->position - v.position;
-
-				assert(&*corner.out->vertex == &v);
-				assert(&*corner.out->twin->vertex != &v);
-				Vec3 to = corner.out->twin->vertex->position - v.position;
-				/*
-				//basic area weighting (weird with non-flat faces and reflex vertices):
-				corner.weighted_normal = cross(to - v.position, from - v.position);
-				*/
-				/*//sort sort of angle weighting thing -- this never works as well as one would hope:
-				//...still needs work for reflex angles also
-				float angle = std::atan2(cross(from,to).norm(), dot(from, to));
-				corner.weighted_normal = angle * corner.in->face->normal();
-				*/
+
+			//circulate until at a sharp edge (thus, the next corner starts a smoothing group):
+			uint32_t start = 0;
+			while (start < degree && !sharp_edges[compiled.halfedge_edge[ring_halfedge(start)]]) ++start;
+			if (start == degree) start = 0; //could be all one big happy smoothing group
+
+			//corner k sits between ring halfedges k and k+1, in the face of ring halfedge k's twin:
+			weighted_normals.resize(degree);
+			for (uint32_t k = 0; k < degree; ++k) {
+				Vec3 from = compiled.position(ring_vertex(k)) - p;
+				Vec3 to = compiled.position(ring_vertex(k + 1)) - p;
+				uint32_t face = compiled.halfedge_face[compiled.halfedge_twin[ring_halfedge(k)]];
 				//some other sort of slightly fancy area weighting:
-				corner.weighted_normal = cross(to - v.position, from - v.position).norm() * corner.in->face->normal();
+				weighted_normals[k] = cross(to - p, from - p).norm() * face_normals[face];
 			}
-			groups.back().emplace_back(corner);
-
-			//advance h:
-			h = h->twin->next;
-		} while (h != begin);
-
-		//compute weighted normals per-corner:
-		for (auto const &group : groups) {
-			assert(!group.empty());
-			if (group[0].in->face->boundary) {
-				//boundary group.
-				//PARANOIA:
-				for (auto const &corner : group) {
-					assert(corner.in->face->boundary);
+
+			//smoothing groups are runs of corners between sharp edges; compute weighted normals per-group:
+			uint32_t group_begin = start;
+			while (group_begin < start + degree) {
+				uint32_t group_end = group_begin + 1;
+				while (group_end < start + degree && !sharp_edges[compiled.halfedge_edge[ring_halfedge(group_end)]]) ++group_end;
+
+				//no need for normals on boundary corners:
+				if (!compiled.face_boundary[compiled.halfedge_face[compiled.halfedge_twin[ring_halfedge(group_begin)]]]) {
+					Vec3 sum = Vec3{0.0f, 0.0f, 0.0f};
+					for (uint32_t k = group_begin; k < group_end; ++k) {
+						sum += weighted_normals[k % degree];
+					}
+					//normalize:
+					sum = sum.unit();
+					//assign to all corners in group (i.e., to the halfedge leaving v after each corner):
+					for (uint32_t k = group_begin; k < group_end; ++k) {
+						compiled.corner_normal[ring_halfedge(k + 1)] = sum;
+					}
 				}
-				//no need for normals on boundary corners
-				continue;
-			}
-			//compute weighted normal:
-			Vec3 sum = Vec3{0.0f, 0.0f, 0.0f};
-			for (auto const &corner : group) {
-				sum += corner.weighted_normal;
-			}
-			//normalize:
-			sum = sum.unit();
-			//assign to all corners in group:
-			for (auto const &corner : group) {
-				assert(&*corner.out->vertex == &v);
-				corner.out->corner_normal = sum;
+				group_begin = group_end;
 			}
 		}
-	}
+	});
 
 	//normals computed!
+	compiled.store_corner_data(*this);
 }
 
 /*
  * set_corner_uvs_per_face: set uv coordinates to map texture per-face
  */
 void Halfedge_Mesh::set_corner_uvs_per_face() {
-	//clear existing UVs:
-	for (auto &halfedge : halfedges) {
-		halfedge.corner_uv = Vec2(0.0f, 0.0f);
+	//faces only write their own corners, so they can be handled in parallel:
+	std::vector< FaceRef > face_refs;
+	face_refs.reserve(faces.size());
+	for (FaceRef f = faces.begin(); f != faces.end(); ++f) {
+		face_refs.emplace_back(f);
 	}
-	
-	//set UVs per-face:
-	for (auto const &face : faces) {
-		if (face.boundary) continue;
-
-		//come up with a plane perpendicular-ish to the face:
-		Vec3 n = face.normal();
-		Vec3 p1;
-		if (std::abs(n.x) < std::abs(n.y) && std::abs(n.x) < std::abs(n.z)) {
-			p1 = Vec3(1.0f, 0.0f, 0.0f);
-		} else if (std::abs(n.y) < std::abs(n.z)) {
-			p1 = Vec3(0.0f, 1.0f, 0.0f);
-		} else {
-			p1 = Vec3(0.0f, 0.0f, 1.0f);
-		}
-		p1 = (p1 - dot(p1, n) * n).unit();
-		Vec3 p2 = cross(n, p1);
 
-		//find bounds of face on plane:
-		Vec2 min = Vec2(std::numeric_limits< float >::infinity(), std::numeric_limits< float >::infinity());
-		Vec2 max = Vec2(-std::numeric_limits< float >::infinity(), -std::numeric_limits< float >::infinity());
-		HalfedgeRef v = face.halfedge;
-		do {
-			Vec2 pt = Vec2(dot(p1, v->vertex->position), dot(p2, v->vertex->position));
-			min = hmin(min, pt);
-			max = hmax(max, pt);
-			v = v->next;
-		} while (v != face.halfedge);
+	parallel_for(uint32_t(face_refs.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Face const &face = *face_refs[i];
+
+			//clear existing UVs:
+			if (face.boundary) {
+				HalfedgeRef h = face.halfedge;
+				do {
+					h->corner_uv = Vec2(0.0f, 0.0f);
+					h = h->next;
+				} while (h != face.halfedge);
+				continue;
+			}
 
-		//set corner uvs based on position within bounds:
-		do {
-			Vec2 pt = Vec2(dot(p1, v->vertex->position), dot(p2, v->vertex->position));
-			v->corner_uv = Vec2(
-				(pt.x - min.x) / (max.x - min.x),
-				(pt.y - min.y) / (max.y - min.y)
-			);
-			v = v->next;
-		} while (v != face.halfedge);
-	}
+			//come up with a plane perpendicular-ish to the face:
+			Vec3 n = face.normal();
+			Vec3 p1;
+			if (std::abs(n.x) < std::abs(n.y) && std::abs(n.x) < std::abs(n.z)) {
+				p1 = Vec3(1.0f, 0.0f, 0.0f);
+			} else if (std::abs(n.y) < std::abs(n.z)) {
+				p1 = Vec3(0.0f, 1.0f, 0.0f);
+			} else {
+				p1 = Vec3(0.0f, 0.0f, 1.0f);
+			}
+			p1 = (p1 - dot(p1, n) * n).unit();
+			Vec3 p2 = cross(n, p1);
+
+			//find bounds of face on plane:
+			Vec2 min = Vec2(std::numeric_limits< float >::infinity(), std::numeric_limits< float >::infinity());
+			Vec2 max = Vec2(-std::numeric_limits< float >::infinity(), -std::numeric_limits< float >::infinity());
+			HalfedgeRef v = face.halfedge;
+			do {
+				Vec2 pt = Vec2(dot(p1, v->vertex->position), dot(p2, v->vertex->position));
+				min = hmin(min, pt);
+				max = hmax(max, pt);
+				v = v->next;
+			} while (v != face.halfedge);
+
+			//set corner uvs based on position within bounds:
+			do {
+				Vec2 pt = Vec2(dot(p1, v->vertex->position), dot(p2, v->vertex->position));
+				v->corner_uv = Vec2(
+					(pt.x - min.x) / (max.x - min.x),
+					(pt.y - min.y) / (max.y - min.y)
+				);
+				v = v->next;
+			} while (v != face.halfedge);
+		}
+	});
 }
 
 /*
@@ -783,14 +873,23 @@ void Halfedge_Mesh::set_corner_uvs_project(Vec3 origin, Vec3 u_axis, Vec3 v_axis
 	u_axis /= u_axis.norm_squared();
 	v_axis /= v_axis.norm_squared();
 
-	for (auto &halfedge : halfedges) {
-		if (halfedge.face->boundary) {
-			halfedge.corner_uv = Vec2(0.0f, 0.0f);
-		} else {
-			halfedge.corner_uv = Vec2(
-				dot(halfedge.vertex->position - origin, u_axis),
-				dot(halfedge.vertex->position - origin, v_axis)
-			);
-		}
+	std::vector< HalfedgeRef > halfedge_refs;
+	halfedge_refs.reserve(halfedges.size());
+	for (HalfedgeRef h = halfedges.begin(); h != halfedges.end(); ++h) {
+		halfedge_refs.emplace_back(h);
 	}
+
+	parallel_for(uint32_t(halfedge_refs.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Halfedge &halfedge = *halfedge_refs[i];
+			if (halfedge.face->boundary) {
+				halfedge.corner_uv = Vec2(0.0f, 0.0f);
+			} else {
+				halfedge.corner_uv = Vec2(
+					dot(halfedge.vertex->position - origin, u_axis),
+					dot(halfedge.vertex->position - origin, v_axis)
+				);
+			}
+		}
+	});
 }
@@ -1,10 +1,16 @@
 
 #include "halfedge.h"
 #include "indexed.h"
+#include "../util/thread_pool.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <map>
+#include <mutex>
 #include <set>
 #include <sstream>
+#include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
 #include <iostream>
@@ -45,6 +51,59 @@ void Halfedge_Mesh::interpolate_data(std::vector< HalfedgeCRef > const &from, Ha
 	}
 }
 
+Halfedge_Mesh::Halfedge_Mesh() : Halfedge_Mesh(std::make_shared< Element_Arena >()) {
+}
+
+Halfedge_Mesh::Halfedge_Mesh(std::shared_ptr< Element_Arena > const &arena)
+	: vertices(arena), edges(arena), faces(arena), halfedges(arena),
+	  free_vertices(arena), free_edges(arena), free_faces(arena), free_halfedges(arena) {
+}
+
+void Halfedge_Mesh::parallel_for(uint32_t count, std::function< void(uint32_t, uint32_t) > const &body) {
+	//ranges smaller than this aren't worth handing to another thread:
+	constexpr uint32_t Grain = 4096;
+
+	static Thread_Pool thread_pool(std::max(1u, std::thread::hardware_concurrency()));
+	uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+	//set on pool threads while they run a range; a nested parallel_for waiting on the pool
+	// from a pool thread could deadlock once every worker is waiting, so it runs serially instead:
+	static thread_local bool in_range = false;
+
+	uint32_t ranges = std::min(threads * 4, (count + Grain - 1) / Grain);
+	if (in_range || ranges <= 1) {
+		if (count > 0) body(0, count);
+		return;
+	}
+
+	std::vector< std::future< void > > futures;
+	futures.reserve(ranges);
+	for (uint32_t r = 0; r < ranges; ++r) {
+		uint32_t begin = uint32_t(uint64_t(count) * r / ranges);
+		uint32_t end = uint32_t(uint64_t(count) * (r + 1) / ranges);
+		futures.emplace_back(thread_pool.enqueue([&body, begin, end]() {
+			in_range = true;
+			try {
+				body(begin, end);
+			} catch (...) {
+				in_range = false;
+				throw;
+			}
+			in_range = false;
+		}));
+	}
+	//wait for every range (even if one throws) before rethrowing, since they reference 'body':
+	std::exception_ptr error;
+	for (auto &future : futures) {
+		try {
+			future.get();
+		} catch (...) {
+			if (!error) error = std::current_exception();
+		}
+	}
+	if (error) std::rethrow_exception(error);
+}
+
 Halfedge_Mesh::VertexRef Halfedge_Mesh::emplace_vertex() {
 	VertexRef vertex;
 	if (free_vertices.empty()) {
@@ -364,8 +423,8 @@ size_t Halfedge_Mesh::n_boundaries() const {
 
 
 //helper used to get set of pointers into a list (used by validate and describe):
-template< typename T >
-static std::unordered_set< T const * > element_addresses(std::list< T > const &list) {
+template< typename T, typename A >
+static std::unordered_set< T const * > element_addresses(std::list< T, A > const &list) {
 	std::unordered_set< T const * > address_set;
 	for (auto const &e : list) {
 		auto ret = address_set.emplace(&e);
@@ -444,7 +503,7 @@ static std::string to_string(T const *addr) {
 	return oss.str();
 }
 
-std::optional<std::pair<Halfedge_Mesh::ElementCRef, std::string>> Halfedge_Mesh::validate() const {
+std::optional<std::pair<Halfedge_Mesh::ElementCRef, std::string>> Halfedge_Mesh::validate_by_address() const {
 
 	//helpers for error messages:
 	auto describe_vertex   = [](VertexCRef v)   { return "Vertex with id " + std::to_string(v->id); };
@@ -664,8 +723,573 @@ std::optional<std::pair<Halfedge_Mesh::ElementCRef, std::string>> Halfedge_Mesh:
 
 
 
+bool Halfedge_Mesh::positions_by_id(std::vector< uint32_t > &id_position) const {
+	constexpr uint32_t Unused = -1U;
+	id_position.assign(next_id, Unused);
+	auto index_ids = [&](auto const &list) {
+		uint32_t position = 0;
+		for (auto const &e : list) {
+			if (e.id >= next_id || id_position[e.id] != Unused) return false;
+			id_position[e.id] = position++;
+		}
+		return true;
+	};
+	return index_ids(vertices) && index_ids(edges) && index_ids(faces) && index_ids(halfedges);
+}
+
+//run check(i) for all i in [0, count) using parallel_for, returning the problem found at the smallest i:
+// (so the result is the same as checking in order and stopping at the first problem)
+template< typename Check >
+static std::optional<std::pair<Halfedge_Mesh::ElementCRef, std::string>> first_problem(uint32_t count, Check const &check) {
+	std::mutex problem_mutex;
+	std::atomic< uint32_t > problem_index(count);
+	std::optional<std::pair<Halfedge_Mesh::ElementCRef, std::string>> problem;
+	Halfedge_Mesh::parallel_for(count, [&](uint32_t begin, uint32_t end) {
+		//(no need to look past a problem some other range already found)
+		for (uint32_t i = begin; i < end && i < problem_index.load(std::memory_order_relaxed); ++i) {
+			if (auto found = check(i)) {
+				std::lock_guard< std::mutex > lock(problem_mutex);
+				if (i < problem_index) {
+					problem_index = i;
+					problem = std::move(found);
+				}
+				return;
+			}
+		}
+	});
+	return problem;
+}
+
+std::optional<std::pair<Halfedge_Mesh::ElementCRef, std::string>> Halfedge_Mesh::validate() const {
+
+	//Same checks (and messages) as validate_by_address(), but elements are looked up by id (like copy())
+	// so membership tests are array lookups, and each check runs over element arrays in parallel.
+
+	std::vector< uint32_t > id_position;
+	if (!positions_by_id(id_position)) {
+		//(ids have been edited so they can't be used as indices)
+		return validate_by_address();
+	}
+
+	auto refs_of = [](auto const &list) {
+		std::vector< decltype(list.begin()) > refs;
+		refs.reserve(list.size());
+		for (auto e = list.begin(); e != list.end(); ++e) {
+			refs.emplace_back(e);
+		}
+		return refs;
+	};
+	std::vector< VertexCRef > vertex_at = refs_of(vertices);
+	std::vector< EdgeCRef > edge_at = refs_of(edges);
+	std::vector< FaceCRef > face_at = refs_of(faces);
+	std::vector< HalfedgeCRef > halfedge_at = refs_of(halfedges);
+
+	//helpers for error messages:
+	auto describe_vertex   = [](VertexCRef v)   { return "Vertex with id " + std::to_string(v->id); };
+	auto describe_edge     = [](EdgeCRef e)     { return "Edge with id " + std::to_string(e->id); };
+	auto describe_face     = [](FaceCRef f)     { return "Face with id " + std::to_string(f->id); };
+	auto describe_halfedge = [](HalfedgeCRef h) { return "Halfedge with id " + std::to_string(h->id); };
+
+	//is a reference held in a given list? (position of its id must hold that very element)
+	// (the id is only read once the reference is known to point into this mesh's arena, so
+	//  references into other -- possibly freed -- meshes are reported rather than followed)
+	Element_Arena const *arena = vertices.get_allocator().arena.get();
+	auto in_list = [&](auto const &ref, auto const &list, auto const &at) {
+		if (ref == list.end()) return false;
+		if (!arena || !arena->owns(&*ref)) return false;
+		uint32_t id = ref->id;
+		return id < id_position.size() && id_position[id] < at.size() && at[id_position[id]] == ref;
+	};
+
+	//description of something that isn't in a list (only needed once a problem is found):
+	auto describe_missing = [](auto const &ref, auto const &list, auto const &free_list, std::string const &kind) -> std::string {
+		if (ref == list.end()) return "past-the-end " + kind;
+		for (auto const &e : free_list) {
+			if (&e == &*ref) return "erased " + kind + " with old id " + std::to_string(ref->id & 0x7fffffffu);
+		}
+		return "out-of-mesh " + kind + " with address " + to_string(&*ref);
+	};
+	auto describe_missing_vertex   = [&](VertexCRef v)   { return describe_missing(v, vertices, free_vertices, "vertex"); };
+	auto describe_missing_edge     = [&](EdgeCRef e)     { return describe_missing(e, edges, free_edges, "edge"); };
+	auto describe_missing_face     = [&](FaceCRef f)     { return describe_missing(f, faces, free_faces, "face"); };
+	auto describe_missing_halfedge = [&](HalfedgeCRef h) { return describe_missing(h, halfedges, free_halfedges, "halfedge"); };
+
+	using Problem = std::optional<std::pair<ElementCRef, std::string>>;
+
+	//-----------------------------
+	//check element data:
+	if (auto problem = first_problem(uint32_t(vertex_at.size()), [&](uint32_t i) -> Problem {
+		VertexCRef v = vertex_at[i];
+		if (!std::isfinite(v->position.x)) return {{v, describe_vertex(v) + " has position.x set to a non-finite value: " + std::to_string(v->position.x) + "."}};
+		if (!std::isfinite(v->position.y)) return {{v, describe_vertex(v) + " has position.y set to a non-finite value: " + std::to_string(v->position.y) + "."}};
+		if (!std::isfinite(v->position.z)) return {{v, describe_vertex(v) + " has position.z set to a non-finite value: " + std::to_string(v->position.z) + "."}};
+		for (uint32_t b = 0; b < v->bone_weights.size(); ++b) {
+			if (!std::isfinite(v->bone_weights[b].weight)) return {{v, describe_vertex(v) + " has bone_weights[" + std::to_string(b) + "].weight set to a non-finite value: " + std::to_string(v->bone_weights[b].weight) + "."}};
+		}
+		return std::nullopt;
+	})) return problem;
+
+	if (auto problem = first_problem(uint32_t(halfedge_at.size()), [&](uint32_t i) -> Problem {
+		HalfedgeCRef h = halfedge_at[i];
+		if (!std::isfinite(h->corner_uv.x)) return {{h, describe_halfedge(h) + " has corner_uv.x set to a non-finite value: " + std::to_string(h->corner_uv.x) + "."}};
+		if (!std::isfinite(h->corner_uv.y)) return {{h, describe_halfedge(h) + " has corner_uv.y set to a non-finite value: " + std::to_string(h->corner_uv.y) + "."}};
+		if (!std::isfinite(h->corner_normal.x)) return {{h, describe_halfedge(h) + " has corner_normal.x set to a non-finite value: " + std::to_string(h->corner_normal.x) + "."}};
+		if (!std::isfinite(h->corner_normal.y)) return {{h, describe_halfedge(h) + " has corner_normal.y set to a non-finite value: " + std::to_string(h->corner_normal.y) + "."}};
+		if (!std::isfinite(h->corner_normal.z)) return {{h, describe_halfedge(h) + " has corner_normal.z set to a non-finite value: " + std::to_string(h->corner_normal.z) + "."}};
+		return std::nullopt;
+	})) return problem;
+
+	//-----------------------------
+	//all references held by elements are to members of the vertices, edges, faces, or halfedges lists
+
+	if (auto problem = first_problem(uint32_t(vertex_at.size()), [&](uint32_t i) -> Problem {
+		VertexCRef v = vertex_at[i];
+		if (!in_list(v->halfedge, halfedges, halfedge_at)) return {{v, describe_vertex(v) + " references " + describe_missing_halfedge(v->halfedge) + "."}};
+		return std::nullopt;
+	})) return problem;
+
+	if (auto problem = first_problem(uint32_t(edge_at.size()), [&](uint32_t i) -> Problem {
+		EdgeCRef e = edge_at[i];
+		if (!in_list(e->halfedge, halfedges, halfedge_at)) return {{e, describe_edge(e) + " references " + describe_missing_halfedge(e->halfedge) + "."}};
+		return std::nullopt;
+	})) return problem;
+
+	if (auto problem = first_problem(uint32_t(face_at.size()), [&](uint32_t i) -> Problem {
+		FaceCRef f = face_at[i];
+		if (!in_list(f->halfedge, halfedges, halfedge_at)) return {{f, describe_face(f) + " references " + describe_missing_halfedge(f->halfedge) + "."}};
+		return std::nullopt;
+	})) return problem;
+
+	if (auto problem = first_problem(uint32_t(halfedge_at.size()), [&](uint32_t i) -> Problem {
+		HalfedgeCRef h = halfedge_at[i];
+		if (!in_list(h->twin, halfedges, halfedge_at)) return {{h, describe_halfedge(h) + " has twin which references " + describe_missing_halfedge(h->twin) + "."}};
+		if (!in_list(h->next, halfedges, halfedge_at)) return {{h, describe_halfedge(h) + " has next which references " + describe_missing_halfedge(h->next) + "."}};
+		if (!in_list(h->vertex, vertices, vertex_at)) return {{h, describe_halfedge(h) + " references " + describe_missing_vertex(h->vertex) + "."}};
+		if (!in_list(h->edge, edges, edge_at)) return {{h, describe_halfedge(h) + " references " + describe_missing_edge(h->edge) + "."}};
+		if (!in_list(h->face, faces, face_at)) return {{h, describe_halfedge(h) + " references " + describe_missing_face(h->face) + "."}};
+		return std::nullopt;
+	})) return problem;
+
+	//------------------------------
+	// - `edge->halfedge(->twin)^n` is a cycle of two halfedges
+	//   - this is also exactly the set of halfedges that reference `edge`
+	// - `face->halfedge(->next)^n` is a cycle of at least three halfedges
+	//   - this is also exactly the set of halfedges that reference `face`
+	// - `vertex->halfedge(->twin->next)^n` is a cycle of at least two halfedges
+	//   - this is also exactly the set of halfedges that reference `vertex`
+
+	//first, count the halfedges that reference every other element:
+	std::vector< uint32_t > vertex_references(vertex_at.size(), 0);
+	std::vector< uint32_t > edge_references(edge_at.size(), 0);
+	std::vector< uint32_t > face_references(face_at.size(), 0);
+	for (auto const &h : halfedges) {
+		vertex_references[id_position[h.vertex->id]] += 1;
+		edge_references[id_position[h.edge->id]] += 1;
+		face_references[id_position[h.face->id]] += 1;
+	}
+
+	//walking element->halfedge(step)^n visits only halfedges that reference element, so it is a cycle of
+	// exactly those halfedges if it gets back to the start after visiting each at most once:
+	auto check_cycle = [&](auto element, std::string const &description, std::string const &kind, uint32_t references, auto const &refers, auto const &step, std::string const &step_name) -> std::optional< std::string > {
+		HalfedgeCRef h = element->halfedge;
+		uint32_t steps = 0;
+		do {
+			if (!refers(h)) {
+				std::string path = "halfedge";
+				for (uint32_t s = 0; s < steps; ++s) path += step_name;
+				return description + " has " + path + " of " + describe_halfedge(h) + ", which does not reference the " + kind + ".";
+			}
+			//(more steps than referencing halfedges means one was visited twice)
+			if (steps == references) return description + " has halfedge(" + step_name + ")^n which is not a cycle.";
+			h = step(h);
+			++steps;
+		} while (h != element->halfedge);
+
+		if (steps < references) {
+			std::unordered_set< HalfedgeCRef > cycle;
+			h = element->halfedge;
+			do {
+				cycle.emplace(h);
+				h = step(h);
+			} while (h != element->halfedge);
+			for (HalfedgeCRef r = halfedges.begin(); r != halfedges.end(); ++r) {
+				if (refers(r) && !cycle.count(r)) return description + " is referenced by " + describe_halfedge(r) + ", which is not in halfedge(" + step_name + ")^n.";
+			}
+		}
+		return std::nullopt;
+	};
+
+	//check edge->halfedge(->twin)^n:
+	if (auto problem = first_problem(uint32_t(edge_at.size()), [&](uint32_t i) -> Problem {
+		EdgeCRef e = edge_at[i];
+		if (auto message = check_cycle(e, describe_edge(e), "edge", edge_references[i],
+			[e](HalfedgeCRef h) { return h->edge == e; },
+			[](HalfedgeCRef h) { return h->twin; }, "->twin")) {
+			return {{e, *message}};
+		}
+		if (edge_references[i] != 2) return {{e, describe_edge(e) + " has " + std::to_string(edge_references[i]) + " (!= 2) elements in its halfedge(->twin)^n cycle."}};
+		return std::nullopt;
+	})) return problem;
+
+	//check face->halfedge(->next)^n:
+	if (auto problem = first_problem(uint32_t(face_at.size()), [&](uint32_t i) -> Problem {
+		FaceCRef f = face_at[i];
+		if (auto message = check_cycle(f, describe_face(f), "face", face_references[i],
+			[f](HalfedgeCRef h) { return h->face == f; },
+			[](HalfedgeCRef h) { return h->next; }, "->next")) {
+			return {{f, *message}};
+		}
+		if (face_references[i] < 3) return {{f, describe_face(f) + " has " + std::to_string(face_references[i]) + " (< 3) elements in its halfedge(->next)^n cycle."}};
+		return std::nullopt;
+	})) return problem;
+
+	//check vertex->halfedge(->twin->next)^n:
+	if (auto problem = first_problem(uint32_t(vertex_at.size()), [&](uint32_t i) -> Problem {
+		VertexCRef v = vertex_at[i];
+		if (auto message = check_cycle(v, describe_vertex(v), "vertex", vertex_references[i],
+			[v](HalfedgeCRef h) { return h->vertex == v; },
+			[](HalfedgeCRef h) { return h->twin->next; }, "->twin->next")) {
+			return {{v, *message}};
+		}
+		if (vertex_references[i] < 2) return {{v, describe_vertex(v) + " has " + std::to_string(vertex_references[i]) + " (< 2) elements in its halfedge(->twin->next)^n cycle."}};
+		return std::nullopt;
+	})) return problem;
+
+	//------------------------------
+	// - vertices are not orphaned (they have at least one non-boundary face adjacent)
+	// - vertices are on at most one boundary face
+
+	if (auto problem = first_problem(uint32_t(vertex_at.size()), [&](uint32_t i) -> Problem {
+		VertexCRef v = vertex_at[i];
+		uint32_t non_boundary = 0;
+		uint32_t boundary = 0;
+		HalfedgeCRef h = v->halfedge;
+		do {
+			if (h->face->boundary) ++boundary;
+			else ++non_boundary;
+
+			h = h->twin->next;
+		} while (h != v->halfedge);
+
+		if (non_boundary == 0) return {{v, describe_vertex(v) + " is orphaned (has no adjacent non-boundary faces)."}};
+		if (boundary > 1) return {{v, describe_vertex(v) + " is on " + std::to_string(boundary) + " (> 1) boundary faces."}};
+		return std::nullopt;
+	})) return problem;
+
+	//------------------------------
+	// - edges are not orphaned (they have at least one non-boundary face adjacent)
+	if (auto problem = first_problem(uint32_t(edge_at.size()), [&](uint32_t i) -> Problem {
+		EdgeCRef e = edge_at[i];
+		if (e->halfedge->face->boundary && e->halfedge->twin->face->boundary) return {{e, describe_edge(e) + " is orphaned (has no adjacent non-boundary face)."}};
+		return std::nullopt;
+	})) return problem;
+
+	//------------------------------
+	// - faces are simple (touch each vertex / edge at most once)
+	if (auto problem = first_problem(uint32_t(face_at.size()), [&](uint32_t i) -> Problem {
+		FaceCRef f = face_at[i];
+
+		//small faces (almost all of them) just compare against the corners seen so far:
+		constexpr uint32_t Small = 16;
+		if (face_references[i] <= Small) {
+			VertexCRef touched_vertices[Small];
+			EdgeCRef touched_edges[Small];
+			uint32_t touched = 0;
+
+			HalfedgeCRef h = f->halfedge;
+			do {
+				for (uint32_t t = 0; t < touched; ++t) {
+					if (touched_vertices[t] == h->vertex) return {{f, describe_face(f) + " touches " + describe_vertex(h->vertex) + " more than once."}};
+				}
+				for (uint32_t t = 0; t < touched; ++t) {
+					if (touched_edges[t] == h->edge) return {{f, describe_face(f) + " touches " + describe_edge(h->edge) + " more than once."}};
+				}
+				touched_vertices[touched] = h->vertex;
+				touched_edges[touched] = h->edge;
+				++touched;
+
+				h = h->next;
+			} while (h != f->halfedge);
+			return std::nullopt;
+		}
+
+		std::unordered_set< VertexCRef > touched_vertices;
+		std::unordered_set< EdgeCRef > touched_edges;
+
+		HalfedgeCRef h = f->halfedge;
+		do {
+			if (!touched_vertices.emplace(h->vertex).second) return {{f, describe_face(f) + " touches " + describe_vertex(h->vertex) + " more than once."}};
+			if (!touched_edges.emplace(h->edge).second) return {{f, describe_face(f) + " touches " + describe_edge(h->edge) + " more than once."}};
+
+			h = h->next;
+		} while (h != f->halfedge);
+		return std::nullopt;
+	})) return problem;
+
+	return std::nullopt;
+}
+
+std::optional<std::pair<Halfedge_Mesh::ElementCRef, std::string>> Halfedge_Mesh::validate_local(std::vector< ElementCRef > const &around) const {
+
+	//Without a pass over the whole mesh there is no cheap test for list membership, so references are
+	// only followed once they are known to be neither past-the-end, nor outside this mesh's arena, nor
+	// erased (erase_*() sets the top bit of ids).
+
+	//helpers for error messages:
+	auto describe_vertex   = [](VertexCRef v)   { return "Vertex with id " + std::to_string(v->id); };
+	auto describe_edge     = [](EdgeCRef e)     { return "Edge with id " + std::to_string(e->id); };
+	auto describe_face     = [](FaceCRef f)     { return "Face with id " + std::to_string(f->id); };
+	auto describe_halfedge = [](HalfedgeCRef h) { return "Halfedge with id " + std::to_string(h->id); };
+
+	Element_Arena const *arena = vertices.get_allocator().arena.get();
+	auto unusable = [&](auto const &ref, auto const &list, std::string const &kind) -> std::optional< std::string > {
+		if (ref == list.end()) return "past-the-end " + kind;
+		if (!arena || !arena->owns(&*ref)) return "out-of-mesh " + kind + " with address " + to_string(&*ref);
+		if (ref->id & 0x80000000u) return "erased " + kind + " with old id " + std::to_string(ref->id & 0x7fffffffu);
+		return std::nullopt;
+	};
+
+	using Problem = std::optional<std::pair<ElementCRef, std::string>>;
+
+	//halfedges (and the elements they reference) have their data and references checked before being followed:
+	std::unordered_set< HalfedgeCRef > checked_halfedges;
+	auto check_halfedge = [&](HalfedgeCRef h) -> Problem {
+		if (!checked_halfedges.emplace(h).second) return std::nullopt;
+
+		if (!std::isfinite(h->corner_uv.x)) return {{h, describe_halfedge(h) + " has corner_uv.x set to a non-finite value: " + std::to_string(h->corner_uv.x) + "."}};
+		if (!std::isfinite(h->corner_uv.y)) return {{h, describe_halfedge(h) + " has corner_uv.y set to a non-finite value: " + std::to_string(h->corner_uv.y) + "."}};
+		if (!std::isfinite(h->corner_normal.x)) return {{h, describe_halfedge(h) + " has corner_normal.x set to a non-finite value: " + std::to_string(h->corner_normal.x) + "."}};
+		if (!std::isfinite(h->corner_normal.y)) return {{h, describe_halfedge(h) + " has corner_normal.y set to a non-finite value: " + std::to_string(h->corner_normal.y) + "."}};
+		if (!std::isfinite(h->corner_normal.z)) return {{h, describe_halfedge(h) + " has corner_normal.z set to a non-finite value: " + std::to_string(h->corner_normal.z) + "."}};
+
+		if (auto missing = unusable(h->twin, halfedges, "halfedge")) return {{h, describe_halfedge(h) + " has twin which references " + *missing + "."}};
+		if (auto missing = unusable(h->next, halfedges, "halfedge")) return {{h, describe_halfedge(h) + " has next which references " + *missing + "."}};
+		if (auto missing = unusable(h->vertex, vertices, "vertex")) return {{h, describe_halfedge(h) + " references " + *missing + "."}};
+		if (auto missing = unusable(h->edge, edges, "edge")) return {{h, describe_halfedge(h) + " references " + *missing + "."}};
+		if (auto missing = unusable(h->face, faces, "face")) return {{h, describe_halfedge(h) + " references " + *missing + "."}};
+
+		if (auto missing = unusable(h->vertex->halfedge, halfedges, "halfedge")) return {{h->vertex, describe_vertex(h->vertex) + " references " + *missing + "."}};
+		if (auto missing = unusable(h->edge->halfedge, halfedges, "halfedge")) return {{h->edge, describe_edge(h->edge) + " references " + *missing + "."}};
+		if (auto missing = unusable(h->face->halfedge, halfedges, "halfedge")) return {{h->face, describe_face(h->face) + " references " + *missing + "."}};
+		return std::nullopt;
+	};
+
+	//The neighborhood is the faces around the starting vertices; every vertex of those faces has its
+	// cycle walked as well, so each halfedge that was seen can be checked against its vertex, edge, and face.
+
+	//faces in the neighborhood, in the order they were found:
+	std::vector< FaceCRef > near_faces;
+	std::unordered_set< FaceCRef > found_faces;
+
+	//halfedges seen on vertex and face cycles:
+	std::vector< HalfedgeCRef > seen_halfedges;
+	std::unordered_set< HalfedgeCRef > on_vertex_cycles;
+	std::unordered_set< HalfedgeCRef > on_face_cycles;
+
+	//vertices: data, halfedge(->twin->next)^n cycle, orphaned / boundary:
+	// (if 'gather', faces around the vertex are added to the neighborhood)
+	std::unordered_set< VertexCRef > checked_vertices;
+	auto check_vertex = [&](VertexCRef v, bool gather) -> Problem {
+		if (!checked_vertices.emplace(v).second) return std::nullopt;
+
+		if (!std::isfinite(v->position.x)) return {{v, describe_vertex(v) + " has position.x set to a non-finite value: " + std::to_string(v->position.x) + "."}};
+		if (!std::isfinite(v->position.y)) return {{v, describe_vertex(v) + " has position.y set to a non-finite value: " + std::to_string(v->position.y) + "."}};
+		if (!std::isfinite(v->position.z)) return {{v, describe_vertex(v) + " has position.z set to a non-finite value: " + std::to_string(v->position.z) + "."}};
+		for (uint32_t b = 0; b < v->bone_weights.size(); ++b) {
+			if (!std::isfinite(v->bone_weights[b].weight)) return {{v, describe_vertex(v) + " has bone_weights[" + std::to_string(b) + "].weight set to a non-finite value: " + std::to_string(v->bone_weights[b].weight) + "."}};
+		}
+		if (auto missing = unusable(v->halfedge, halfedges, "halfedge")) return {{v, describe_vertex(v) + " references " + *missing + "."}};
+
+		uint32_t non_boundary = 0;
+		uint32_t boundary = 0;
+		std::string path = "halfedge";
+		HalfedgeCRef h = v->halfedge;
+		do {
+			if (auto problem = check_halfedge(h)) return problem;
+			if (h->vertex != v) return {{v, describe_vertex(v) + " has " + path + " of " + describe_halfedge(h) + ", which does not reference the vertex."}};
+			if (!on_vertex_cycles.emplace(h).second) return {{v, describe_vertex(v) + " has halfedge(->twin->next)^n which is not a cycle."}};
+			seen_halfedges.emplace_back(h);
+
+			if (h->face->boundary) ++boundary;
+			else ++non_boundary;
+			if (gather && found_faces.emplace(h->face).second) near_faces.emplace_back(h->face);
+
+			if (auto problem = check_halfedge(h->twin)) return problem;
+			h = h->twin->next;
+			path += "->twin->next";
+		} while (h != v->halfedge);
+
+		if (non_boundary + boundary < 2) return {{v, describe_vertex(v) + " has " + std::to_string(non_boundary + boundary) + " (< 2) elements in its halfedge(->twin->next)^n cycle."}};
+		if (non_boundary == 0) return {{v, describe_vertex(v) + " is orphaned (has no adjacent non-boundary faces)."}};
+		if (boundary > 1) return {{v, describe_vertex(v) + " is on " + std::to_string(boundary) + " (> 1) boundary faces."}};
+		return std::nullopt;
+	};
+
+	//faces: halfedge(->next)^n cycle, simple:
+	std::unordered_set< FaceCRef > checked_faces;
+	auto check_face = [&](FaceCRef f) -> Problem {
+		if (!checked_faces.emplace(f).second) return std::nullopt;
+		if (auto missing = unusable(f->halfedge, halfedges, "halfedge")) return {{f, describe_face(f) + " references " + *missing + "."}};
+
+		uint32_t sides = 0;
+		std::unordered_set< VertexCRef > touched_vertices;
+		std::unordered_set< EdgeCRef > touched_edges;
+		std::string path = "halfedge";
+		HalfedgeCRef h = f->halfedge;
+		do {
+			if (auto problem = check_halfedge(h)) return problem;
+			if (h->face != f) return {{f, describe_face(f) + " has " + path + " of " + describe_halfedge(h) + ", which does not reference the face."}};
+			if (!on_face_cycles.emplace(h).second) return {{f, describe_face(f) + " has halfedge(->next)^n which is not a cycle."}};
+			if (!touched_vertices.emplace(h->vertex).second) return {{f, describe_face(f) + " touches " + describe_vertex(h->vertex) + " more than once."}};
+			if (!touched_edges.emplace(h->edge).second) return {{f, describe_face(f) + " touches " + describe_edge(h->edge) + " more than once."}};
+			seen_halfedges.emplace_back(h);
+			++sides;
+
+			h = h->next;
+			path += "->next";
+		} while (h != f->halfedge);
+
+		if (sides < 3) return {{f, describe_face(f) + " has " + std::to_string(sides) + " (< 3) elements in its halfedge(->next)^n cycle."}};
+		return std::nullopt;
+	};
+
+	//edges: halfedge(->twin)^n cycle of two, not orphaned:
+	std::unordered_set< EdgeCRef > checked_edges;
+	auto check_edge = [&](EdgeCRef e) -> Problem {
+		if (!checked_edges.emplace(e).second) return std::nullopt;
+		HalfedgeCRef a = e->halfedge;
+		if (auto problem = check_halfedge(a)) return problem;
+		if (a->edge != e) return {{e, describe_edge(e) + " has halfedge of " + describe_halfedge(a) + ", which does not reference the edge."}};
+		HalfedgeCRef b = a->twin;
+		if (auto problem = check_halfedge(b)) return problem;
+		if (b->edge != e) return {{e, describe_edge(e) + " has halfedge->twin of " + describe_halfedge(b) + ", which does not reference the edge."}};
+		if (b == a || b->twin != a) return {{e, describe_edge(e) + " has halfedge(->twin)^n which is not a cycle of two halfedges."}};
+
+		if (a->face->boundary && b->face->boundary) return {{e, describe_edge(e) + " is orphaned (has no adjacent non-boundary face)."}};
+		return std::nullopt;
+	};
+
+	//start from the vertices of the elements given:
+	for (ElementCRef const &element : around) {
+		Problem problem = std::visit(overloaded{
+			[&](VertexCRef v) -> Problem {
+				if (auto missing = unusable(v, vertices, "vertex")) return {{v, "Checking around " + *missing + "."}};
+				return check_vertex(v, true);
+			},
+			[&](EdgeCRef e) -> Problem {
+				if (auto missing = unusable(e, edges, "edge")) return {{e, "Checking around " + *missing + "."}};
+				if (auto missing = unusable(e->halfedge, halfedges, "halfedge")) return {{e, describe_edge(e) + " references " + *missing + "."}};
+				if (auto problem = check_edge(e)) return problem;
+				if (auto problem = check_vertex(e->halfedge->vertex, true)) return problem;
+				return check_vertex(e->halfedge->twin->vertex, true);
+			},
+			[&](FaceCRef f) -> Problem {
+				if (auto missing = unusable(f, faces, "face")) return {{f, "Checking around " + *missing + "."}};
+				if (found_faces.emplace(f).second) near_faces.emplace_back(f);
+				size_t begin = seen_halfedges.size();
+				if (auto problem = check_face(f)) return problem;
+				for (size_t i = begin, end = seen_halfedges.size(); i < end; ++i) {
+					if (auto problem = check_vertex(seen_halfedges[i]->vertex, true)) return problem;
+				}
+				return std::nullopt;
+			},
+			[&](HalfedgeCRef h) -> Problem {
+				if (auto missing = unusable(h, halfedges, "halfedge")) return {{h, "Checking around " + *missing + "."}};
+				if (auto problem = check_halfedge(h)) return problem;
+				if (auto problem = check_halfedge(h->twin)) return problem;
+				if (auto problem = check_vertex(h->vertex, true)) return problem;
+				return check_vertex(h->twin->vertex, true);
+			}
+		}, element);
+		if (problem) return problem;
+	}
+
+	//...then every face around those vertices:
+	for (FaceCRef f : near_faces) {
+		if (auto problem = check_face(f)) return problem;
+	}
+
+	//...and the vertices of those faces:
+	for (size_t i = 0, end = seen_halfedges.size(); i < end; ++i) {
+		if (auto problem = check_vertex(seen_halfedges[i]->vertex, false)) return problem;
+	}
+
+	//every halfedge seen should be on the cycles of the (checked) elements it references:
+	for (HalfedgeCRef h : seen_halfedges) {
+		if (auto problem = check_edge(h->edge)) return problem;
+		if (h != h->edge->halfedge && h != h->edge->halfedge->twin) {
+			return {{h->edge, describe_edge(h->edge) + " is referenced by " + describe_halfedge(h) + ", which is not in halfedge(->twin)^n."}};
+		}
+		if (checked_vertices.count(h->vertex) && !on_vertex_cycles.count(h)) {
+			return {{h->vertex, describe_vertex(h->vertex) + " is referenced by " + describe_halfedge(h) + ", which is not in halfedge(->twin->next)^n."}};
+		}
+		if (checked_faces.count(h->face) && !on_face_cycles.count(h)) {
+			return {{h->face, describe_face(h->face) + " is referenced by " + describe_halfedge(h) + ", which is not in halfedge(->next)^n."}};
+		}
+	}
+
+	return std::nullopt;
+}
+
+
 Halfedge_Mesh Halfedge_Mesh::copy() const {
 
+	//Elements are matched up by id (which is unique within a mesh and less than next_id),
+	// so links can be remapped with array lookups instead of hashing addresses:
+	std::vector< uint32_t > id_position; //position of element with given id in its list
+	if (!positions_by_id(id_position)) {
+		//(ids have been edited so they can't be used as indices)
+		return copy_by_address();
+	}
+
+	Halfedge_Mesh mesh;
+
+	//new mesh should also have the same next_id as this one:
+	mesh.next_id = next_id;
+
+	//copy elements, keeping track of the copy at each position:
+	auto copy_list = [](auto const &from, auto &to) {
+		std::vector< decltype(to.begin()) > copies;
+		copies.reserve(from.size());
+		for (auto const &e : from) {
+			copies.emplace_back(to.insert(to.end(), e));
+		}
+		return copies;
+	};
+	std::vector< VertexRef > new_vertices = copy_list(vertices, mesh.vertices);
+	std::vector< EdgeRef > new_edges = copy_list(edges, mesh.edges);
+	std::vector< FaceRef > new_faces = copy_list(faces, mesh.faces);
+	std::vector< HalfedgeRef > new_halfedges = copy_list(halfedges, mesh.halfedges);
+
+	//remap links (end() stays end(); links to elements not in the mesh throw std::out_of_range, like .at()):
+	auto remap = [&](auto const &ref, auto const &end, auto const &copies, auto const &new_end) {
+		if (ref == end) return new_end;
+		return copies.at(id_position.at(ref->id));
+	};
+	HalfedgeCRef h = halfedges.begin();
+	for (HalfedgeRef he : new_halfedges) {
+		he->next = remap(h->next, halfedges.end(), new_halfedges, mesh.halfedges.end());
+		he->twin = remap(h->twin, halfedges.end(), new_halfedges, mesh.halfedges.end());
+		he->vertex = remap(h->vertex, vertices.end(), new_vertices, mesh.vertices.end());
+		he->edge = remap(h->edge, edges.end(), new_edges, mesh.edges.end());
+		he->face = remap(h->face, faces.end(), new_faces, mesh.faces.end());
+		++h;
+	}
+	for (VertexRef v : new_vertices) {
+		v->halfedge = remap(v->halfedge, halfedges.end(), new_halfedges, mesh.halfedges.end());
+	}
+	for (EdgeRef e : new_edges) {
+		e->halfedge = remap(e->halfedge, halfedges.end(), new_halfedges, mesh.halfedges.end());
+	}
+	for (FaceRef f : new_faces) {
+		f->halfedge = remap(f->halfedge, halfedges.end(), new_halfedges, mesh.halfedges.end());
+	}
+
+	return mesh;
+}
+
+Halfedge_Mesh Halfedge_Mesh::copy_by_address() const {
+
 	std::unordered_map< Vertex const *, VertexRef > vertex_map;
 	std::unordered_map< Edge const *, EdgeRef > edge_map;
 	std::unordered_map< Face const *, FaceRef > face_map;
@@ -716,144 +1340,544 @@ Halfedge_Mesh Halfedge_Mesh::copy() const {
 	return mesh;
 }
 
-namespace std {
-template< typename A, typename B >
-struct hash< std::pair< A, B > > {
-	size_t operator()(std::pair< A, B > const &key) const {
-		static const std::hash< A > ha;
-		static const std::hash< B > hb;
-		size_t hf = ha(key.first);
-		size_t hs = hb(key.second);
-		//NOTE: if this were C++20 we could use std::rotr or std::rotl
-		return hf ^ (hs << (sizeof(size_t)*4)) ^ (hs >> (sizeof(size_t)*4));
+//--- deltas ---
+
+//bitwise comparison, so (e.g.) -0.0f and 0.0f count as different and NaNs as equal to themselves:
+template< typename T >
+static bool same_bits(T const &a, T const &b) {
+	return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+static bool same_state(Halfedge_Mesh::Delta::Vertex_State const &a, Halfedge_Mesh::Delta::Vertex_State const &b) {
+	if (a.halfedge != b.halfedge || !same_bits(a.position, b.position)) return false;
+	if (a.bone_weights.size() != b.bone_weights.size()) return false;
+	for (size_t i = 0; i < a.bone_weights.size(); ++i) {
+		if (a.bone_weights[i].bone != b.bone_weights[i].bone) return false;
+		if (!same_bits(a.bone_weights[i].weight, b.bone_weights[i].weight)) return false;
 	}
-};
+	return true;
+}
+static bool same_state(Halfedge_Mesh::Delta::Edge_State const &a, Halfedge_Mesh::Delta::Edge_State const &b) {
+	return a.halfedge == b.halfedge && a.sharp == b.sharp;
+}
+static bool same_state(Halfedge_Mesh::Delta::Face_State const &a, Halfedge_Mesh::Delta::Face_State const &b) {
+	return a.halfedge == b.halfedge && a.boundary == b.boundary;
+}
+static bool same_state(Halfedge_Mesh::Delta::Halfedge_State const &a, Halfedge_Mesh::Delta::Halfedge_State const &b) {
+	return a.twin == b.twin && a.next == b.next && a.vertex == b.vertex && a.edge == b.edge && a.face == b.face
+	    && same_bits(a.corner_uv, b.corner_uv) && same_bits(a.corner_normal, b.corner_normal);
 }
 
-Halfedge_Mesh Halfedge_Mesh::from_indexed_faces(std::vector< Vec3 > const &vertices_, 
-		std::vector< std::vector< Index > > const &faces_,
-		std::vector< std::vector< Index > > const &corner_normal_idxs,
-		std::vector< std::vector< Index > > const &corner_uv_idxs,
-		std::vector<Vec3> const &corner_normals_,
-		std::vector<Vec2> const &corner_uvs_)
-{
+size_t Halfedge_Mesh::Delta::bytes() const {
+	size_t total = sizeof(*this);
+	auto list_bytes = [](auto const &changes) {
+		return changes.states.capacity() * sizeof(changes.states[0])
+		     + changes.order.capacity() * sizeof(Order_Step);
+	};
+	total += list_bytes(vertices) + list_bytes(edges) + list_bytes(faces) + list_bytes(halfedges);
+	for (auto const &v : vertices.states) {
+		total += v.bone_weights.capacity() * sizeof(Vertex::Bone_Weight);
+	}
+	return total;
+}
 
-	Halfedge_Mesh mesh;
+std::optional< Halfedge_Mesh::Delta > Halfedge_Mesh::diff(Halfedge_Mesh const &from, Halfedge_Mesh const &to) {
+	constexpr uint32_t None = Delta::None;
 
-	std::vector< VertexRef > vertices; //for quick lookup of vertices by index
-	vertices.reserve(vertices_.size());
-	for (auto const &v : vertices_) {
-		vertices.emplace_back(mesh.emplace_vertex());
-		vertices.back()->position = v;
-	}
+	//Both meshes are indexed by id (like copy()), so matching elements up is array lookups:
+	struct Index {
+		std::vector< uint32_t > position; //position of element with given id in its list
+		std::vector< VertexCRef > vertices;
+		std::vector< EdgeCRef > edges;
+		std::vector< FaceCRef > faces;
+		std::vector< HalfedgeCRef > halfedges;
+	};
+	auto build_index = [](Halfedge_Mesh const &mesh, Index &index) {
+		if (!mesh.positions_by_id(index.position)) return false;
+		auto refs_of = [](auto const &list, auto &refs) {
+			refs.reserve(list.size());
+			for (auto e = list.begin(); e != list.end(); ++e) {
+				refs.emplace_back(e);
+			}
+		};
+		refs_of(mesh.vertices, index.vertices);
+		refs_of(mesh.edges, index.edges);
+		refs_of(mesh.faces, index.faces);
+		refs_of(mesh.halfedges, index.halfedges);
+		return true;
+	};
+	Index from_index, to_index;
+	if (!build_index(from, from_index) || !build_index(to, to_index)) return std::nullopt;
+
+	//position of element 'id' among refs (None if that list has no such element):
+	auto find = [](uint32_t id, auto const &refs, Index const &index) -> uint32_t {
+		if (id >= index.position.size()) return None;
+		uint32_t p = index.position[id];
+		if (p >= refs.size() || refs[p]->id != id) return None;
+		return p;
+	};
 
+	//links are stored as ids; a link to an element outside the mesh can't be, so it makes the diff fail:
+	bool linked = true;
+	auto link = [&](auto const &ref, auto const &end, auto const &refs, Index const &index) -> uint32_t {
+		if (ref == end) return None;
+		uint32_t p = find(ref->id, refs, index);
+		if (p == None || refs[p] != ref) {
+			linked = false;
+			return None;
+		}
+		return ref->id;
+	};
 
-	std::unordered_map< std::pair< Index, Index >, HalfedgeRef > halfedges; //for quick lookup of halfedges by from/to vertex index
+	auto vertex_state = [&](Halfedge_Mesh const &mesh, Index const &index, Vertex const &v) {
+		return Delta::Vertex_State{
+			v.id, link(v.halfedge, mesh.halfedges.end(), index.halfedges, index),
+			v.position, v.bone_weights
+		};
+	};
+	auto edge_state = [&](Halfedge_Mesh const &mesh, Index const &index, Edge const &e) {
+		return Delta::Edge_State{e.id, link(e.halfedge, mesh.halfedges.end(), index.halfedges, index), e.sharp};
+	};
+	auto face_state = [&](Halfedge_Mesh const &mesh, Index const &index, Face const &f) {
+		return Delta::Face_State{f.id, link(f.halfedge, mesh.halfedges.end(), index.halfedges, index), f.boundary};
+	};
+	auto halfedge_state = [&](Halfedge_Mesh const &mesh, Index const &index, Halfedge const &h) {
+		return Delta::Halfedge_State{
+			h.id,
+			link(h.twin, mesh.halfedges.end(), index.halfedges, index),
+			link(h.next, mesh.halfedges.end(), index.halfedges, index),
+			link(h.vertex, mesh.vertices.end(), index.vertices, index),
+			link(h.edge, mesh.edges.end(), index.edges, index),
+			link(h.face, mesh.faces.end(), index.faces, index),
+			h.corner_uv, h.corner_normal
+		};
+	};
 
-	uint32_t num_faces = static_cast<uint32_t>(faces_.size());
-	const bool add_corner_normals = corner_normal_idxs.size() >= num_faces;
-	const bool add_corner_uvs = corner_uv_idxs.size() >= num_faces;
-	//helper to add a face (and, later, boundary):
-	auto add_loop = [&](std::vector< Index > const &loop, bool boundary,
-					    std::vector< Index> const &n_loop = std::vector<Index>{}, 
-						std::vector< Index> const &uv_loop = std::vector<Index>{}) {
-		assert(loop.size() >= 3);
-		
-		for (uint32_t j = 0; j < loop.size(); ++j) {
-			//omit adding a face with vertices of the same index, otherwise crashes on cylinder/cone
-			if (loop[j] == loop[(j + 1) % loop.size()]) { return; }
-		}
-
-		FaceRef face = mesh.emplace_face(boundary);
-		HalfedgeRef prev = mesh.halfedges.end(); //keep track of previous edge around face to set next pointer
-		for (uint32_t i = 0; i < loop.size(); ++i) {
-			Index a = loop[i];
-			Index b = loop[(i + 1) % loop.size()];
-			assert(a != b);
-
-			HalfedgeRef halfedge = mesh.emplace_halfedge();
-			if (i == 0) face->halfedge = halfedge; //store first edge as face's halfedge pointer
-			halfedge->vertex = vertices[a];
-
-			//if first to mention vertex, set vertex's halfedge pointer:
-			if (vertices[a]->halfedge == mesh.halfedges.end()) {
-				assert(!boundary); //boundary faces should never be mentioning novel vertices, since they are created second
-				vertices[a]->halfedge = halfedge;
+	Delta delta;
+	delta.next_id = from.next_id;
+
+	auto diff_list = [&](auto const &from_refs, auto const &to_refs, auto const &state_of, auto &changes) {
+		//states of elements that are new or changed:
+		for (auto const &e : from_refs) {
+			auto state = state_of(from, from_index, *e);
+			uint32_t p = find(e->id, to_refs, to_index);
+			if (p == None || !same_state(state, state_of(to, to_index, *to_refs[p]))) {
+				changes.states.emplace_back(std::move(state));
 			}
-			halfedge->face = face;
-
-			auto inserted = halfedges.emplace(std::make_pair(a,b), halfedge);
-			assert(inserted.second); //if edge mentioned more than once in the same direction, not an oriented, manifold mesh
-
-			auto twin = halfedges.find(std::make_pair(b,a));
-			if (twin == halfedges.end()) {
-				assert(!boundary); //boundary faces exist only to complete edges so should *always* match
-				//not twinned yet -- create an edge just for this halfedge:
-				EdgeRef edge = mesh.emplace_edge(false);
-				halfedge->edge = edge;
-				edge->halfedge = halfedge;
+		}
+
+		//order, by walking the 'to' list and matching it against the 'from' list greedily:
+		// (edits mostly erase elements in place and append new ones, which this encodes compactly)
+		auto step = [&](typename Delta::Order_Step::Kind kind, uint32_t value) {
+			if (kind != Delta::Order_Step::Insert && !changes.order.empty() && changes.order.back().kind == kind) {
+				changes.order.back().value += value;
+			} else {
+				changes.order.emplace_back(Delta::Order_Step{kind, value});
+			}
+		};
+		std::vector< bool > moved(to_refs.size(), false); //'to' elements already inserted earlier in the walk
+		uint32_t i = 0;
+		auto advance = [&]() {
+			while (i < to_refs.size()) {
+				if (moved[i]) ++i;
+				else if (find(to_refs[i]->id, from_refs, from_index) == None) {
+					step(Delta::Order_Step::Skip, 1);
+					++i;
+				} else break;
+			}
+		};
+		for (auto const &e : from_refs) {
+			advance();
+			if (i < to_refs.size() && to_refs[i]->id == e->id) {
+				step(Delta::Order_Step::Keep, 1);
+				++i;
 			} else {
-				//found a twin -- connect twin pointers and reference its edge:
-				assert(twin->second->twin == mesh.halfedges.end());
-				halfedge->twin = twin->second;
-				halfedge->edge = twin->second->edge;
-				twin->second->twin = halfedge;
+				step(Delta::Order_Step::Insert, e->id);
+				uint32_t p = find(e->id, to_refs, to_index);
+				if (p != None) moved[p] = true;
 			}
+		}
+		advance();
+		changes.order.shrink_to_fit();
+	};
+	diff_list(from_index.vertices, to_index.vertices, vertex_state, delta.vertices);
+	diff_list(from_index.edges, to_index.edges, edge_state, delta.edges);
+	diff_list(from_index.faces, to_index.faces, face_state, delta.faces);
+	diff_list(from_index.halfedges, to_index.halfedges, halfedge_state, delta.halfedges);
+
+	if (!linked) return std::nullopt;
+	return delta;
+}
 
-			if (i != 0) prev->next = halfedge; //set previous halfedge's next pointer
-			prev = halfedge;
+void Halfedge_Mesh::apply(Delta const &delta) {
+	constexpr uint32_t None = Delta::None;
 
-			if(add_corner_normals && i < n_loop.size()) halfedge->corner_normal = corner_normals_[n_loop[i]];
-			if(add_corner_uvs && i < uv_loop.size()) halfedge->corner_uv = corner_uvs_[uv_loop[i]];
+	//Mark every id the delta needs a reference to, then find them all in one pass over the lists:
+	std::vector< bool > wanted(std::max(next_id, delta.next_id), false);
+	auto want = [&](uint32_t id) {
+		if (id == None) return;
+		if (id >= wanted.size()) throw std::runtime_error("Halfedge_Mesh::apply: delta mentions id " + std::to_string(id) + " beyond the mesh's next_id.");
+		wanted[id] = true;
+	};
+	auto want_list = [&](auto const &changes) {
+		for (auto const &s : changes.states) {
+			want(s.id);
+		}
+		for (auto const &step : changes.order) {
+			if (step.kind == Delta::Order_Step::Insert) want(step.value);
 		}
+	};
+	want_list(delta.vertices);
+	want_list(delta.edges);
+	want_list(delta.faces);
+	want_list(delta.halfedges);
+	for (auto const &v : delta.vertices.states) {
+		want(v.halfedge);
+	}
+	for (auto const &e : delta.edges.states) {
+		want(e.halfedge);
+	}
+	for (auto const &f : delta.faces.states) {
+		want(f.halfedge);
+	}
+	for (auto const &h : delta.halfedges.states) {
+		want(h.twin); want(h.next); want(h.vertex); want(h.edge); want(h.face);
+	}
 
-		prev->next = face->halfedge; //set next pointer for last halfedge to first edge
+	std::unordered_map< uint32_t, VertexRef > vertex_refs;
+	std::unordered_map< uint32_t, EdgeRef > edge_refs;
+	std::unordered_map< uint32_t, FaceRef > face_refs;
+	std::unordered_map< uint32_t, HalfedgeRef > halfedge_refs;
+	auto find_wanted = [&](auto &list, auto &refs) {
+		for (auto e = list.begin(); e != list.end(); ++e) {
+			if (e->id < wanted.size() && wanted[e->id]) refs.emplace(e->id, e);
+		}
+	};
+	find_wanted(vertices, vertex_refs);
+	find_wanted(edges, edge_refs);
+	find_wanted(faces, face_refs);
+	find_wanted(halfedges, halfedge_refs);
+
+	//elements the delta has states for but this mesh lacks get created (at the end of their lists; reordered below):
+	auto create_missing = [](auto const &changes, auto &refs, auto const &emplace) {
+		for (auto const &s : changes.states) {
+			if (refs.count(s.id)) continue;
+			auto e = emplace();
+			e->id = s.id;
+			refs.emplace(s.id, e);
+		}
+	};
+	create_missing(delta.vertices, vertex_refs, [this]() { return emplace_vertex(); });
+	create_missing(delta.edges, edge_refs, [this]() { return emplace_edge(); });
+	create_missing(delta.faces, face_refs, [this]() { return emplace_face(); });
+	create_missing(delta.halfedges, halfedge_refs, [this]() { return emplace_halfedge(); });
+
+	auto lookup = [](uint32_t id, auto const &refs, auto const &end) {
+		if (id == None) return end;
+		auto found = refs.find(id);
+		if (found == refs.end()) throw std::runtime_error("Halfedge_Mesh::apply: mesh has no element with id " + std::to_string(id) + ".");
+		return found->second;
 	};
 
-	//add all faces:
-	for (uint32_t i = 0; i < num_faces; i++) {
-		if(add_corner_normals && add_corner_uvs) add_loop(faces_[i], false, corner_normal_idxs[i], corner_uv_idxs[i]);
-		else if(add_corner_normals) add_loop(faces_[i], false, corner_normal_idxs[i]);
-		else add_loop(faces_[i], false);
+	for (auto const &s : delta.vertices.states) {
+		VertexRef v = vertex_refs.at(s.id);
+		v->halfedge = lookup(s.halfedge, halfedge_refs, halfedges.end());
+		v->position = s.position;
+		v->bone_weights = s.bone_weights;
+	}
+	for (auto const &s : delta.edges.states) {
+		EdgeRef e = edge_refs.at(s.id);
+		e->halfedge = lookup(s.halfedge, halfedge_refs, halfedges.end());
+		e->sharp = s.sharp;
+	}
+	for (auto const &s : delta.faces.states) {
+		FaceRef f = face_refs.at(s.id);
+		f->halfedge = lookup(s.halfedge, halfedge_refs, halfedges.end());
+		f->boundary = s.boundary;
+	}
+	for (auto const &s : delta.halfedges.states) {
+		HalfedgeRef h = halfedge_refs.at(s.id);
+		h->twin = lookup(s.twin, halfedge_refs, halfedges.end());
+		h->next = lookup(s.next, halfedge_refs, halfedges.end());
+		h->vertex = lookup(s.vertex, vertex_refs, vertices.end());
+		h->edge = lookup(s.edge, edge_refs, edges.end());
+		h->face = lookup(s.face, face_refs, faces.end());
+		h->corner_uv = s.corner_uv;
+		h->corner_normal = s.corner_normal;
 	}
 
-	// All halfedges created so far have valid next pointers, but some may be missing twins because they are at a boundary.
-	
-	std::map< Index, Index > next_on_boundary;
+	//finally, walk the lists to restore order and erase elements 'from' doesn't have:
+	auto reorder = [](auto &list, auto const &order, auto const &refs, auto const &erase) {
+		auto cursor = list.begin();
+		for (auto const &step : order) {
+			if (step.kind == Delta::Order_Step::Insert) {
+				auto e = refs.at(step.value);
+				if (e == cursor) ++cursor;
+				else list.splice(cursor, list, e);
+				continue;
+			}
+			for (uint32_t n = 0; n < step.value; ++n) {
+				if (cursor == list.end()) throw std::runtime_error("Halfedge_Mesh::apply: list is shorter than the delta expects.");
+				auto e = cursor++;
+				if (step.kind == Delta::Order_Step::Skip) erase(e);
+			}
+		}
+		if (cursor != list.end()) throw std::runtime_error("Halfedge_Mesh::apply: list is longer than the delta expects.");
+	};
+	reorder(vertices, delta.vertices.order, vertex_refs, [this](VertexRef v) { erase_vertex(v); });
+	reorder(edges, delta.edges.order, edge_refs, [this](EdgeRef e) { erase_edge(e); });
+	reorder(faces, delta.faces.order, face_refs, [this](FaceRef f) { erase_face(f); });
+	reorder(halfedges, delta.halfedges.order, halfedge_refs, [this](HalfedgeRef h) { erase_halfedge(h); });
+
+	next_id = delta.next_id;
+}
+
+//sort keys (carrying values along) in increasing order; stable, so equal keys keep their relative order:
+// (least-significant-digit radix sort; digits that every key shares are skipped)
+static void radix_sort(std::vector< uint64_t > &keys, std::vector< uint32_t > &values) {
+	assert(keys.size() == values.size());
+	constexpr uint32_t Bits = 16;
+	constexpr uint32_t Buckets = 1u << Bits;
+	constexpr uint32_t Digits = 64 / Bits;
+
+	//count every digit in a single pass:
+	std::vector< uint32_t > counts(Digits * Buckets, 0);
+	for (uint64_t key : keys) {
+		for (uint32_t d = 0; d < Digits; ++d) {
+			counts[d * Buckets + ((key >> (d * Bits)) & (Buckets - 1))] += 1;
+		}
+	}
 
-	//first, look for all un-twinned halfedges to figure out the shape of the boundary:
-	for (auto const &[ from_to, halfedge ] : halfedges) {
-		if (halfedge->twin == mesh.halfedges.end()) {
-			auto ret = next_on_boundary.emplace(from_to.second, from_to.first); //twin needed on the boundary
-			assert(ret.second); //every boundary vertex should have a unique successor because the boundary is "half-disc-like"
+	std::vector< uint64_t > sorted_keys(keys.size());
+	std::vector< uint32_t > sorted_values(values.size());
+	for (uint32_t d = 0; d < Digits; ++d) {
+		uint32_t *offsets = &counts[d * Buckets];
+		//all keys land in one bucket => this pass wouldn't move anything:
+		if (keys.empty() || offsets[(keys[0] >> (d * Bits)) & (Buckets - 1)] == keys.size()) continue;
+
+		uint32_t total = 0;
+		for (uint32_t b = 0; b < Buckets; ++b) {
+			uint32_t count = offsets[b];
+			offsets[b] = total;
+			total += count;
 		}
+		for (size_t i = 0; i < keys.size(); ++i) {
+			uint32_t &at = offsets[(keys[i] >> (d * Bits)) & (Buckets - 1)];
+			sorted_keys[at] = keys[i];
+			sorted_values[at] = values[i];
+			++at;
+		}
+		keys.swap(sorted_keys);
+		values.swap(sorted_values);
 	}
+}
+
+Halfedge_Mesh Halfedge_Mesh::from_flat_faces(std::vector< Vec3 > const &vertices_,
+		std::vector< Index > const &face_begin,
+		std::vector< Index > const &face_vertices,
+		std::vector< Vec3 > const &corner_normals,
+		std::vector< Vec2 > const &corner_uvs)
+{
+	assert(!face_begin.empty() && face_begin.back() == face_vertices.size());
+	assert(corner_normals.empty() || corner_normals.size() == face_vertices.size());
+	assert(corner_uvs.empty() || corner_uvs.size() == face_vertices.size());
+
+	//Everything is worked out on index arrays first (halfedges numbered in the order they are created);
+	// element lists are only built once the connectivity is known to be sound.
+
+	auto fail = [](std::string const &message) {
+		throw std::runtime_error("Halfedge_Mesh from_indexed_faces: " + message);
+	};
+
+	constexpr Index None = ~Index(0);
+	Index num_vertices = Index(vertices_.size());
+
+	//--- non-boundary halfedges: one per corner of every face ---
 
-	//now pull out boundary loops until all edges are exhausted:
-	while (!next_on_boundary.empty()) {
-		std::vector< Index > loop;
-		loop.emplace_back(next_on_boundary.begin()->first);
+	std::vector< Index > from; //vertex each halfedge leaves
+	std::vector< Index > corner; //face_vertices[] corner each (non-boundary) halfedge came from
+	std::vector< Index > loop_begin{0}; //face f is halfedges [loop_begin[f], loop_begin[f+1])
+	from.reserve(face_vertices.size());
+	corner.reserve(face_vertices.size());
+	loop_begin.reserve(face_begin.size());
 
+	for (Index f = 0; f + 1 < face_begin.size(); ++f) {
+		Index begin = face_begin[f];
+		Index end = face_begin[f + 1];
+		if (end - begin < 3) fail("face " + std::to_string(f) + " has " + std::to_string(end - begin) + " (< 3) vertices.");
+
+		bool repeats = false;
+		for (Index c = begin; c < end; ++c) {
+			if (face_vertices[c] >= num_vertices) fail("face " + std::to_string(f) + " references vertex " + std::to_string(face_vertices[c]) + ", which doesn't exist.");
+			if (face_vertices[c] == face_vertices[c + 1 < end ? c + 1 : begin]) repeats = true;
+		}
+		//omit adding a face with vertices of the same index, otherwise crashes on cylinder/cone
+		if (repeats) continue;
+
+		for (Index c = begin; c < end; ++c) {
+			from.emplace_back(face_vertices[c]);
+			corner.emplace_back(c);
+		}
+		loop_begin.emplace_back(Index(from.size()));
+	}
+
+	Index num_faces = Index(loop_begin.size()) - 1;
+	Index num_inner = Index(from.size());
+
+	std::vector< Index > next(num_inner); //next halfedge around the face
+	std::vector< Index > face(num_inner); //face (index into loop_begin) of each halfedge
+	parallel_for(num_faces, [&](uint32_t begin, uint32_t end) {
+		for (Index f = begin; f < end; ++f) {
+			for (Index h = loop_begin[f]; h < loop_begin[f + 1]; ++h) {
+				next[h] = (h + 1 < loop_begin[f + 1] ? h + 1 : loop_begin[f]);
+				face[h] = f;
+			}
+		}
+	});
+
+	//--- twins: sort halfedges by (unordered) vertex pair, so both halves of an edge end up side-by-side ---
+
+	std::vector< uint64_t > keys(num_inner);
+	std::vector< Index > by_key(num_inner);
+	parallel_for(num_inner, [&](uint32_t begin, uint32_t end) {
+		for (Index h = begin; h < end; ++h) {
+			Index a = from[h];
+			Index b = from[next[h]];
+			keys[h] = (uint64_t(std::min(a, b)) << 32) | uint64_t(std::max(a, b));
+			by_key[h] = h;
+		}
+	});
+	radix_sort(keys, by_key);
+
+	std::vector< Index > twin(num_inner, None);
+	std::vector< uint8_t > makes_edge(num_inner, 0); //an edge is created along with the first halfedge to mention it
+	for (Index i = 0; i < num_inner; ) {
+		Index j = i + 1;
+		while (j < num_inner && keys[j] == keys[i]) ++j;
+
+		Index h = by_key[i]; //(sort is stable, so this is the first mention)
+		makes_edge[h] = 1;
+		if (j - i == 2) {
+			Index t = by_key[i + 1];
+			if (from[h] == from[t]) {
+				fail("edge from vertex " + std::to_string(from[h]) + " to vertex " + std::to_string(from[next[h]]) + " is mentioned more than once in the same direction (faces are not consistently oriented).");
+			}
+			twin[h] = t;
+			twin[t] = h;
+		} else if (j - i > 2) {
+			fail("edge between vertex " + std::to_string(keys[i] >> 32) + " and vertex " + std::to_string(keys[i] & 0xffffffff) + " is shared by " + std::to_string(j - i) + " (> 2) faces.");
+		}
+		i = j;
+	}
+	keys = std::vector< uint64_t >();
+	by_key = std::vector< Index >();
+
+	//--- boundary: halfedges without twins, chained into loops ---
+
+	//un-twinned halfedge arriving at each vertex:
+	std::vector< Index > arriving(num_vertices, None);
+	for (Index h = 0; h < num_inner; ++h) {
+		if (twin[h] != None) continue;
+		Index &slot = arriving[from[next[h]]];
+		//every boundary vertex should have a unique successor because the boundary is "half-disc-like"
+		if (slot != None) fail("vertex " + std::to_string(from[next[h]]) + " is on the boundary more than once.");
+		slot = h;
+	}
+
+	//boundary faces follow the un-twinned halfedges backward, starting from the lowest-numbered boundary vertex:
+	std::vector< Index > boundary_begin{num_inner}; //boundary face b is halfedges [boundary_begin[b], boundary_begin[b+1])
+	for (Index start = 0; start < num_vertices; ++start) {
+		if (arriving[start] == None) continue;
+		Index at = start;
 		do {
-			//look up next hop on the boundary:
-			auto next = next_on_boundary.find(loop.back());
+			Index t = arriving[at];
 			//should never be dead ends on boundary:
-			assert(next != next_on_boundary.end());
+			if (t == None) fail("boundary through vertex " + std::to_string(at) + " does not form a loop.");
+			arriving[at] = None;
+
+			Index h = Index(from.size());
+			from.emplace_back(at);
+			twin.emplace_back(t);
+			twin[t] = h;
+			at = from[t];
+		} while (at != start);
+
+		Index begin = boundary_begin.back();
+		Index end = Index(from.size());
+		if (end - begin < 3) fail("boundary through vertex " + std::to_string(start) + " has " + std::to_string(end - begin) + " (< 3) vertices.");
+		for (Index h = begin; h < end; ++h) {
+			next.emplace_back(h + 1 < end ? h + 1 : begin);
+			face.emplace_back(num_faces + Index(boundary_begin.size()) - 1);
+		}
+		boundary_begin.emplace_back(end);
+	}
 
-			//add next hop to loop:
-			loop.emplace_back(next->second);
-			//...and remove from nexts structure:
-			next_on_boundary.erase(next);
-		} while (loop[0] != loop.back());
+	Index num_halfedges = Index(from.size());
 
-		loop.pop_back(); //remove duplicated first/last element
+	//each vertex's halfedge is the first to leave it:
+	std::vector< Index > leaving(num_vertices, None);
+	for (Index h = num_inner; h-- > 0; ) {
+		leaving[from[h]] = h;
+	}
 
-		assert(loop.size() >= 3); //all faces must be non-degenerate
+	//--- create elements, in the order (and so with the ids) that adding faces one at a time would ---
 
-		//add boundary loop:
-		add_loop(loop, true);
+	Halfedge_Mesh mesh;
+
+	std::vector< VertexRef > vertices;
+	vertices.reserve(num_vertices);
+	for (Vec3 const &position : vertices_) {
+		vertices.emplace_back(mesh.emplace_vertex());
+		vertices.back()->position = position;
 	}
 
+	std::vector< FaceRef > faces;
+	std::vector< HalfedgeRef > halfedges;
+	std::vector< EdgeRef > edges(num_inner, mesh.edges.end()); //edges, indexed by the halfedge that made them
+	faces.reserve(num_faces + boundary_begin.size() - 1);
+	halfedges.reserve(num_halfedges);
+
+	for (Index f = 0; f < num_faces; ++f) {
+		faces.emplace_back(mesh.emplace_face(false));
+		for (Index h = loop_begin[f]; h < loop_begin[f + 1]; ++h) {
+			halfedges.emplace_back(mesh.emplace_halfedge());
+			if (makes_edge[h]) edges[h] = mesh.emplace_edge(false);
+		}
+	}
+	for (Index b = 0; b + 1 < boundary_begin.size(); ++b) {
+		faces.emplace_back(mesh.emplace_face(true));
+		for (Index h = boundary_begin[b]; h < boundary_begin[b + 1]; ++h) {
+			halfedges.emplace_back(mesh.emplace_halfedge());
+		}
+	}
+
+	//--- connect everything (each element is written by exactly one range, so this can be split freely) ---
+
+	parallel_for(num_halfedges, [&](uint32_t begin, uint32_t end) {
+		for (Index h = begin; h < end; ++h) {
+			HalfedgeRef halfedge = halfedges[h];
+			Index e = (h < num_inner && makes_edge[h] ? h : twin[h]);
+			halfedge->set_tnvef(halfedges[twin[h]], halfedges[next[h]], vertices[from[h]], edges[e], faces[face[h]]);
+			if (e == h) edges[e]->halfedge = halfedge;
+			if (h < num_inner) {
+				if (!corner_normals.empty()) halfedge->corner_normal = corner_normals[corner[h]];
+				if (!corner_uvs.empty()) halfedge->corner_uv = corner_uvs[corner[h]];
+			}
+		}
+	});
+
+	parallel_for(Index(faces.size()), [&](uint32_t begin, uint32_t end) {
+		for (Index f = begin; f < end; ++f) {
+			faces[f]->halfedge = halfedges[f < num_faces ? loop_begin[f] : boundary_begin[f - num_faces]];
+		}
+	});
+
+	parallel_for(num_vertices, [&](uint32_t begin, uint32_t end) {
+		for (Index v = begin; v < end; ++v) {
+			if (leaving[v] != None) vertices[v]->halfedge = halfedges[leaving[v]];
+		}
+	});
+
 	//with boundary faces created, mesh should be ready to go with all edges nicely twinned.
 
 	//PARANOIA: this should never happen:
@@ -866,6 +1890,40 @@ Halfedge_Mesh Halfedge_Mesh::from_indexed_faces(std::vector< Vec3 > const &verti
 	return mesh;
 }
 
+Halfedge_Mesh Halfedge_Mesh::from_indexed_faces(std::vector< Vec3 > const &vertices_, 
+		std::vector< std::vector< Index > > const &faces_,
+		std::vector< std::vector< Index > > const &corner_normal_idxs,
+		std::vector< std::vector< Index > > const &corner_uv_idxs,
+		std::vector<Vec3> const &corner_normals_,
+		std::vector<Vec2> const &corner_uvs_)
+{
+	uint32_t num_faces = static_cast<uint32_t>(faces_.size());
+	const bool add_corner_normals = corner_normal_idxs.size() >= num_faces;
+	//(corner uvs are only used along with corner normals)
+	const bool add_corner_uvs = add_corner_normals && corner_uv_idxs.size() >= num_faces;
+
+	//flatten faces (and corner data, where given):
+	std::vector< Index > face_begin{0};
+	std::vector< Index > face_vertices;
+	std::vector< Vec3 > corner_normals;
+	std::vector< Vec2 > corner_uvs;
+	face_begin.reserve(num_faces + 1);
+	for (uint32_t i = 0; i < num_faces; ++i) {
+		for (uint32_t j = 0; j < faces_[i].size(); ++j) {
+			face_vertices.emplace_back(faces_[i][j]);
+			if (add_corner_normals) {
+				corner_normals.emplace_back(j < corner_normal_idxs[i].size() ? corner_normals_[corner_normal_idxs[i][j]] : Vec3(0.0f, 0.0f, 0.0f));
+			}
+			if (add_corner_uvs) {
+				corner_uvs.emplace_back(j < corner_uv_idxs[i].size() ? corner_uvs_[corner_uv_idxs[i][j]] : Vec2(0.0f, 0.0f));
+			}
+		}
+		face_begin.emplace_back(Index(face_vertices.size()));
+	}
+
+	return from_flat_faces(vertices_, face_begin, face_vertices, corner_normals, corner_uvs);
+}
+
 Halfedge_Mesh Halfedge_Mesh::from_indexed_mesh_with_corner_data(
 		const Indexed_Mesh& indexed_mesh, 
 		std::vector<Index> const &corner_normal_idxs_,  
@@ -881,32 +1939,35 @@ Halfedge_Mesh Halfedge_Mesh::from_indexed_mesh_with_corner_data(
 		indexed_vertices.emplace_back(v.pos);
 	}
 
-	std::vector< std::vector< Index > > indexed_faces;
-	assert(indexed_mesh.indices().size() % 3 == 0);
-	indexed_faces.reserve(indexed_mesh.indices().size() / 3);
-	for (uint32_t i = 0; i < indexed_mesh.indices().size(); i += 3) {
-		indexed_faces.emplace_back(indexed_mesh.indices().begin() + i, indexed_mesh.indices().begin() + i + 3);
-	}
-
-	std::vector< std::vector < Index > > indexed_normals;
+	std::vector< Index > const &indices = indexed_mesh.indices();
+	assert(indices.size() % 3 == 0);
 	assert(corner_normal_idxs_.size() % 3 == 0);
-	indexed_normals.reserve(corner_normal_idxs_.size() / 3);
-	for (uint32_t i = 0; i < corner_normal_idxs_.size(); i += 3) {
-		indexed_normals.emplace_back(corner_normal_idxs_.begin() + i, corner_normal_idxs_.begin() + i + 3);
+	assert(corner_uv_idxs_.size() % 3 == 0);
+
+	std::vector< Index > face_begin;
+	face_begin.reserve(indices.size() / 3 + 1);
+	for (uint32_t i = 0; i <= indices.size(); i += 3) {
+		face_begin.emplace_back(i);
 	}
 
-	std::vector< std::vector < Index > > indexed_uvs;
-	assert(corner_uv_idxs_.size() % 3 == 0);
-	indexed_uvs.reserve(corner_uv_idxs_.size() / 3);
-	for (uint32_t i = 0; i < corner_uv_idxs_.size(); i += 3) {
-		indexed_uvs.emplace_back(corner_uv_idxs_.begin() + i, corner_uv_idxs_.begin() + i + 3);
+	//corner data is used if given for every triangle (and uvs only along with normals):
+	std::vector< Vec3 > corner_normals;
+	std::vector< Vec2 > corner_uvs;
+	if (corner_normal_idxs_.size() >= indices.size()) {
+		corner_normals.reserve(indices.size());
+		for (uint32_t i = 0; i < indices.size(); ++i) {
+			corner_normals.emplace_back(normals_[corner_normal_idxs_[i]]);
+		}
+		if (corner_uv_idxs_.size() >= indices.size()) {
+			corner_uvs.reserve(indices.size());
+			for (uint32_t i = 0; i < indices.size(); ++i) {
+				corner_uvs.emplace_back(uvs_[corner_uv_idxs_[i]]);
+			}
+		}
 	}
 
 	//build halfedge mesh with the extracted vertex/face data:
-	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_faces(indexed_vertices, 
-			indexed_faces, indexed_normals, indexed_uvs, normals_, uvs_);
-
-	return mesh;
+	return from_flat_faces(indexed_vertices, face_begin, indices, corner_normals, corner_uvs);
 }
 
 Halfedge_Mesh Halfedge_Mesh::from_indexed_mesh(Indexed_Mesh const &indexed_mesh) {
@@ -918,36 +1979,27 @@ Halfedge_Mesh Halfedge_Mesh::from_indexed_mesh(Indexed_Mesh const &indexed_mesh)
 		indexed_vertices.emplace_back(v.pos);
 	}
 
-	std::vector< std::vector< Index > > indexed_faces;
-	assert(indexed_mesh.indices().size() % 3 == 0);
-	indexed_faces.reserve(indexed_mesh.indices().size() / 3);
-	for (uint32_t i = 0; i < indexed_mesh.indices().size(); i += 3) {
-		indexed_faces.emplace_back(indexed_mesh.indices().begin() + i, indexed_mesh.indices().begin() + i + 3);
-	}
-
-	//build halfedge mesh with the extracted vertex/face data:
-	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_faces(indexed_vertices, indexed_faces);
-
-	//now copy corner data:
-	auto indexed_vertex = indexed_mesh.vertices().begin();
-	for (auto vertex = mesh.vertices.begin(); vertex != mesh.vertices.end(); ++vertex) {
-		assert(indexed_vertex != indexed_mesh.vertices().end());
+	std::vector< Index > const &indices = indexed_mesh.indices();
+	assert(indices.size() % 3 == 0);
 
-		HalfedgeRef h = vertex->halfedge;
-		do {
-			if (!h->face->boundary) {
-				h->corner_normal = indexed_vertex->norm;
-				h->corner_uv = indexed_vertex->uv;
-			}
-			h = h->twin->next;
-		} while (h != vertex->halfedge);
-		//copy data from indexed_vertex -> all (non-boundary) halfedges in vertex->halfedge star.
+	std::vector< Index > face_begin;
+	face_begin.reserve(indices.size() / 3 + 1);
+	for (uint32_t i = 0; i <= indices.size(); i += 3) {
+		face_begin.emplace_back(i);
+	}
 
-		++indexed_vertex;
+	//every (non-boundary) corner takes its data from the indexed vertex it was made from:
+	std::vector< Vec3 > corner_normals(indices.size());
+	std::vector< Vec2 > corner_uvs(indices.size());
+	for (uint32_t i = 0; i < indices.size(); ++i) {
+		if (indices[i] >= indexed_mesh.vertices().size()) continue; //(from_flat_faces will complain)
+		Indexed_Mesh::Vert const &v = indexed_mesh.vertices()[indices[i]];
+		corner_normals[i] = v.norm;
+		corner_uvs[i] = v.uv;
 	}
-	assert(indexed_vertex == indexed_mesh.vertices().end());
 
-	return mesh;
+	//build halfedge mesh with the extracted vertex/face data:
+	return from_flat_faces(indexed_vertices, face_begin, indices, corner_normals, corner_uvs);
 }
 
 Halfedge_Mesh Halfedge_Mesh::cube(float r) {
@@ -17,6 +17,7 @@
  *
  */
 
+#include <functional>
 #include <list>
 #include <optional>
 #include <set>
@@ -26,6 +27,7 @@
 #include <unordered_map>
 
 #include "../lib/mathlib.h"
+#include "element_arena.h"
 
 class Indexed_Mesh;
 
@@ -40,15 +42,22 @@ public:
 	class Face;
 	class Halfedge;
 
+	/*
+	 * Elements are stored in lists whose nodes come from a per-mesh arena
+	 * (see element_arena.h); otherwise they behave just like std::list.
+	 */
+	template< typename T >
+	using Element_List = std::list< T, Arena_Allocator< T > >;
+
 	/*
 	 * Rather than using raw pointers to mesh elements, we store references
 	 * as iterators. For convenience, we give shorter names to these
 	 * iterators (e.g., EdgeRef instead of list<Edge>::iterator).
 	 */
-	using VertexRef = std::list<Vertex>::iterator;
-	using EdgeRef = std::list<Edge>::iterator;
-	using FaceRef = std::list<Face>::iterator;
-	using HalfedgeRef = std::list<Halfedge>::iterator;
+	using VertexRef = Element_List<Vertex>::iterator;
+	using EdgeRef = Element_List<Edge>::iterator;
+	using FaceRef = Element_List<Face>::iterator;
+	using HalfedgeRef = Element_List<Halfedge>::iterator;
 
 	/* This is a special kind of reference that can refer to any of the four
 	   element types. */
@@ -60,10 +69,10 @@ public:
 	    used so frequently, we will use "CRef" as a shorthand abbreviation for
 	    "constant iterator."
 	*/
-	using VertexCRef = std::list<Vertex>::const_iterator;
-	using EdgeCRef = std::list<Edge>::const_iterator;
-	using FaceCRef = std::list<Face>::const_iterator;
-	using HalfedgeCRef = std::list<Halfedge>::const_iterator;
+	using VertexCRef = Element_List<Vertex>::const_iterator;
+	using EdgeCRef = Element_List<Edge>::const_iterator;
+	using FaceCRef = Element_List<Face>::const_iterator;
+	using HalfedgeCRef = Element_List<Halfedge>::const_iterator;
 	using ElementCRef = std::variant<VertexCRef, EdgeCRef, HalfedgeCRef, FaceCRef>;
 
 	//////////////////////////////////////////////////////////////////////////////////////////
@@ -170,6 +179,7 @@ public:
 		float shorter_factor = 0.8f; //edges shorter than shorter_factor * target_length are collapsed
 		uint32_t smoothing_iterations = 10; //how many tangential smoothing iterations to run
 		float smoothing_step = 0.2f; //amount to interpolate vertex positions toward their centroid each smoothing step
+		bool preserve_features = false; //keep vertices on sharp or boundary edges in place when smoothing
 	};
 	void isotropic_remesh(Isotropic_Remesh_Parameters const &params);
 
@@ -188,6 +198,18 @@ public:
 		std::unordered_map< FaceCRef, Vec3 > const &face_vertex_positions //where to place the center-of-face vertices
 	);
 
+	//call body(begin, end) on ranges covering [0, count), in parallel on a shared thread pool:
+	// (returns once every range is done; rethrows the first exception thrown by body)
+	// (a parallel_for called from inside body runs serially on the calling thread, since waiting
+	//  on the pool from one of its own workers could deadlock)
+	static void parallel_for(uint32_t count, std::function< void(uint32_t, uint32_t) > const &body);
+
+	//tangential smoothing (e.g., for isotropic_remesh):
+	// moves every vertex toward the centroid of its neighbors, within its tangent plane, by 'step' of the distance.
+	// repeated 'iterations' times; every vertex moves at once each iteration (Jacobi-style), in parallel.
+	// if preserve_features is set, vertices on sharp or boundary edges stay put.
+	void smooth_tangentially(float step, uint32_t iterations, bool preserve_features = false);
+
 	//re-orients every face in the mesh by flipping halfedge directions.
 	// no elements are created or erased; only Halfedge::next, Halfedge::vertex, and Vertex::halfedge pointers are changed.
 	void flip_orientation();
@@ -363,13 +385,41 @@ public:
 	void erase_face(FaceRef f);
 	void erase_halfedge(HalfedgeRef h);
 
+	//a Handle is a reference plus the id its element had when the handle was made;
+	// ids are never handed out twice (emplace_* takes a fresh id even when it recycles an
+	// erased element's node), so the id works as a generation count: once the element is
+	// erased, or its node is recycled, the handle no longer matches.
+	// (apply() brings elements back with their old ids, so handles to them match again)
+	template< typename Ref >
+	struct Handle {
+		Ref ref;
+		uint32_t id;
+		//is ref still the element the handle was made for?
+		// (reads ref->id, so only call while ref's arena is alive; resolve() also checks the arena)
+		bool live() const {
+			return ref->id == id;
+		}
+	};
+	template< typename Ref >
+	static Handle< Ref > handle(Ref ref) {
+		return Handle< Ref >{ref, ref->id};
+	}
+	//the element 'handle' refers to, if it is still in this mesh:
+	// (ref is only followed once it is known to point into this mesh's arena)
+	template< typename Ref >
+	std::optional< Ref > resolve(Handle< Ref > const &handle) const {
+		Element_Arena const *arena = vertices.get_allocator().arena.get();
+		if (!arena || !arena->owns(&*handle.ref) || !handle.live()) return std::nullopt;
+		return handle.ref;
+	}
+
 	//elements are held in these lists:
 	//Don't add/erase elements from these lists directly!
 	// Use the emplace and erase functions above.
-	std::list<Vertex> vertices;
-	std::list<Edge> edges;
-	std::list<Face> faces;
-	std::list<Halfedge> halfedges;
+	Element_List<Vertex> vertices;
+	Element_List<Edge> edges;
+	Element_List<Face> faces;
+	Element_List<Halfedge> halfedges;
 
 	/* element lists usage example:
 
@@ -406,8 +456,18 @@ public:
 	// - edges are not orphaned (they have at least one non-boundary face adjacent)
 	// - faces are simple (touch each vertex / edge at most once)
 	// - data stored on elements is valid (i.e., non-infinite, non-NaN) (this is a relatively weak condition)
+	// (checks run in parallel; the problem reported is the same one checking element-by-element would find first)
 	std::optional<std::pair<ElementCRef, std::string>> validate() const;
 
+	/// Check the same conditions, but only in the neighborhood of some elements:
+	// - covers the faces around every vertex of (or, for faces, on) the given elements
+	// - meant for checking the result of a local operation (flip_edge, collapse_edge, ...);
+	//   cost depends on the size of the neighborhood, not the mesh
+	// - references to erased elements and into other meshes are caught, but elements that are still in
+	//   the lists yet no longer connected to the neighborhood (e.g., an edge an operation forgot to erase)
+	//   are not -- use validate() for that
+	std::optional<std::pair<ElementCRef, std::string>> validate_local(std::vector< ElementCRef > const &around) const;
+
 
 
 
@@ -415,7 +475,7 @@ public:
 	// Internal Methods -- you don't need to use these
 	//////////////////////////////////////////////////////////////////////////////////////////
 
-	Halfedge_Mesh() = default;
+	Halfedge_Mesh(); //(empty mesh with its own element arena)
 	~Halfedge_Mesh() = default;
 
 	using Index = uint32_t; //to distinguish indices from sizes
@@ -424,6 +484,8 @@ public:
 	// - mesh must correspond to a valid halfedge mesh (see 'validate()')
 	// - vertices and faces will match the order they appear in vertices[] and faces[], respectively
 	// - halfedges will match the order they are mentioned in faces[]
+	// - faces that repeat a vertex consecutively are skipped
+	// - throws std::runtime_error if faces share an edge in a way no oriented, manifold mesh could
 	//static Halfedge_Mesh from_indexed_faces(std::vector< Vec3 > const &vertices, std::vector< std::vector< Index > > const &faces);
 	static Halfedge_Mesh from_indexed_faces(std::vector< Vec3 > const &vertices, 
 		std::vector< std::vector< Index > > const &faces, 
@@ -459,7 +521,65 @@ public:
 	Halfedge_Mesh(const Halfedge_Mesh& src) = delete;
 	void operator=(const Halfedge_Mesh& src) = delete;
 
-	
+	//A Delta records just the elements (by id) that differ between two states of a mesh,
+	// so (e.g.) an undo history needn't keep a whole copy of the mesh for every edit:
+	struct Delta {
+		static constexpr uint32_t None = -1U; //id used for links to end()
+
+		//element states in the 'from' mesh, with links stored as ids:
+		struct Vertex_State {
+			uint32_t id, halfedge;
+			Vec3 position;
+			std::vector< Vertex::Bone_Weight > bone_weights;
+		};
+		struct Edge_State {
+			uint32_t id, halfedge;
+			bool sharp;
+		};
+		struct Face_State {
+			uint32_t id, halfedge;
+			bool boundary;
+		};
+		struct Halfedge_State {
+			uint32_t id, twin, next, vertex, edge, face;
+			Vec2 corner_uv;
+			Vec3 corner_normal;
+		};
+
+		//list order, as a walk over the 'to' list:
+		// Keep: leave the next 'value' elements in place
+		// Skip: erase the next 'value' elements (they aren't in 'from')
+		// Insert: move the element with id 'value' here (from later in the list, or from the end if it is new)
+		struct Order_Step {
+			enum Kind : uint8_t { Keep, Skip, Insert } kind;
+			uint32_t value;
+		};
+
+		template< typename State >
+		struct List_Changes {
+			std::vector< State > states; //elements that are new or changed in 'from'
+			std::vector< Order_Step > order;
+		};
+		List_Changes< Vertex_State > vertices;
+		List_Changes< Edge_State > edges;
+		List_Changes< Face_State > faces;
+		List_Changes< Halfedge_State > halfedges;
+
+		uint32_t next_id = 0;
+
+		size_t bytes() const; //(approximate) memory used by the delta
+	};
+
+	//record what it takes to turn 'to' back into 'from':
+	// - data is compared bitwise, so applying the delta restores 'from' exactly (ids, list order, and next_id included)
+	// - returns std::nullopt if either mesh's ids aren't unique or a link points outside its mesh
+	static std::optional< Delta > diff(Halfedge_Mesh const &from, Halfedge_Mesh const &to);
+
+	//turn a mesh in a delta's 'to' state into its 'from' state:
+	// - throws std::runtime_error if the delta mentions an element this mesh doesn't have (leaving the mesh in an undefined state)
+	void apply(Delta const &delta);
+
+
 	//--- generic element helpers used by the gui ---
 
 
@@ -476,15 +596,41 @@ public:
 	static ElementCRef const_from(ElementRef elem);
 
 private:
-	
+	//all of a mesh's lists must share an arena, so nodes can be spliced between them:
+	explicit Halfedge_Mesh(std::shared_ptr< Element_Arena > const &arena);
+
+	//position of every element in its list, by id; returns false if ids aren't unique and less than next_id:
+	bool positions_by_id(std::vector< uint32_t > &id_position) const;
+
+	//catmark_subdivide_helper(), with positions flattened by the element's position in its list
+	// (i.e., edge_vertex_positions[i] is for the i-th element of 'edges'); entries for boundary faces are ignored:
+	void catmark_subdivide_helper(
+		std::vector< Vec3 > const &vertex_positions,
+		std::vector< Vec3 > const &edge_vertex_positions,
+		std::vector< Vec3 > const &face_vertex_positions
+	);
+
+	//copy() that remaps links through address maps (used if element ids aren't unique):
+	Halfedge_Mesh copy_by_address() const;
+
+	//validate() that checks references with address sets (used if element ids aren't unique):
+	std::optional<std::pair<ElementCRef, std::string>> validate_by_address() const;
+
+	//from_indexed_faces() and friends, with faces flattened:
+	// - face f has corners [face_begin[f], face_begin[f+1]) of face_vertices
+	// - corner_normals / corner_uvs are either empty or hold a value for every corner
+	static Halfedge_Mesh from_flat_faces(std::vector< Vec3 > const &vertices,
+		std::vector< Index > const &face_begin, std::vector< Index > const &face_vertices,
+		std::vector< Vec3 > const &corner_normals, std::vector< Vec2 > const &corner_uvs);
+
 	//a fresh element id; assigned + incremented by emplace_*() functions:
 	uint32_t next_id = 0;
 
 	//free lists used by the erase() and emplace_*() functions:
-	std::list<Vertex> free_vertices;
-	std::list<Edge> free_edges;
-	std::list<Face> free_faces;
-	std::list<Halfedge> free_halfedges;
+	Element_List<Vertex> free_vertices;
+	Element_List<Edge> free_edges;
+	Element_List<Face> free_faces;
+	Element_List<Halfedge> free_halfedges;
 
 	friend class Test;
 };
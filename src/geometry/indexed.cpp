@@ -1,8 +1,248 @@
 
 #include "indexed.h"
 #include "halfedge.h"
+#include "compiled.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+//bit pattern of a float (so welding compares exactly, and -0.0f and 0.0f stay apart):
+uint32_t bits(float f) {
+	uint32_t b;
+	std::memcpy(&b, &f, sizeof(b));
+	return b;
+}
+
+/*
+ * Triangle order for vertex cache locality, using "Tipsify" from:
+ *   Sander, Nehab, and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007.
+ * The walk fans around one vertex at a time, moving to the neighbor that will still be in
+ * a cache of 'cache_size' vertices when its remaining triangles are emitted.
+ * Returns triangles (indexes into indices / 3) in their new order.
+ */
+std::vector< uint32_t > tipsify(std::vector< Indexed_Mesh::Index > const &indices, uint32_t vertex_count, uint32_t cache_size) {
+	uint32_t triangles = uint32_t(indices.size() / 3);
+
+	//triangles around each vertex, and how many of them are still to be emitted ("live"):
+	std::vector< uint32_t > live(vertex_count, 0);
+	for (Indexed_Mesh::Index i : indices) live[i] += 1;
+	std::vector< uint32_t > adjacent_begin(vertex_count + 1, 0);
+	for (uint32_t v = 0; v < vertex_count; ++v) adjacent_begin[v + 1] = adjacent_begin[v] + live[v];
+	std::vector< uint32_t > adjacent(indices.size());
+	{
+		std::vector< uint32_t > at(adjacent_begin.begin(), adjacent_begin.end() - 1);
+		for (uint32_t i = 0; i < indices.size(); ++i) {
+			adjacent[at[indices[i]]++] = i / 3;
+		}
+	}
+
+	std::vector< uint32_t > cache_time(vertex_count, 0); //when each vertex last entered the cache
+	std::vector< uint8_t > emitted(triangles, 0);
+	std::vector< uint32_t > dead_end; //recently used vertices, to restart from when the fan runs out
+	std::vector< uint32_t > candidates;
+	std::vector< uint32_t > order;
+	order.reserve(triangles);
+
+	uint32_t time = cache_size + 1;
+	uint32_t cursor = 0; //vertices before this have no live triangles
+	constexpr uint32_t None = -1U;
+	uint32_t fan = (vertex_count > 0 ? 0 : None);
+	while (fan != None) {
+		//emit all live triangles around the fanning vertex:
+		candidates.clear();
+		for (uint32_t a = adjacent_begin[fan]; a < adjacent_begin[fan + 1]; ++a) {
+			uint32_t t = adjacent[a];
+			if (emitted[t]) continue;
+			emitted[t] = 1;
+			order.emplace_back(t);
+			for (uint32_t k = 0; k < 3; ++k) {
+				uint32_t v = indices[3 * t + k];
+				dead_end.emplace_back(v);
+				candidates.emplace_back(v);
+				live[v] -= 1;
+				if (time - cache_time[v] > cache_size) {
+					cache_time[v] = time;
+					time += 1;
+				}
+			}
+		}
+
+		//next fan is the candidate that has been in the cache longest, but won't fall out before it is done:
+		fan = None;
+		uint32_t best = 0;
+		for (uint32_t v : candidates) {
+			if (live[v] == 0) continue;
+			uint32_t priority = 0;
+			if (time - cache_time[v] + 2 * live[v] <= cache_size) priority = time - cache_time[v];
+			if (fan == None || priority > best) {
+				best = priority;
+				fan = v;
+			}
+		}
+
+		//no candidates? back up through recently used vertices, then scan for any vertex with live triangles:
+		while (fan == None && !dead_end.empty()) {
+			uint32_t v = dead_end.back();
+			dead_end.pop_back();
+			if (live[v] > 0) fan = v;
+		}
+		while (fan == None && cursor < vertex_count) {
+			if (live[cursor] > 0) fan = cursor;
+			else ++cursor;
+		}
+	}
+	assert(order.size() == triangles);
+	return order;
+}
+
+
+//WeldCorners conversion (see Indexed_Mesh::SplitOrAverage), which needs corners grouped by vertex:
+Indexed_Mesh weld_corners(Compiled_Mesh const &compiled) {
+	std::vector<Indexed_Mesh::Vert> verts;
+	std::vector<Indexed_Mesh::Index> idxs;
+
+	uint32_t faces = compiled.faces();
+
+	//where each (non-boundary) face's corners and triangles start in the output:
+	std::vector< uint32_t > corners_begin(faces + 1);
+	std::vector< uint32_t > idxs_begin(faces + 1);
+	corners_begin[0] = idxs_begin[0] = 0;
+	for (uint32_t f = 0; f < faces; ++f) {
+		uint32_t corners = compiled.face_begin[f + 1] - compiled.face_begin[f];
+		if (compiled.face_boundary[f]) corners = 0;
+		assert(corners == 0 || corners >= 3);
+		corners_begin[f + 1] = corners_begin[f] + corners;
+		idxs_begin[f + 1] = idxs_begin[f] + (corners == 0 ? 0 : 3 * (corners - 2));
+	}
+	idxs.resize(idxs_begin[faces]);
+
+	constexpr uint32_t CacheSize = 16; //vertices; a reasonable guess for post-transform caches
+
+	uint32_t vertices = compiled.vertices();
+
+	//(non-boundary) corners at each mesh vertex, in face order:
+	// (only corners of the same vertex can weld, so distinct vertices that share a position stay distinct)
+	std::vector< uint32_t > vertex_begin(vertices + 1, 0);
+	for (uint32_t f = 0; f < faces; ++f) {
+		if (compiled.face_boundary[f]) continue;
+		for (uint32_t c = compiled.face_begin[f]; c < compiled.face_begin[f + 1]; ++c) {
+			vertex_begin[compiled.face_vertex[c] + 1] += 1;
+		}
+	}
+	for (uint32_t v = 0; v < vertices; ++v) vertex_begin[v + 1] += vertex_begin[v];
+	std::vector< uint32_t > vertex_corners(vertex_begin[vertices]); //as output corners (see corners_begin)
+	std::vector< uint32_t > vertex_corner_halfedge(vertex_begin[vertices]);
+	{
+		std::vector< uint32_t > at(vertex_begin.begin(), vertex_begin.end() - 1);
+		for (uint32_t f = 0; f < faces; ++f) {
+			if (compiled.face_boundary[f]) continue;
+			for (uint32_t c = compiled.face_begin[f]; c < compiled.face_begin[f + 1]; ++c) {
+				uint32_t slot = at[compiled.face_vertex[c]]++;
+				vertex_corners[slot] = corners_begin[f] + (c - compiled.face_begin[f]);
+				vertex_corner_halfedge[slot] = compiled.face_halfedge[c];
+			}
+		}
+	}
+
+	//at each vertex, weld corners with matching normal and uv bits:
+	// welded[slot] is the first slot (at the same vertex) with the same data
+	std::vector< uint32_t > welded(vertex_corners.size());
+	std::vector< uint32_t > vertex_welded(vertices + 1, 0);
+	Halfedge_Mesh::parallel_for(vertices, [&](uint32_t begin, uint32_t end) {
+		std::vector< std::pair< std::array< uint32_t, 5 >, uint32_t > > distinct;
+		for (uint32_t v = begin; v < end; ++v) {
+			distinct.clear();
+			for (uint32_t slot = vertex_begin[v]; slot < vertex_begin[v + 1]; ++slot) {
+				uint32_t h = vertex_corner_halfedge[slot];
+				Vec3 n = compiled.corner_normal[h];
+				Vec2 uv = compiled.corner_uv[h];
+				std::array< uint32_t, 5 > key{bits(n.x), bits(n.y), bits(n.z), bits(uv.x), bits(uv.y)};
+				auto match = std::find_if(distinct.begin(), distinct.end(), [&](auto const &d) { return d.first == key; });
+				if (match == distinct.end()) {
+					distinct.emplace_back(key, slot);
+					welded[slot] = slot;
+				} else {
+					welded[slot] = match->second;
+				}
+			}
+			vertex_welded[v + 1] = uint32_t(distinct.size());
+		}
+	});
+
+	//number welded vertices (provisionally, by mesh vertex), and point corners at them:
+	for (uint32_t v = 0; v < vertices; ++v) vertex_welded[v + 1] += vertex_welded[v];
+	uint32_t welded_count = vertex_welded[vertices];
+	std::vector< uint32_t > corner_vertex(corners_begin[faces]);
+	std::vector< uint32_t > welded_slot(welded_count); //a corner (slot) to take each welded vertex's data from
+	std::vector< uint32_t > welded_from(welded_count); //mesh vertex of each welded vertex
+	Halfedge_Mesh::parallel_for(vertices, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t v = begin; v < end; ++v) {
+			uint32_t next = vertex_welded[v];
+			for (uint32_t slot = vertex_begin[v]; slot < vertex_begin[v + 1]; ++slot) {
+				if (welded[slot] == slot) {
+					welded_slot[next] = slot;
+					welded_from[next] = v;
+					corner_vertex[vertex_corners[slot]] = next++;
+				} else {
+					corner_vertex[vertex_corners[slot]] = corner_vertex[vertex_corners[welded[slot]]];
+				}
+			}
+		}
+	});
+
+	//divide faces into triangle fans:
+	Halfedge_Mesh::parallel_for(faces, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t f = begin; f < end; ++f) {
+			uint32_t at = idxs_begin[f];
+			for (uint32_t i = corners_begin[f] + 1; i + 1 < corners_begin[f + 1]; i++) {
+				idxs[at++] = corner_vertex[corners_begin[f]];
+				idxs[at++] = corner_vertex[i];
+				idxs[at++] = corner_vertex[i + 1];
+			}
+		}
+	});
+
+	//reorder triangles for the vertex cache, then number vertices in the order triangles first use them:
+	std::vector< uint32_t > order = tipsify(idxs, welded_count, CacheSize);
+	std::vector< Indexed_Mesh::Index > reordered(idxs.size());
+	std::vector< uint32_t > renumber(welded_count, -1U);
+	uint32_t used = 0;
+	for (uint32_t t = 0; t < order.size(); ++t) {
+		for (uint32_t k = 0; k < 3; ++k) {
+			uint32_t v = idxs[3 * order[t] + k];
+			if (renumber[v] == -1U) renumber[v] = used++;
+			reordered[3 * t + k] = renumber[v];
+		}
+	}
+	assert(used == welded_count);
+	idxs = std::move(reordered);
+
+	verts.resize(welded_count);
+	Halfedge_Mesh::parallel_for(welded_count, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t w = begin; w < end; ++w) {
+			uint32_t h = vertex_corner_halfedge[welded_slot[w]];
+			Indexed_Mesh::Vert &vert = verts[renumber[w]];
+			vert.pos = compiled.position(welded_from[w]);
+			vert.norm = compiled.corner_normal[h];
+			vert.uv = compiled.corner_uv[h];
+			vert.id = compiled.vertex_id[welded_from[w]];
+		}
+	});
+
+	return Indexed_Mesh(std::move(verts), std::move(idxs));
+}
+
+} //namespace
 
 Indexed_Mesh Indexed_Mesh::from_halfedge_mesh(Halfedge_Mesh const &halfedge_mesh, SplitOrAverage split_or_average) {
+	if (split_or_average == WeldCorners) {
+		//welding needs corners grouped by vertex, which the compiled mesh already has:
+		return weld_corners(Compiled_Mesh(halfedge_mesh));
+	}
 	
 	std::vector<Indexed_Mesh::Vert> verts;
 	std::vector<Indexed_Mesh::Index> idxs;
@@ -22,6 +22,7 @@ public:
 	enum SplitOrAverage {
 		SplitEdges, //mesh faces are split along edges so uv and normal data can be perfectly represented
 		AverageData, //topology is preserved, but vertex uvs and normals are average of incident corner uvs/normals
+		WeldCorners, //corners of a mesh vertex with identical normal and uv share a vertex (whose id is the mesh vertex's id); triangles are ordered for vertex cache locality (for GPU drawing)
 	};
 	static Indexed_Mesh from_halfedge_mesh(Halfedge_Mesh const &, SplitOrAverage split_or_average);
 
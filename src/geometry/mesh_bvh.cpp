@@ -0,0 +1,427 @@
+#include "mesh_bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float Infinity = std::numeric_limits< float >::infinity();
+
+//leaves hold at most this many items:
+constexpr uint32_t Leaf_Size = 4;
+
+BBox face_box(Halfedge_Mesh::FaceCRef face) {
+	BBox box;
+	Halfedge_Mesh::HalfedgeCRef h = face->halfedge;
+	do {
+		box.enclose(h->vertex->position);
+		h = h->next;
+	} while (h != face->halfedge);
+	return box;
+}
+
+BBox vertex_box(Halfedge_Mesh::VertexCRef vertex) {
+	return BBox(vertex->position, vertex->position);
+}
+
+//call f(a, b, c) for each triangle in the fan around face's first corner:
+template< typename F >
+void for_each_triangle(Halfedge_Mesh::FaceCRef face, F const &f) {
+	Halfedge_Mesh::HalfedgeCRef h = face->halfedge;
+	Vec3 a = h->vertex->position;
+	for (h = h->next; h->next != face->halfedge; h = h->next) {
+		f(a, h->vertex->position, h->next->vertex->position);
+	}
+}
+
+//squared distance from p to the closest point in box:
+float box_distance2(BBox const &box, Vec3 p) {
+	Vec3 d = hmax(hmax(box.min - p, p - box.max), Vec3(0.0f));
+	return d.norm_squared();
+}
+
+//entry distance of ray into box, if it enters within [t_min, t_max]:
+float box_entry(Ray const &ray, BBox const &box, float t_min, float t_max) {
+	for (uint32_t i = 0; i < 3; ++i) {
+		float inv = 1.0f / ray.dir[i];
+		float t0 = (box.min[i] - ray.point[i]) * inv;
+		float t1 = (box.max[i] - ray.point[i]) * inv;
+		if (inv < 0.0f) std::swap(t0, t1);
+		//(NaNs, from 0 * inf when the ray lies in a slab's plane, leave the bounds alone)
+		if (t0 > t_min) t_min = t0;
+		if (t1 < t_max) t_max = t1;
+		if (t_min > t_max) return Infinity;
+	}
+	return t_min;
+}
+
+//closest point to p on triangle abc (Ericson, "Real-Time Collision Detection" 5.1.5):
+Vec3 closest_on_triangle(Vec3 p, Vec3 a, Vec3 b, Vec3 c) {
+	Vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = dot(ab, ap), d2 = dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+	Vec3 bp = p - b;
+	float d3 = dot(ab, bp), d4 = dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+	Vec3 cp = p - c;
+	float d5 = dot(ab, cp), d6 = dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+//distance along ray to triangle abc, if hit within [t_min, t_max] (Moller-Trumbore):
+float triangle_hit(Ray const &ray, Vec3 a, Vec3 b, Vec3 c, float t_min, float t_max) {
+	Vec3 e1 = b - a, e2 = c - a;
+	Vec3 s = cross(ray.dir, e2);
+	float det = dot(e1, s);
+	if (det == 0.0f) return Infinity;
+	float inv = 1.0f / det;
+	Vec3 o = ray.point - a;
+	float u = dot(o, s) * inv;
+	if (u < 0.0f || u > 1.0f) return Infinity;
+	Vec3 q = cross(o, e1);
+	float v = dot(ray.dir, q) * inv;
+	if (v < 0.0f || u + v > 1.0f) return Infinity;
+	float t = dot(e2, q) * inv;
+	if (t < t_min || t > t_max) return Infinity;
+	return t;
+}
+
+//squared distance from p to segment ab:
+float segment_distance2(Vec3 a, Vec3 b, Vec3 p) {
+	Vec3 ab = b - a;
+	float len2 = ab.norm_squared();
+	float t = len2 > 0.0f ? std::clamp(dot(p - a, ab) / len2, 0.0f, 1.0f) : 0.0f;
+	return (a + ab * t - p).norm_squared();
+}
+
+bool overlaps(BBox const &a, BBox const &b) {
+	return a.min.x <= b.max.x && b.min.x <= a.max.x
+	    && a.min.y <= b.max.y && b.min.y <= a.max.y
+	    && a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+} // namespace
+
+template< typename Ref >
+void Mesh_BVH::Tree< Ref >::build(std::vector< Item > &&items_) {
+	items = std::move(items_);
+	pending.clear();
+	nodes.clear();
+	leaf_of.assign(items.size(), None);
+	if (items.empty()) {
+		slot_of.clear();
+		return;
+	}
+	nodes.reserve(2 * (items.size() / Leaf_Size + 1));
+
+	//split at the median of the longest axis of item centers:
+	auto build_node = [&](auto const &build_node, uint32_t begin, uint32_t end, uint32_t parent) -> uint32_t {
+		uint32_t n = uint32_t(nodes.size());
+		nodes.emplace_back();
+		nodes[n].begin = begin;
+		nodes[n].end = end;
+		nodes[n].parent = parent;
+
+		BBox box, centers;
+		for (uint32_t i = begin; i < end; ++i) {
+			box.enclose(items[i].box);
+			centers.enclose(items[i].box.center());
+		}
+		nodes[n].box = box;
+
+		if (end - begin <= Leaf_Size) {
+			for (uint32_t i = begin; i < end; ++i) {
+				leaf_of[i] = n;
+			}
+			return n;
+		}
+
+		Vec3 extent = centers.max - centers.min;
+		uint32_t axis = 0;
+		if (extent.y > extent[axis]) axis = 1;
+		if (extent.z > extent[axis]) axis = 2;
+		uint32_t mid = begin + (end - begin) / 2;
+		std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end,
+			[axis](Item const &a, Item const &b) { return a.box.center()[axis] < b.box.center()[axis]; });
+
+		uint32_t left = build_node(build_node, begin, mid, n);
+		uint32_t right = build_node(build_node, mid, end, n);
+		nodes[n].left = left;
+		nodes[n].right = right;
+		return n;
+	};
+	build_node(build_node, 0, uint32_t(items.size()), None);
+
+	uint32_t max_id = 0;
+	for (Item const &item : items) {
+		max_id = std::max(max_id, item.id);
+	}
+	slot_of.assign(max_id + 1, None);
+	for (uint32_t i = 0; i < items.size(); ++i) {
+		slot_of[items[i].id] = i;
+	}
+}
+
+template< typename Ref >
+void Mesh_BVH::Tree< Ref >::update(Ref ref, BBox box) {
+	uint32_t id = ref->id;
+	uint32_t slot = id < slot_of.size() ? slot_of[id] : None;
+
+	if (slot == None) {
+		if (id >= slot_of.size()) slot_of.resize(id + 1, None);
+		slot_of[id] = uint32_t(items.size() + pending.size());
+		pending.emplace_back(Item{Halfedge_Mesh::handle(ref), box});
+	} else if (slot >= items.size()) {
+		pending[slot - items.size()].box = box;
+	} else {
+		//refit the leaf holding the item and every node above it:
+		items[slot].box = box;
+		for (uint32_t n = leaf_of[slot]; n != None; n = nodes[n].parent) {
+			Node &node = nodes[n];
+			node.box.reset();
+			if (node.left == None) {
+				for (uint32_t i = node.begin; i < node.end; ++i) {
+					node.box.enclose(items[i].box);
+				}
+			} else {
+				node.box.enclose(nodes[node.left].box);
+				node.box.enclose(nodes[node.right].box);
+			}
+		}
+	}
+}
+
+template< typename Ref >
+template< typename Box_Of >
+bool Mesh_BVH::Tree< Ref >::refit(Box_Of const &box_of) {
+	for (Item &item : items) {
+		if (!item.live()) return false;
+		item.box = box_of(item.ref);
+	}
+	for (Item &item : pending) {
+		if (!item.live()) return false;
+		item.box = box_of(item.ref);
+	}
+	//(build() adds parents before their children, so this visits children first)
+	for (uint32_t n = uint32_t(nodes.size()); n-- > 0; ) {
+		Node &node = nodes[n];
+		node.box.reset();
+		if (node.left == None) {
+			for (uint32_t i = node.begin; i < node.end; ++i) {
+				node.box.enclose(items[i].box);
+			}
+		} else {
+			node.box.enclose(nodes[node.left].box);
+			node.box.enclose(nodes[node.right].box);
+		}
+	}
+	return true;
+}
+
+template< typename Ref >
+template< typename Test, typename Visit >
+void Mesh_BVH::Tree< Ref >::visit(Test const &test, Visit const &visit) const {
+	//(an item whose element was erased, or whose node was recycled, is skipped)
+	auto visit_item = [&](Item const &item) {
+		if (item.live() && test(item.box) < Infinity) visit(item);
+	};
+
+	if (!nodes.empty()) {
+		std::vector< uint32_t > stack;
+		stack.emplace_back(0);
+		while (!stack.empty()) {
+			Node const &node = nodes[stack.back()];
+			stack.pop_back();
+			if (!(test(node.box) < Infinity)) continue;
+
+			if (node.left == None) {
+				for (uint32_t i = node.begin; i < node.end; ++i) {
+					visit_item(items[i]);
+				}
+				continue;
+			}
+
+			//push the farther child first, so the nearer one is visited first:
+			float l = test(nodes[node.left].box);
+			float r = test(nodes[node.right].box);
+			uint32_t near = node.left, far = node.right;
+			if (r < l) {
+				std::swap(near, far);
+				std::swap(l, r);
+			}
+			if (r < Infinity) stack.emplace_back(far);
+			if (l < Infinity) stack.emplace_back(near);
+		}
+	}
+
+	for (Item const &item : pending) {
+		visit_item(item);
+	}
+}
+
+Mesh_BVH::Mesh_BVH(Halfedge_Mesh const &mesh) {
+	build(mesh);
+}
+
+void Mesh_BVH::build(Halfedge_Mesh const &mesh) {
+	arena = mesh.vertices.get_allocator().arena;
+
+	std::vector< Tree< Halfedge_Mesh::FaceCRef >::Item > face_items;
+	face_items.reserve(mesh.faces.size());
+	for (auto f = mesh.faces.begin(); f != mesh.faces.end(); ++f) {
+		if (!f->boundary) face_items.push_back({Halfedge_Mesh::handle(f), face_box(f)});
+	}
+	faces.build(std::move(face_items));
+
+	std::vector< Tree< Halfedge_Mesh::VertexCRef >::Item > vertex_items;
+	vertex_items.reserve(mesh.vertices.size());
+	for (auto v = mesh.vertices.begin(); v != mesh.vertices.end(); ++v) {
+		vertex_items.push_back({Halfedge_Mesh::handle(v), vertex_box(v)});
+	}
+	vertices.build(std::move(vertex_items));
+}
+
+void Mesh_BVH::update(Halfedge_Mesh const &mesh, std::vector< Halfedge_Mesh::ElementCRef > const &around) {
+	std::vector< Halfedge_Mesh::VertexCRef > touched;
+	for (auto const &element : around) {
+		std::visit(overloaded{
+			[&](Halfedge_Mesh::VertexCRef v) {
+				touched.emplace_back(v);
+			},
+			[&](Halfedge_Mesh::EdgeCRef e) {
+				touched.emplace_back(e->halfedge->vertex);
+				touched.emplace_back(e->halfedge->twin->vertex);
+			},
+			[&](Halfedge_Mesh::FaceCRef f) {
+				Halfedge_Mesh::HalfedgeCRef h = f->halfedge;
+				do {
+					touched.emplace_back(h->vertex);
+					h = h->next;
+				} while (h != f->halfedge);
+			},
+			[&](Halfedge_Mesh::HalfedgeCRef h) {
+				touched.emplace_back(h->vertex);
+				touched.emplace_back(h->twin->vertex);
+			}
+		}, element);
+	}
+
+	for (Halfedge_Mesh::VertexCRef v : touched) {
+		vertices.update(v, vertex_box(v));
+		if (v->halfedge == mesh.halfedges.end()) continue;
+		Halfedge_Mesh::HalfedgeCRef h = v->halfedge;
+		do {
+			if (!h->face->boundary) faces.update(h->face, face_box(h->face));
+			h = h->twin->next;
+		} while (h != v->halfedge);
+	}
+
+	//linear search of new elements stops paying off once there are many of them:
+	auto too_many = [](auto const &tree) {
+		return tree.pending.size() > tree.items.size() / 4 + 64;
+	};
+	if (too_many(faces) || too_many(vertices)) build(mesh);
+}
+
+void Mesh_BVH::refit(Halfedge_Mesh const &mesh) {
+	//a mesh that was assigned or moved into has a different arena, and none of the indexed elements:
+	if (!arena || arena != mesh.vertices.get_allocator().arena) {
+		build(mesh);
+		return;
+	}
+
+	size_t live_faces = 0;
+	for (auto const &f : mesh.faces) {
+		if (!f.boundary) ++live_faces;
+	}
+	//(refit checks that no indexed element is gone, so matching counts mean none were added)
+	bool same_elements = faces.items.size() + faces.pending.size() == live_faces
+	                  && vertices.items.size() + vertices.pending.size() == mesh.vertices.size();
+	if (!same_elements || !faces.refit(face_box) || !vertices.refit(vertex_box)) build(mesh);
+}
+
+std::optional< Mesh_BVH::Surface_Point > Mesh_BVH::closest_point(Vec3 p, float max_distance) const {
+	float best2 = max_distance * max_distance;
+	std::optional< Surface_Point > best;
+	faces.visit(
+		[&](BBox const &box) {
+			float d2 = box_distance2(box, p);
+			return d2 <= best2 ? d2 : Infinity;
+		},
+		[&](auto const &item) {
+			for_each_triangle(item.ref, [&](Vec3 a, Vec3 b, Vec3 c) {
+				Vec3 q = closest_on_triangle(p, a, b, c);
+				float d2 = (q - p).norm_squared();
+				if (d2 <= best2) {
+					best2 = d2;
+					best = Surface_Point{item.ref, q, 0.0f};
+				}
+			});
+		});
+	if (best) best->distance = std::sqrt(best2);
+	return best;
+}
+
+std::optional< Mesh_BVH::Surface_Point > Mesh_BVH::hit(Ray const &ray) const {
+	float t_min = ray.dist_bounds.x;
+	float t_max = ray.dist_bounds.y;
+	std::optional< Surface_Point > best;
+	faces.visit(
+		[&](BBox const &box) {
+			return box_entry(ray, box, t_min, t_max);
+		},
+		[&](auto const &item) {
+			for_each_triangle(item.ref, [&](Vec3 a, Vec3 b, Vec3 c) {
+				float t = triangle_hit(ray, a, b, c, t_min, t_max);
+				if (t < Infinity) {
+					t_max = t;
+					best = Surface_Point{item.ref, ray.at(t), t};
+				}
+			});
+		});
+	return best;
+}
+
+std::vector< Halfedge_Mesh::VertexCRef > Mesh_BVH::vertices_within(Vec3 p, float radius) const {
+	float radius2 = radius * radius;
+	std::vector< Halfedge_Mesh::VertexCRef > found;
+	vertices.visit(
+		[&](BBox const &box) {
+			float d2 = box_distance2(box, p);
+			return d2 <= radius2 ? d2 : Infinity;
+		},
+		[&](auto const &item) {
+			if ((item.ref->position - p).norm_squared() <= radius2) found.emplace_back(item.ref);
+		});
+	return found;
+}
+
+std::vector< Halfedge_Mesh::VertexCRef > Mesh_BVH::vertices_near_segment(Vec3 a, Vec3 b, float radius) const {
+	float radius2 = radius * radius;
+	BBox bounds(hmin(a, b) - Vec3(radius), hmax(a, b) + Vec3(radius));
+	std::vector< Halfedge_Mesh::VertexCRef > found;
+	vertices.visit(
+		[&](BBox const &box) {
+			return overlaps(box, bounds) ? 0.0f : Infinity;
+		},
+		[&](auto const &item) {
+			if (segment_distance2(a, b, item.ref->position) <= radius2) found.emplace_back(item.ref);
+		});
+	return found;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+/*
+ * A Mesh_BVH is a bounding volume hierarchy over the faces and vertices of a
+ * Halfedge_Mesh. It answers closest-point, radius, and ray queries by walking
+ * a tree of boxes instead of testing every element.
+ *
+ * Elements are held by reference and checked against their id, so the index
+ * can follow local edits: update() refits the boxes around the edited
+ * elements and queues any new elements in a small list that is searched
+ * linearly; erased elements are skipped. Once the queue grows large the tree
+ * is rebuilt. (Anything that replaces the mesh's elements wholesale -- a
+ * global operation, assigning another mesh -- needs a build().)
+ */
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "../lib/mathlib.h"
+#include "halfedge.h"
+
+class Mesh_BVH {
+public:
+	Mesh_BVH() = default;
+	explicit Mesh_BVH(Halfedge_Mesh const &mesh);
+
+	//index all non-boundary faces and all vertices of mesh:
+	void build(Halfedge_Mesh const &mesh);
+
+	//bring the index up to date after a local edit that changed the elements in 'around':
+	// (the vertices of those elements, and the faces around those vertices, are refit or added)
+	void update(Halfedge_Mesh const &mesh, std::vector< Halfedge_Mesh::ElementCRef > const &around);
+
+	//bring the index up to date after an edit when it isn't known which elements changed:
+	// if the mesh still has exactly the indexed elements, their boxes are refit in place (O(n), no
+	// re-sorting); if elements were added or erased, or the mesh's elements were replaced, this builds.
+	void refit(Halfedge_Mesh const &mesh);
+
+	//--- queries ---
+	//(faces are treated as triangle fans around their first corner, as Face::normal() does)
+
+	struct Surface_Point {
+		Halfedge_Mesh::FaceCRef face;
+		Vec3 point;
+		float distance; //from the query point, or along the ray
+	};
+
+	//closest point on any face to p (std::nullopt if no face is within max_distance):
+	std::optional< Surface_Point > closest_point(Vec3 p, float max_distance = std::numeric_limits< float >::infinity()) const;
+
+	//first face hit by ray within ray.dist_bounds:
+	std::optional< Surface_Point > hit(Ray const &ray) const;
+
+	//vertices within radius of point p / of segment a-b (in no particular order):
+	std::vector< Halfedge_Mesh::VertexCRef > vertices_within(Vec3 p, float radius) const;
+	std::vector< Halfedge_Mesh::VertexCRef > vertices_near_segment(Vec3 a, Vec3 b, float radius) const;
+
+private:
+	//a BVH over one kind of element, plus the elements added since it was built:
+	template< typename Ref >
+	struct Tree {
+		//(the handle stops being live once its element is erased or its node is recycled)
+		struct Item : Halfedge_Mesh::Handle< Ref > {
+			BBox box;
+		};
+		static constexpr uint32_t None = -1U;
+		struct Node {
+			BBox box;
+			uint32_t begin, end; //items[begin,end) are under this node
+			uint32_t left = None, right = None; //children (None for leaves)
+			uint32_t parent = None;
+		};
+
+		std::vector< Item > items; //in tree order
+		std::vector< Node > nodes; //nodes[0] is the root
+		std::vector< uint32_t > leaf_of; //leaf holding items[i]
+		std::vector< Item > pending; //added since the tree was built (searched linearly)
+		std::vector< uint32_t > slot_of; //by id: index in items, or items.size() + index in pending (None if not indexed)
+
+		void build(std::vector< Item > &&items);
+		//recompute every box with box_of(ref), bottom-up (false if some element is gone, leaving boxes stale):
+		template< typename Box_Of >
+		bool refit(Box_Of const &box_of);
+		//refit (or add) the element 'ref' with box 'box':
+		void update(Ref ref, BBox box);
+		//call visit(item) for every live item whose box has finite test(box):
+		// (nearer subtrees -- smaller test(box) -- are visited first, and test is re-checked before
+		//  descending, so a test that tightens as items are visited prunes well)
+		template< typename Test, typename Visit >
+		void visit(Test const &test, Visit const &visit) const;
+	};
+
+	Tree< Halfedge_Mesh::FaceCRef > faces;
+	Tree< Halfedge_Mesh::VertexCRef > vertices;
+
+	//arena holding the indexed elements (kept, so refit() can read them even if the mesh was
+	// replaced, and can tell that it was):
+	std::shared_ptr< Element_Arena > arena;
+};
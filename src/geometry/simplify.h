@@ -0,0 +1,225 @@
+#pragma once
+
+/*
+ * Helpers for Halfedge_Mesh::simplify (and other loops that repeatedly pick
+ * the best element and edit the mesh around it):
+ *
+ *  MutablePriorityQueue<T> -- a priority queue whose items can be replaced or
+ *    removed in O(log n), because each is filed under an index (an element id).
+ *  Quadric -- a symmetric 4x4 quadric error matrix, stored as 10 floats.
+ *  Id_Map<T> -- a map from element id to T, stored without per-value nodes.
+ *
+ * Quadric and Id_Map are optional drop-in replacements for the Mat4 quadrics
+ * and unordered_map tables the simplify() scaffolding starts with.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../lib/mathlib.h"
+
+//priority queue (smallest item, by operator<, on top) where each item is filed under an index
+// (e.g., an element id), so it can be found, replaced, or removed in O(log n):
+// (insert(item) and remove(item) file items under queue_index(item), which must be declared for T)
+template< class T > struct MutablePriorityQueue {
+	//add item under queue_index(item), replacing any item already filed there:
+	void insert(const T& item) {
+		insert(queue_index(item), item);
+	}
+	//remove the item filed under queue_index(item) (if any):
+	void remove(const T& item) {
+		remove(queue_index(item));
+	}
+
+	//add item under index, replacing any item already filed there:
+	void insert(uint32_t index, const T& item) {
+		if (contains(index)) {
+			uint32_t at = position[index];
+			heap[at].item = item;
+			sift_up(at);
+			sift_down(position[index]);
+		} else {
+			if (index >= position.size()) position.resize(std::max< size_t >(index + 1, position.size() * 2), Absent);
+			heap.emplace_back(Entry{item, index});
+			position[index] = uint32_t(heap.size() - 1);
+			sift_up(uint32_t(heap.size() - 1));
+		}
+	}
+	//remove the item filed under index (if any):
+	void remove(uint32_t index) {
+		if (!contains(index)) return;
+		uint32_t at = position[index];
+		position[index] = Absent;
+		if (at + 1 == heap.size()) {
+			heap.pop_back();
+			return;
+		}
+		heap[at] = std::move(heap.back());
+		heap.pop_back();
+		uint32_t moved = heap[at].index;
+		position[moved] = at;
+		sift_up(at);
+		sift_down(position[moved]);
+	}
+	bool contains(uint32_t index) const {
+		return index < position.size() && position[index] != Absent;
+	}
+	const T& top() const {
+		return heap.front().item;
+	}
+	uint32_t top_index() const {
+		return heap.front().index;
+	}
+	void pop() {
+		remove(top_index());
+	}
+	size_t size() const {
+		return heap.size();
+	}
+	bool empty() const {
+		return heap.empty();
+	}
+
+private:
+	static constexpr uint32_t Absent = -1U;
+	static constexpr uint32_t Arity = 4; //(shallower than a binary heap, and children share cache lines)
+
+	struct Entry {
+		T item;
+		uint32_t index;
+	};
+	std::vector< Entry > heap;
+	std::vector< uint32_t > position; //position[index] is where index's entry is in heap, or Absent
+
+	void sift_up(uint32_t at) {
+		Entry entry = std::move(heap[at]);
+		while (at > 0) {
+			uint32_t parent = (at - 1) / Arity;
+			if (!(entry.item < heap[parent].item)) break;
+			heap[at] = std::move(heap[parent]);
+			position[heap[at].index] = at;
+			at = parent;
+		}
+		position[entry.index] = at;
+		heap[at] = std::move(entry);
+	}
+	void sift_down(uint32_t at) {
+		Entry entry = std::move(heap[at]);
+		while (true) {
+			uint32_t first = at * Arity + 1;
+			if (first >= heap.size()) break;
+			uint32_t last = std::min< uint32_t >(first + Arity, uint32_t(heap.size()));
+			uint32_t best = first;
+			for (uint32_t c = first + 1; c < last; ++c) {
+				if (heap[c].item < heap[best].item) best = c;
+			}
+			if (!(heap[best].item < entry.item)) break;
+			heap[at] = std::move(heap[best]);
+			position[heap[at].index] = at;
+			at = best;
+		}
+		position[entry.index] = at;
+		heap[at] = std::move(entry);
+	}
+};
+
+//symmetric 4x4 matrix (for quadric error metrics), stored as its upper triangle:
+struct Quadric {
+	//for the quadric of plane (a,b,c,d): { aa, ab, ac, ad, bb, bc, bd, cc, cd, dd }
+	std::array< float, 10 > q = {};
+
+	//quadric measuring squared distance to the plane a*x + b*y + c*z + d = 0 (with (a,b,c) unit length):
+	static Quadric from_plane(Vec4 plane) {
+		Quadric ret;
+		ret.q = {
+			plane.x * plane.x, plane.x * plane.y, plane.x * plane.z, plane.x * plane.w,
+			plane.y * plane.y, plane.y * plane.z, plane.y * plane.w,
+			plane.z * plane.z, plane.z * plane.w,
+			plane.w * plane.w
+		};
+		return ret;
+	}
+
+	Quadric &operator+=(Quadric const &o) {
+		for (uint32_t i = 0; i < 10; ++i) q[i] += o.q[i];
+		return *this;
+	}
+	Quadric operator+(Quadric const &o) const {
+		Quadric ret = *this;
+		return ret += o;
+	}
+
+	//error of position p, i.e., [p 1]^T Q [p 1]:
+	float error(Vec3 p) const {
+		return q[0] * p.x * p.x + 2.0f * q[1] * p.x * p.y + 2.0f * q[2] * p.x * p.z + 2.0f * q[3] * p.x
+		     + q[4] * p.y * p.y + 2.0f * q[5] * p.y * p.z + 2.0f * q[6] * p.y
+		     + q[7] * p.z * p.z + 2.0f * q[8] * p.z
+		     + q[9];
+	}
+
+	//the full matrix:
+	Mat4 to_mat4() const {
+		return Mat4(
+			Vec4(q[0], q[1], q[2], q[3]),
+			Vec4(q[1], q[4], q[5], q[6]),
+			Vec4(q[2], q[5], q[7], q[8]),
+			Vec4(q[3], q[6], q[8], q[9])
+		);
+	}
+};
+
+//map from element id to T, with the operator[], at, count, and erase subset of unordered_map:
+// (costs one uint32_t per id up to the largest id used, rather than a hash table node per value)
+//
+// References are stable, as with unordered_map: a T& stays valid until its own id is erased,
+// no matter what other ids are added or erased. (values live in a deque, which never moves
+// them, and an erased value's place is recycled for the next new id.)
+template< typename T > struct Id_Map {
+	T &operator[](uint32_t id) {
+		if (id >= slot.size()) slot.resize(std::max< size_t >(id + 1, slot.size() * 2), Empty);
+		if (slot[id] == Empty) {
+			if (free.empty()) {
+				slot[id] = uint32_t(values.size());
+				values.emplace_back();
+			} else {
+				slot[id] = free.back();
+				free.pop_back();
+			}
+			++used;
+		}
+		return values[slot[id]];
+	}
+	T &at(uint32_t id) {
+		if (!count(id)) throw std::out_of_range("Id_Map has no value for id " + std::to_string(id) + ".");
+		return values[slot[id]];
+	}
+	T const &at(uint32_t id) const {
+		if (!count(id)) throw std::out_of_range("Id_Map has no value for id " + std::to_string(id) + ".");
+		return values[slot[id]];
+	}
+	size_t count(uint32_t id) const {
+		return (id < slot.size() && slot[id] != Empty) ? 1 : 0;
+	}
+	void erase(uint32_t id) {
+		if (!count(id)) return;
+		values[slot[id]] = T(); //(so a recycled value starts out default, as a new one would)
+		free.emplace_back(slot[id]);
+		slot[id] = Empty;
+		--used;
+	}
+	size_t size() const {
+		return used;
+	}
+
+private:
+	static constexpr uint32_t Empty = -1U;
+	std::vector< uint32_t > slot; //slot[id] is the index of id's value, or Empty
+	std::deque< T > values;
+	std::vector< uint32_t > free; //indices of erased values, to re-use
+	size_t used = 0;
+};
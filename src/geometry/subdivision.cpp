@@ -0,0 +1,391 @@
+#include "subdivision.h"
+#include "halfedge.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+//sparse weighted sum of cage vertices, sorted by cage vertex index:
+using Row = std::vector< std::pair< uint32_t, float > >;
+
+//sum of weighted rows:
+Row combine(std::vector< std::pair< Row const *, float > > const &terms) {
+	Row row;
+	for (auto const &[from, weight] : terms) {
+		for (auto const &[column, w] : *from) {
+			row.emplace_back(column, weight * w);
+		}
+	}
+	std::sort(row.begin(), row.end(), [](auto const &a, auto const &b) { return a.first < b.first; });
+	//merge duplicate columns:
+	size_t out = 0;
+	for (size_t i = 0; i < row.size(); ++i) {
+		if (out > 0 && row[out-1].first == row[i].first) {
+			row[out-1].second += row[i].second;
+		} else {
+			row[out++] = row[i];
+		}
+	}
+	row.resize(out);
+	return row;
+}
+
+//one subdivision level of a face-vertex mesh whose vertices are given as rows:
+struct Level {
+	std::vector< Row > rows;
+	std::vector< uint32_t > face_begin = {0};
+	std::vector< uint32_t > corner_vertex;
+	std::vector< Vec2 > corner_uv;
+	std::vector< uint32_t > face_id;
+
+	uint32_t faces() const { return uint32_t(face_begin.size()) - 1; }
+};
+
+//subdivide every face into quads (one per corner); new vertices are numbered [old vertices, edge points, face points]:
+Level subdivide(Level const &in, Subdivision_Stencils::Rule rule) {
+	uint32_t V = uint32_t(in.rows.size());
+	uint32_t F = in.faces();
+
+	//find edges (and the faces on each side):
+	struct Edge_Info {
+		uint32_t a, b;
+		uint32_t faces = 0;
+		uint32_t face[2] = {-1U, -1U};
+	};
+	std::vector< Edge_Info > edges;
+	std::vector< uint32_t > corner_edge(in.corner_vertex.size()); //edge from each corner to the next one
+	{
+		std::unordered_map< uint64_t, uint32_t > edge_index;
+		edge_index.reserve(in.corner_vertex.size());
+		for (uint32_t f = 0; f < F; ++f) {
+			uint32_t begin = in.face_begin[f], end = in.face_begin[f+1];
+			for (uint32_t c = begin; c < end; ++c) {
+				uint32_t a = in.corner_vertex[c];
+				uint32_t b = in.corner_vertex[c + 1 < end ? c + 1 : begin];
+				uint64_t key = (uint64_t(std::min(a, b)) << 32) | uint64_t(std::max(a, b));
+				auto [at, added] = edge_index.emplace(key, uint32_t(edges.size()));
+				if (added) edges.emplace_back(Edge_Info{a, b});
+				Edge_Info &edge = edges[at->second];
+				if (edge.faces == 2) {
+					throw std::runtime_error("Can't build subdivision stencils: edge between vertices " + std::to_string(a) + " and " + std::to_string(b) + " has more than two faces.");
+				}
+				edge.face[edge.faces++] = f;
+				corner_edge[c] = at->second;
+			}
+		}
+	}
+	uint32_t E = uint32_t(edges.size());
+
+	Level out;
+	out.rows.resize(V + E + F);
+
+	//face points are centroids:
+	Halfedge_Mesh::parallel_for(F, [&](uint32_t f_begin, uint32_t f_end) {
+		std::vector< std::pair< Row const *, float > > terms;
+		for (uint32_t f = f_begin; f < f_end; ++f) {
+			uint32_t begin = in.face_begin[f], end = in.face_begin[f+1];
+			terms.clear();
+			for (uint32_t c = begin; c < end; ++c) {
+				terms.emplace_back(&in.rows[in.corner_vertex[c]], 1.0f / float(end - begin));
+			}
+			out.rows[V + E + f] = combine(terms);
+		}
+	});
+
+	//edge points are midpoints (Linear, boundary) or the average of endpoints and face points (Catmark):
+	Halfedge_Mesh::parallel_for(E, [&](uint32_t e_begin, uint32_t e_end) {
+		for (uint32_t e = e_begin; e < e_end; ++e) {
+			Edge_Info const &edge = edges[e];
+			if (rule == Subdivision_Stencils::Linear || edge.faces < 2) {
+				out.rows[V + e] = combine({{&in.rows[edge.a], 0.5f}, {&in.rows[edge.b], 0.5f}});
+			} else {
+				out.rows[V + e] = combine({
+					{&in.rows[edge.a], 0.25f}, {&in.rows[edge.b], 0.25f},
+					{&out.rows[V + E + edge.face[0]], 0.25f}, {&out.rows[V + E + edge.face[1]], 0.25f}
+				});
+			}
+		}
+	});
+
+	//old vertices stay put (Linear) or move by the Catmull-Clark rules:
+	if (rule == Subdivision_Stencils::Linear) {
+		for (uint32_t v = 0; v < V; ++v) {
+			out.rows[v] = in.rows[v];
+		}
+	} else {
+		//neighborhoods of each vertex:
+		std::vector< std::vector< uint32_t > > neighbors(V), boundary_neighbors(V), vertex_faces(V);
+		for (Edge_Info const &edge : edges) {
+			neighbors[edge.a].emplace_back(edge.b);
+			neighbors[edge.b].emplace_back(edge.a);
+			if (edge.faces == 1) {
+				boundary_neighbors[edge.a].emplace_back(edge.b);
+				boundary_neighbors[edge.b].emplace_back(edge.a);
+			}
+		}
+		for (uint32_t f = 0; f < F; ++f) {
+			for (uint32_t c = in.face_begin[f]; c < in.face_begin[f+1]; ++c) {
+				vertex_faces[in.corner_vertex[c]].emplace_back(f);
+			}
+		}
+
+		Halfedge_Mesh::parallel_for(V, [&](uint32_t v_begin, uint32_t v_end) {
+			std::vector< std::pair< Row const *, float > > terms;
+			for (uint32_t v = v_begin; v < v_end; ++v) {
+				terms.clear();
+				if (!boundary_neighbors[v].empty()) {
+					if (boundary_neighbors[v].size() == 2) {
+						//boundary vertex: 1/8 3/4 1/8 along the boundary:
+						terms.emplace_back(&in.rows[v], 0.75f);
+						terms.emplace_back(&in.rows[boundary_neighbors[v][0]], 0.125f);
+						terms.emplace_back(&in.rows[boundary_neighbors[v][1]], 0.125f);
+					} else {
+						//(vertex where boundaries meet; keep it in place)
+						terms.emplace_back(&in.rows[v], 1.0f);
+					}
+				} else if (vertex_faces[v].empty()) {
+					terms.emplace_back(&in.rows[v], 1.0f);
+				} else {
+					//interior vertex: (Q + 2R + (n-3)S) / n, where
+					// Q is the average of adjacent face points, R is the average of adjacent edge midpoints, S is the vertex:
+					float n = float(neighbors[v].size());
+					float q = 1.0f / (n * float(vertex_faces[v].size()));
+					for (uint32_t f : vertex_faces[v]) {
+						terms.emplace_back(&out.rows[V + E + f], q);
+					}
+					for (uint32_t u : neighbors[v]) {
+						terms.emplace_back(&in.rows[u], 1.0f / (n * n));
+					}
+					terms.emplace_back(&in.rows[v], (n - 2.0f) / n);
+				}
+				out.rows[v] = combine(terms);
+			}
+		});
+	}
+
+	//each corner of each face becomes a quad:
+	out.face_begin.reserve(in.corner_vertex.size() + 1);
+	out.corner_vertex.reserve(4 * in.corner_vertex.size());
+	out.corner_uv.reserve(4 * in.corner_vertex.size());
+	out.face_id.reserve(in.corner_vertex.size());
+	for (uint32_t f = 0; f < F; ++f) {
+		uint32_t begin = in.face_begin[f], end = in.face_begin[f+1];
+		Vec2 center_uv = Vec2(0.0f, 0.0f);
+		for (uint32_t c = begin; c < end; ++c) {
+			center_uv += in.corner_uv[c];
+		}
+		center_uv /= float(end - begin);
+		for (uint32_t c = begin; c < end; ++c) {
+			uint32_t next = (c + 1 < end ? c + 1 : begin);
+			uint32_t prev = (c > begin ? c - 1 : end - 1);
+
+			out.corner_vertex.emplace_back(in.corner_vertex[c]);
+			out.corner_vertex.emplace_back(V + corner_edge[c]);
+			out.corner_vertex.emplace_back(V + E + f);
+			out.corner_vertex.emplace_back(V + corner_edge[prev]);
+
+			out.corner_uv.emplace_back(in.corner_uv[c]);
+			out.corner_uv.emplace_back(0.5f * (in.corner_uv[c] + in.corner_uv[next]));
+			out.corner_uv.emplace_back(center_uv);
+			out.corner_uv.emplace_back(0.5f * (in.corner_uv[prev] + in.corner_uv[c]));
+
+			out.face_begin.emplace_back(uint32_t(out.corner_vertex.size()));
+			out.face_id.emplace_back(in.face_id[f]);
+		}
+	}
+
+	return out;
+}
+
+} //namespace
+
+Subdivision_Stencils::Subdivision_Stencils(Halfedge_Mesh const &cage, uint32_t levels, Rule rule) : levels_(levels), rule_(rule) {
+
+	Level level;
+
+	//cage vertices are numbered in list order:
+	std::unordered_map< Halfedge_Mesh::VertexCRef, uint32_t > vertex_index;
+	vertex_index.reserve(cage.vertices.size());
+	level.rows.reserve(cage.vertices.size());
+	for (auto v = cage.vertices.begin(); v != cage.vertices.end(); ++v) {
+		uint32_t index = uint32_t(level.rows.size());
+		vertex_index.emplace(v, index);
+		level.rows.emplace_back(Row{{index, 1.0f}});
+	}
+
+	//cage faces (in the same corner order as Indexed_Mesh::from_halfedge_mesh):
+	for (auto const &f : cage.faces) {
+		if (f.boundary) continue;
+		auto h = f.halfedge;
+		do {
+			level.corner_vertex.emplace_back(vertex_index.at(h->vertex));
+			level.corner_uv.emplace_back(h->corner_uv);
+			h = h->next;
+		} while (h != f.halfedge);
+		level.face_begin.emplace_back(uint32_t(level.corner_vertex.size()));
+		level.face_id.emplace_back(f.id);
+	}
+	cage_corner_vertex = level.corner_vertex;
+	cage_vertices = uint32_t(cage.vertices.size());
+	cage_halfedges = uint32_t(cage.halfedges.size());
+	cage_fingerprint = fingerprint(cage);
+
+	for (uint32_t l = 0; l < levels; ++l) {
+		level = subdivide(level, rule);
+	}
+
+	//flatten rows:
+	row_begin.clear();
+	row_begin.reserve(level.rows.size() + 1);
+	row_begin.emplace_back(0);
+	for (Row const &row : level.rows) {
+		for (auto const &[column, weight] : row) {
+			columns.emplace_back(column);
+			weights.emplace_back(weight);
+		}
+		row_begin.emplace_back(uint32_t(columns.size()));
+	}
+
+	face_begin = std::move(level.face_begin);
+	corner_vertex = std::move(level.corner_vertex);
+	corner_uv = std::move(level.corner_uv);
+	face_id = std::move(level.face_id);
+
+	uint32_t faces = uint32_t(face_begin.size()) - 1;
+	for (uint32_t f = 0; f < faces; ++f) {
+		for (uint32_t c = face_begin[f] + 1; c + 1 < face_begin[f+1]; ++c) {
+			triangles.emplace_back(face_begin[f]);
+			triangles.emplace_back(c);
+			triangles.emplace_back(c + 1);
+		}
+	}
+
+	//faces around each vertex:
+	uint32_t vertices = refined_vertices();
+	vertex_face_begin.assign(vertices + 1, 0);
+	for (uint32_t v : corner_vertex) {
+		vertex_face_begin[v + 1] += 1;
+	}
+	for (uint32_t v = 0; v < vertices; ++v) {
+		vertex_face_begin[v + 1] += vertex_face_begin[v];
+	}
+	vertex_faces.resize(corner_vertex.size());
+	std::vector< uint32_t > fill(vertex_face_begin.begin(), vertex_face_begin.end() - 1);
+	for (uint32_t f = 0; f < faces; ++f) {
+		for (uint32_t c = face_begin[f]; c < face_begin[f+1]; ++c) {
+			vertex_faces[fill[corner_vertex[c]]++] = f;
+		}
+	}
+}
+
+uint64_t Subdivision_Stencils::fingerprint(Halfedge_Mesh const &mesh) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	auto mix = [&hash](uint64_t value) {
+		hash = (hash ^ value) * 0x100000001b3ull;
+		hash ^= hash >> 29;
+	};
+	auto bits = [](float value) {
+		uint32_t ret;
+		std::memcpy(&ret, &value, sizeof(ret));
+		return ret;
+	};
+	for (auto const &v : mesh.vertices) {
+		mix(v.id);
+	}
+	for (auto const &f : mesh.faces) {
+		mix((uint64_t(f.boundary) << 32) | f.id);
+	}
+	for (auto const &h : mesh.halfedges) {
+		mix((uint64_t(h.id) << 32) | h.next->id);
+		mix((uint64_t(h.vertex->id) << 32) | h.face->id);
+		mix((uint64_t(bits(h.corner_uv.x)) << 32) | bits(h.corner_uv.y));
+	}
+	return hash;
+}
+
+bool Subdivision_Stencils::matches(Halfedge_Mesh const &mesh) const {
+	return mesh.vertices.size() == cage_vertices
+	    && mesh.halfedges.size() == cage_halfedges
+	    && fingerprint(mesh) == cage_fingerprint;
+}
+
+std::vector< Vec3 > Subdivision_Stencils::refine_positions(std::vector< Vec3 > const &cage_positions) const {
+	if (cage_positions.size() != cage_vertices) {
+		throw std::runtime_error("Expected " + std::to_string(cage_vertices) + " cage positions, got " + std::to_string(cage_positions.size()) + ".");
+	}
+	std::vector< Vec3 > positions(refined_vertices());
+	Halfedge_Mesh::parallel_for(refined_vertices(), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t v = begin; v < end; ++v) {
+			Vec3 sum = Vec3(0.0f, 0.0f, 0.0f);
+			for (uint32_t k = row_begin[v]; k < row_begin[v+1]; ++k) {
+				sum += weights[k] * cage_positions[columns[k]];
+			}
+			positions[v] = sum;
+		}
+	});
+	return positions;
+}
+
+std::vector< Vec3 > Subdivision_Stencils::cage_positions_from_corners(Indexed_Mesh const &split) const {
+	if (split.vertices().size() != cage_corner_vertex.size()) {
+		throw std::runtime_error("Expected " + std::to_string(cage_corner_vertex.size()) + " corners, got " + std::to_string(split.vertices().size()) + ".");
+	}
+	std::vector< Vec3 > positions(cage_vertices, Vec3(0.0f, 0.0f, 0.0f));
+	for (uint32_t c = 0; c < cage_corner_vertex.size(); ++c) {
+		positions[cage_corner_vertex[c]] = split.vertices()[c].pos;
+	}
+	return positions;
+}
+
+Indexed_Mesh Subdivision_Stencils::refine(std::vector< Vec3 > const &cage_positions) const {
+	std::vector< Vec3 > positions = refine_positions(cage_positions);
+
+	//area-weighted face normals (Newell's method, so non-planar faces are fine):
+	uint32_t faces = uint32_t(face_begin.size()) - 1;
+	std::vector< Vec3 > face_normals(faces);
+	Halfedge_Mesh::parallel_for(faces, [&](uint32_t f_begin, uint32_t f_end) {
+		for (uint32_t f = f_begin; f < f_end; ++f) {
+			Vec3 normal = Vec3(0.0f, 0.0f, 0.0f);
+			uint32_t begin = face_begin[f], end = face_begin[f+1];
+			for (uint32_t c = begin; c < end; ++c) {
+				Vec3 const &a = positions[corner_vertex[c]];
+				Vec3 const &b = positions[corner_vertex[c + 1 < end ? c + 1 : begin]];
+				normal += cross(a, b);
+			}
+			face_normals[f] = normal;
+		}
+	});
+
+	//smooth vertex normals:
+	std::vector< Vec3 > normals(positions.size());
+	Halfedge_Mesh::parallel_for(uint32_t(positions.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t v = begin; v < end; ++v) {
+			Vec3 normal = Vec3(0.0f, 0.0f, 0.0f);
+			for (uint32_t i = vertex_face_begin[v]; i < vertex_face_begin[v+1]; ++i) {
+				normal += face_normals[vertex_faces[i]];
+			}
+			normals[v] = (normal == Vec3(0.0f, 0.0f, 0.0f) ? normal : normal.unit());
+		}
+	});
+
+	//every corner gets its own vertex (as in Indexed_Mesh::from_halfedge_mesh's SplitEdges mode):
+	std::vector< Indexed_Mesh::Vert > verts(corner_vertex.size());
+	Halfedge_Mesh::parallel_for(faces, [&](uint32_t f_begin, uint32_t f_end) {
+		for (uint32_t f = f_begin; f < f_end; ++f) {
+			for (uint32_t c = face_begin[f]; c < face_begin[f+1]; ++c) {
+				Indexed_Mesh::Vert &vert = verts[c];
+				vert.pos = positions[corner_vertex[c]];
+				vert.norm = normals[corner_vertex[c]];
+				vert.uv = corner_uv[c];
+				vert.id = face_id[f];
+			}
+		}
+	});
+
+	std::vector< Indexed_Mesh::Index > idxs = triangles;
+	return Indexed_Mesh(std::move(verts), std::move(idxs));
+}
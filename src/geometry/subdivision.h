@@ -0,0 +1,82 @@
+#pragma once
+
+/*
+ * Subdivision_Stencils record, once, how each vertex of a subdivided mesh is
+ * built from the vertices of its control cage. Since subdivision rules are
+ * linear in vertex positions, every refined position is a fixed weighted sum
+ * of cage positions; those weights (the "stencils") only depend on the cage's
+ * connectivity.
+ *
+ * So, for a cage that is animated (e.g., skinned) but never re-connected,
+ * refining a new pose is just a sparse matrix-vector product instead of
+ * another round of halfedge subdivision.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "../lib/mathlib.h"
+#include "indexed.h"
+
+class Halfedge_Mesh;
+
+class Subdivision_Stencils {
+public:
+	enum Rule : uint8_t {
+		Linear, //new vertices at edge midpoints and face centroids, nothing moves
+		Catmark, //Catmull-Clark rules (boundary edges are midpoints, boundary vertices are 1/8 3/4 1/8)
+	};
+
+	Subdivision_Stencils() = default;
+
+	//build stencils for 'levels' rounds of subdivision of the non-boundary faces of cage:
+	// (throws std::runtime_error if an edge has more than two non-boundary faces)
+	Subdivision_Stencils(Halfedge_Mesh const &cage, uint32_t levels, Rule rule = Catmark);
+
+	//does 'mesh' have the same connectivity, element order, and corner uvs as the cage these were built from?
+	// (O(elements); much cheaper than rebuilding)
+	bool matches(Halfedge_Mesh const &mesh) const;
+
+	//refined vertex positions given cage vertex positions (in cage.vertices order):
+	std::vector< Vec3 > refine_positions(std::vector< Vec3 > const &cage_positions) const;
+
+	//cage vertex positions from a mesh laid out like Indexed_Mesh::from_halfedge_mesh(cage, SplitEdges):
+	// (throws std::runtime_error if the vertex count doesn't match)
+	std::vector< Vec3 > cage_positions_from_corners(Indexed_Mesh const &split) const;
+
+	//refined mesh (split at corners) with smooth normals; uvs are interpolated from the cage's corner uvs:
+	Indexed_Mesh refine(std::vector< Vec3 > const &cage_positions) const;
+
+	uint32_t levels() const { return levels_; }
+	Rule rule() const { return rule_; }
+	uint32_t refined_vertices() const { return uint32_t(row_begin.size()) - 1; }
+
+private:
+	uint32_t levels_ = 0;
+	Rule rule_ = Catmark;
+
+	//cage description (checked by matches()):
+	uint32_t cage_vertices = 0;
+	uint32_t cage_halfedges = 0;
+	uint64_t cage_fingerprint = 0;
+	static uint64_t fingerprint(Halfedge_Mesh const &mesh);
+
+	//cage vertex index of each cage corner, in SplitEdges order:
+	std::vector< uint32_t > cage_corner_vertex;
+
+	//refined vertex i = sum of weights[k] * cage[columns[k]] for k in [row_begin[i], row_begin[i+1]):
+	std::vector< uint32_t > row_begin = {0};
+	std::vector< uint32_t > columns;
+	std::vector< float > weights;
+
+	//refined faces: corners [face_begin[f], face_begin[f+1]) of corner_vertex/corner_uv:
+	std::vector< uint32_t > face_begin = {0};
+	std::vector< uint32_t > corner_vertex;
+	std::vector< Vec2 > corner_uv;
+	std::vector< uint32_t > face_id; //id of the cage face each refined face came from
+	std::vector< uint32_t > triangles; //refined faces as triangle fans, as corner indices
+
+	//refined faces around each refined vertex (for normals): [vertex_face_begin[v], vertex_face_begin[v+1]) of vertex_faces:
+	std::vector< uint32_t > vertex_face_begin;
+	std::vector< uint32_t > vertex_faces;
+};
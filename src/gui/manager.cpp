@@ -2142,8 +2142,9 @@ void Manager::hover(uint32_t id, Vec3 cam, Vec2 spos, Vec3 dir, Modifiers mods)
 void Manager::update_gpu_caches() {
 	for (const auto& [name, mesh] : scene.meshes) {
 		if (gpu_mesh_cache.find(name) == gpu_mesh_cache.end()) {
+			//(shared vertices in cache-friendly order; these meshes don't use per-vertex ids)
 			gpu_mesh_cache[name] =
-				Indexed_Mesh::from_halfedge_mesh(*mesh, Indexed_Mesh::SplitEdges).to_gl();
+				Indexed_Mesh::from_halfedge_mesh(*mesh, Indexed_Mesh::WeldCorners).to_gl();
 		}
 	}
 	for (const auto& [name, mesh] : scene.skinned_meshes) {
@@ -18,6 +18,10 @@ Model::Model()
 	  halfedge_mesh(Util::arrow_mesh(0.05f, 0.1f, 1.0f).to_gl()) {
 }
 
+Model::~Model() {
+	cancel_global_op();
+}
+
 bool Model::mesh_expired() {
 	return std::visit([](auto&& mesh) { return mesh.expired(); }, my_mesh);
 }
@@ -33,6 +37,8 @@ Halfedge_Mesh& Model::get_mesh() {
 
 void Model::save_old_mesh() {
 	if (mesh_expired()) return;
+	//an edit is starting, so a running global operation's result would overwrite it:
+	if (global_op) global_op->stale = true;
 	old_mesh = std::visit(
 		[](auto&& mesh) -> std::variant<Halfedge_Mesh, Skinned_Mesh> {
 			return mesh.lock()->copy();
@@ -700,6 +706,119 @@ std::string Model::update_mesh(Undo& undo, std::string const &desc, T&& op) {
 	return err;
 }
 
+template<typename T>
+void Model::begin_global_op(Undo& undo, std::string const &desc, T&& op) {
+
+	if (mesh_expired() || global_op) return;
+
+	auto job = std::make_shared<Global_Op>();
+	job->desc = desc;
+	job->mesh_name = mesh_name;
+	job->mesh = my_mesh;
+	job->actions = undo.n_actions();
+	//(the copy is made here since the editor may change the mesh while the op runs)
+	job->before = std::visit(
+		[](auto&& mesh) -> std::variant<Halfedge_Mesh, Skinned_Mesh> {
+			return mesh.lock()->copy();
+		},
+		my_mesh);
+	global_op = job;
+
+	global_op_pool.enqueue([job, op = std::forward<T>(op)]() {
+		auto run = [&]() {
+			if (job->cancel) return;
+			job->phase = Global_Op::Running;
+			job->after = std::visit(
+				[](auto& mesh) -> std::variant<Halfedge_Mesh, Skinned_Mesh> {
+					return mesh.copy();
+				},
+				job->before);
+			Halfedge_Mesh& mesh = std::visit(
+				overloaded{[](Halfedge_Mesh& m) -> Halfedge_Mesh& { return m; },
+			               [](Skinned_Mesh& m) -> Halfedge_Mesh& { return m.mesh; }},
+				job->after);
+
+			job->success = op(mesh);
+
+			if (job->cancel) return;
+			job->phase = Global_Op::Validating;
+			if (auto problem = mesh.validate()) {
+				job->invalid = problem->second;
+				job->invalid_id = Halfedge_Mesh::id_of(problem->first);
+				return;
+			}
+
+			//the undo entry's delta is computed here too, so committing is just a move:
+			if (auto before = std::get_if<Halfedge_Mesh>(&job->before); before && job->success) {
+				if (job->cancel) return;
+				job->phase = Global_Op::Diffing;
+				job->undo_delta = Halfedge_Mesh::diff(*before, mesh);
+			}
+		};
+		try {
+			run();
+		} catch (std::exception& e) {
+			job->error = e.what();
+		}
+		job->phase = Global_Op::Done;
+	});
+}
+
+std::string Model::poll_global_op(Undo& undo) {
+
+	if (!global_op || global_op->phase != Global_Op::Done) return {};
+	std::shared_ptr<Global_Op> job = std::move(global_op);
+
+	if (std::visit([](auto&& mesh) { return mesh.expired(); }, job->mesh)) return {};
+
+	if (job->stale || undo.n_actions() != job->actions) {
+		warn("Discarded result of %s, since the mesh changed while it ran.", job->desc.c_str());
+		return "Note: " + job->desc + " was discarded because the mesh changed while it ran.";
+	}
+	if (!job->error.empty()) {
+		warn("%s threw: %s", job->desc.c_str(), job->error.c_str());
+		return job->desc + " failed: " + job->error;
+	}
+	if (!job->invalid.empty()) {
+		warn("Failed validate after %s (%s)", job->desc.c_str(), job->invalid.c_str());
+		if (job->mesh_name == mesh_name) {
+			screen_err_id = job->invalid_id + n_Widget_IDs;
+			err_msg = job->invalid;
+		}
+		return "Failed validate after " + job->desc + ": " + job->invalid;
+	}
+	if (!job->success) {
+		warn("%s returned false", job->desc.c_str());
+		return "Note: " + job->desc + " reported failure.";
+	}
+
+	std::visit(overloaded{[&](std::weak_ptr<Halfedge_Mesh> mesh) {
+							  *mesh.lock() = std::move(std::get<Halfedge_Mesh>(job->after));
+							  if (job->undo_delta) {
+								  undo.update_delta(job->mesh_name, mesh, std::move(*job->undo_delta));
+							  } else {
+								  undo.update_cached<Halfedge_Mesh>(
+									  job->mesh_name, mesh, std::move(std::get<Halfedge_Mesh>(job->before)));
+							  }
+						  },
+	                      [&](std::weak_ptr<Skinned_Mesh> mesh) {
+							  *mesh.lock() = std::move(std::get<Skinned_Mesh>(job->after));
+							  undo.update_cached<Skinned_Mesh>(
+								  job->mesh_name, mesh, std::move(std::get<Skinned_Mesh>(job->before)));
+						  }},
+	           job->mesh);
+	//(the mesh's elements were all replaced, so selection and instance data must be rebuilt)
+	needs_rebuild = true;
+
+	return {};
+}
+
+void Model::cancel_global_op() {
+	if (!global_op) return;
+	global_op->cancel = true;
+	global_op.reset();
+}
+
 std::string Model::validate() {
 
 	if (mesh_expired()) return {};
@@ -774,6 +893,8 @@ std::string Model::ui_sidebar(Scene& scene, Undo& undo, Widgets& widgets, View_3
 		needs_rebuild = true;
 	}
 
+	if (auto err = poll_global_op(undo); !err.empty()) return err;
+
 	if (mesh_expired()) return {};
 
 	Separator();
@@ -787,33 +908,44 @@ std::string Model::ui_sidebar(Scene& scene, Undo& undo, Widgets& widgets, View_3
 	Separator();
 
 	Text("Global Operations");
-	if (Button("Linear")) {
-		return update_mesh(undo, "linear_subdivide", [](Halfedge_Mesh& m) { m.linear_subdivide(); return true; });
-	}
-	if (WrapButton("Catmull-Clark")) {
-		return update_mesh( undo, "catmark_subdivide", [](Halfedge_Mesh& m) { m.catmark_subdivide(); return true; });
-	}
-	if (WrapButton("Loop")) {
-		return update_mesh(undo, "loop_subdivide", [](Halfedge_Mesh& m) { return m.loop_subdivide(); });
-	}
-	if (Button("Triangulate")) {
-		return update_mesh(undo, "triangulate", [](Halfedge_Mesh& m) { m.triangulate(); return true; });
-	}
-	if (WrapButton("Remesh")) {
-		return update_mesh(undo, "isotropic_remesh", [](Halfedge_Mesh& m) {
-			Halfedge_Mesh::Isotropic_Remesh_Parameters params;
-			m.isotropic_remesh(params);
-			return true;
-		});
-	}
-	if (WrapButton("Simplify")) {
-		return update_mesh(undo, "simplify", [](Halfedge_Mesh& m) {
-			if (!m.simplify(0.25f)) {
-				//not really a failure, but do make a note:
-				log("Note: simplify reported that it didn't reach goal.");
-			}
-			return true;
-		});
+	if (global_op) {
+		static char const* phases[] = {"waiting", "running", "validating", "recording undo", "done"};
+		uint32_t phase = global_op->phase;
+		std::string label = global_op->desc + ": " + phases[phase] + " (" +
+		                    std::to_string(int(global_op->timer.s())) + "s)";
+		ProgressBar(phase / float(Global_Op::Done), ImVec2(-1.0f, 0.0f), label.c_str());
+		if (Button("Cancel")) {
+			cancel_global_op();
+		}
+	} else {
+		if (Button("Linear")) {
+			begin_global_op(undo, "linear_subdivide", [](Halfedge_Mesh& m) { m.linear_subdivide(); return true; });
+		}
+		if (WrapButton("Catmull-Clark")) {
+			begin_global_op(undo, "catmark_subdivide", [](Halfedge_Mesh& m) { m.catmark_subdivide(); return true; });
+		}
+		if (WrapButton("Loop")) {
+			begin_global_op(undo, "loop_subdivide", [](Halfedge_Mesh& m) { return m.loop_subdivide(); });
+		}
+		if (Button("Triangulate")) {
+			begin_global_op(undo, "triangulate", [](Halfedge_Mesh& m) { m.triangulate(); return true; });
+		}
+		if (WrapButton("Remesh")) {
+			begin_global_op(undo, "isotropic_remesh", [](Halfedge_Mesh& m) {
+				Halfedge_Mesh::Isotropic_Remesh_Parameters params;
+				m.isotropic_remesh(params);
+				return true;
+			});
+		}
+		if (WrapButton("Simplify")) {
+			begin_global_op(undo, "simplify", [](Halfedge_Mesh& m) {
+				if (!m.simplify(0.25f)) {
+					//not really a failure, but do make a note:
+					log("Note: simplify reported that it didn't reach goal.");
+				}
+				return true;
+			});
+		}
 	}
 
 	Text("Local Operations");
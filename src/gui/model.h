@@ -4,12 +4,15 @@
 #include "modifiers.h"
 
 #include <SDL.h>
+#include <atomic>
 #include <optional>
 #include <unordered_map>
 
 #include "../geometry/halfedge.h"
 #include "../platform/gl.h"
 #include "../scene/scene.h"
+#include "../util/thread_pool.h"
+#include "../util/timer.h"
 #include "../util/viewer.h"
 #include "manager.h"
 
@@ -18,6 +21,7 @@ namespace Gui {
 class Model {
 public:
 	Model();
+	~Model();
 
 	// Gui view API
 	bool keydown(Widgets& widgets, SDL_Keysym key, View_3D& cam);
@@ -51,6 +55,14 @@ private:
 
 	template<typename T> std::string update_mesh(Undo& undo, std::string const &desc, T&& op);
 
+	//global operations run on a worker thread against a copy of the mesh, so the editor stays responsive:
+	// op is bool(Halfedge_Mesh &), like update_mesh's; only one global operation runs at a time
+	template<typename T> void begin_global_op(Undo& undo, std::string const &desc, T&& op);
+	//if the global operation has finished, commit its result and undo entry (or report its failure):
+	std::string poll_global_op(Undo& undo);
+	//stop waiting for the global operation (the worker drops its result once the op returns):
+	void cancel_global_op();
+
 	void zoom_to(Halfedge_Mesh::ElementRef ref, View_3D& cam);
 	void begin_transform();
 	bool begin_bevel_or_extrude(std::string& err);
@@ -86,6 +98,31 @@ private:
 	std::variant<std::weak_ptr<Halfedge_Mesh>, std::weak_ptr<Skinned_Mesh>> my_mesh;
 	std::variant<Halfedge_Mesh, Skinned_Mesh> old_mesh;
 
+	//a global operation in flight (shared with the worker running it):
+	struct Global_Op {
+		enum Phase : uint32_t { Waiting, Running, Validating, Diffing, Done };
+		std::atomic<uint32_t> phase = Waiting;
+		std::atomic<bool> cancel = false;
+
+		std::string desc;
+		std::string mesh_name;
+		std::variant<std::weak_ptr<Halfedge_Mesh>, std::weak_ptr<Skinned_Mesh>> mesh;
+		Timer timer;
+		//the result is thrown away if the mesh may have changed since the op started:
+		size_t actions = 0; //undo.n_actions() when started
+		bool stale = false; //set when an edit starts on the editor side
+
+		//written by the worker (read once phase is Done):
+		std::variant<Halfedge_Mesh, Skinned_Mesh> before, after;
+		std::optional<Halfedge_Mesh::Delta> undo_delta; //(Halfedge_Mesh only)
+		bool success = false; //what op returned
+		std::string error; //exception thrown by op
+		std::string invalid; //validate() message, if op produced an invalid mesh
+		uint32_t invalid_id = 0; //element validate() complained about
+	};
+	std::shared_ptr<Global_Op> global_op;
+	Thread_Pool global_op_pool{1};
+
 	enum class Bevel { face, edge, vert };
 	Bevel beveling;
 
@@ -40,6 +40,7 @@ void Rig::erase_mesh(const std::string& name) {
 		my_mesh.reset();
 		mesh_name = {};
 		needs_rebuild = true;
+		mesh_bvh = Mesh_BVH(); //(let go of the erased mesh's elements)
 		selected_bone = -1U;
 		new_bone = -1U;
 		selected_handle = -1U;
@@ -219,7 +220,8 @@ void Rig::rebuild() {
 	auto mesh = my_mesh.lock();
 	if (!mesh) return;
 
-	mesh_accel = PT::Tri_Mesh(mesh->bind_mesh(), use_bvh);
+	//(skeleton edits also invalidate the mesh, so this usually just refits the boxes)
+	mesh_bvh.refit(mesh->mesh);
 	gpu_mesh = mesh->bind_mesh().to_gl();
 }
 
@@ -233,14 +235,14 @@ void Rig::hover(Vec3 cam, Vec2 spos, Vec3 dir) {
 		assert(new_bone < mesh->skeleton.bones.size());
 
 		Ray f(cam, dir);
-		PT::Trace hit1 = mesh_accel.hit(f);
-		if (!hit1.hit) return;
+		auto hit1 = mesh_bvh.hit(f);
+		if (!hit1) return;
 
-		Ray s(hit1.position + dir * EPS_F, dir);
-		PT::Trace hit2 = mesh_accel.hit(s);
+		Ray s(hit1->point + dir * EPS_F, dir);
+		auto hit2 = mesh_bvh.hit(s);
 
-		Vec3 pos = hit1.position;
-		if (hit2.hit) pos = 0.5f * (hit1.position + hit2.position);
+		Vec3 pos = hit1->point;
+		if (hit2) pos = 0.5f * (hit1->point + hit2->point);
 
 		mesh->skeleton.bones.at(new_bone).extent = pos - old_base;
 		//my_mesh.lock()->bone_cache.clear();
@@ -332,11 +334,6 @@ void Rig::ui_sidebar(Scene& scene, Undo& undo, Widgets& widgets) {
 			dont_clear_select = false;
 		}
 
-		SameLine();
-
-		if (Checkbox("Use BVH", &use_bvh)) {
-			mesh_accel = PT::Tri_Mesh(mesh->bind_mesh(), use_bvh);
-		}
 	}
 
 	dont_clear_select = true;
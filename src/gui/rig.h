@@ -3,7 +3,7 @@
 
 #include <SDL.h>
 
-#include "../pathtracer/tri_mesh.h"
+#include "../geometry/mesh_bvh.h"
 #include "../scene/skeleton.h"
 #include "widgets.h"
 #include "../platform/renderer.h"
@@ -55,8 +55,8 @@ private:
 
 	Renderer::Skeleton_ID_Map id_map;
 
-	bool use_bvh = true, dont_clear_select = false;
-	PT::Tri_Mesh mesh_accel;
+	bool dont_clear_select = false;
+	Mesh_BVH mesh_bvh; //bind-pose mesh, for placing new bones inside it
     GL::Mesh gpu_mesh;
 };
 
@@ -1275,6 +1275,17 @@ Mode Widget_Skinned_Mesh::ui(Mode current, const std::string& name, Undo& undo,
 
 	if (Button("Edit Mesh")) current = Mode::model;
 	if (WrapButton("Edit Skeleton")) current = Mode::rig;
+
+	int levels = int(mesh->subdivision_levels);
+	SliderInt("Render Subdivision", &levels, 0, 4);
+	if (IsItemActivated()) old_subdivision_levels = mesh->subdivision_levels;
+	mesh->subdivision_levels = uint32_t(std::clamp(levels, 0, 4));
+	if (IsItemDeactivated() && old_subdivision_levels != mesh->subdivision_levels) {
+		Skinned_Mesh old = mesh->copy();
+		old.subdivision_levels = old_subdivision_levels;
+		undo.update_cached<Skinned_Mesh>(name, mesh, std::move(old));
+	}
+
 	ui(name, undo, apply_to);
 
 	return current;
@@ -1359,6 +1370,26 @@ void Widget_Render::begin_window(Scene& scene, Undo& undo, Manager& manager, Vie
 
 	if (method == Method::path_trace) {
 		Checkbox("Use BVH", &use_bvh);
+		Checkbox("Crop Window", &use_crop);
+		if (use_crop) {
+			InputUInt32("Crop X Begin", &crop.x_begin);
+			InputUInt32("Crop X End", &crop.x_end);
+			InputUInt32("Crop Y Begin", &crop.y_begin);
+			InputUInt32("Crop Y End", &crop.y_end);
+			//(y counts from the bottom of the image, as in the path tracer)
+			if (auto cam = render_cam.lock()) {
+				if (auto camera = cam->camera.lock()) {
+					crop.x_end = std::min(crop.x_end, camera->film.width);
+					crop.y_end = std::min(crop.y_end, camera->film.height);
+					crop.x_begin = std::min(crop.x_begin, crop.x_end);
+					crop.y_begin = std::min(crop.y_begin, crop.y_end);
+				}
+			}
+		}
+	}
+	if (method == Method::software_raster) {
+		Combo("Transparency", &raster_settings.transparency, Rasterizer::Transparency_Names);
+		Checkbox("Deferred Shading", &raster_settings.deferred);
 	}
 }
 
@@ -1421,7 +1452,7 @@ void Widget_Render::ui_animate(Scene& scene, Manager& manager, Undo& undo, View_
 				if (method == Method::path_trace) {
 					pathtracer.render(scene, render_cam.lock(), std::move(report_callback), &quit);
 				} else if(method == Method::software_raster) {
-					rasterizer.reset(new Rasterizer(scene, *render_cam.lock(), std::move(report_callback)));
+					rasterizer.reset(new Rasterizer(rasterizer ? rasterizer->release() : nullptr, scene, *render_cam.lock(), std::move(report_callback), raster_settings));
 				}
 			}
 		}
@@ -1481,12 +1512,12 @@ bool Widget_Render::ui_render(Scene& scene, Manager& manager, Undo& undo, View_3
 				pathtracer.render(scene, render_cam.lock(), [this, report_callback](PT::Pathtracer::Render_Report &&report){
 					report_callback(std::move(report));
 					rebuild_ray_log = true;
-				}, &quit);
+				}, &quit, false, use_crop ? crop : PT::Crop{});
 
 			} else if (method == Method::software_raster) {
 
 				has_rendered = true;
-				rasterizer.reset(new Rasterizer(scene, *render_cam.lock(), std::move(report_callback)));
+				rasterizer.reset(new Rasterizer(rasterizer ? rasterizer->release() : nullptr, scene, *render_cam.lock(), std::move(report_callback), raster_settings));
 
 			} else {
 
@@ -1535,7 +1566,7 @@ bool Widget_Render::ui_render(Scene& scene, Manager& manager, Undo& undo, View_3
 
 			quit = false;
 			render_progress = 0.0f;
-			pathtracer.render(scene, render_cam.lock(), std::move(report_callback), &quit, true);
+			pathtracer.render(scene, render_cam.lock(), std::move(report_callback), &quit, true, use_crop ? crop : PT::Crop{});
 		}
 	}
 
@@ -1714,7 +1745,7 @@ std::string Widget_Render::step_animation(Scene& scene, Animator& animator, Mana
 				}
 
 				render_progress = 0.0f;
-				rasterizer.reset(new Rasterizer(scene, *render_cam.lock(), std::move(report_callback)));
+				rasterizer.reset(new Rasterizer(rasterizer ? rasterizer->release() : nullptr, scene, *render_cam.lock(), std::move(report_callback), raster_settings));
 				next_frame++;
 			}
 		}
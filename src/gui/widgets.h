@@ -213,6 +213,7 @@ public:
 
 private:
 	Halfedge_Mesh_Controls controls;
+	uint32_t old_subdivision_levels = 0;
 };
 
 class Widget_Render {
@@ -242,6 +243,8 @@ private:
 
 	float exposure = 1.0f;
 	bool use_bvh = true;
+	bool use_crop = false; //only path trace inside 'crop'
+	PT::Crop crop;
 	bool has_rendered = false, rebuild_ray_log = false;
 	bool render_window = false, render_window_focus = false;
 	bool quit = false;
@@ -262,6 +265,7 @@ private:
 
 	PT::Pathtracer pathtracer;
 	std::unique_ptr< Rasterizer > rasterizer;
+	Rasterizer::Settings raster_settings;
 };
 
 } // namespace Gui
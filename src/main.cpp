@@ -1,19 +1,25 @@
 
 #include <sf_libs/CLI11.hpp>
-#include <sf_libs/stb_image_write.h>
 
 #include "platform/platform.h"
 #include "util/rand.h"
+#include "util/thread_pool.h"
 #include "lib/log.h"
 
 #include "pathtracer/pathtracer.h"
+#include "rasterizer/benchmark.h"
+#include "rasterizer/framebuffer.h"
 #include "rasterizer/rasterizer.h"
 #include "rasterizer/sample_pattern.h"
 #include "scene/io.h"
+#include "util/image_writer.h"
+#include "util/ppm_writer.h"
 
 #include "test.h"
 
+#include <deque>
 #include <filesystem>
+#include <unordered_set>
 
 int main(int argc, char** argv) {
 
@@ -24,13 +30,16 @@ int main(int argc, char** argv) {
 
 	//settings used in this file for headless operation:
 	std::string tests_prefix = "";
+	std::string benchmark_filter = "";
+	float benchmark_seconds = 0.1f; //minimum time to spend on each benchmark
 
 	bool pathtrace = false;
 	bool rasterize = false;
 
 	std::string output_file = "out.png";
 
-	std::string camera_name;
+	std::vector< std::string > camera_names;
+	bool all_cameras = false;
 	bool animate = false;
 	int32_t min_frame = 0;
 	int32_t max_frame = -1;
@@ -38,12 +47,20 @@ int main(int argc, char** argv) {
 	float exp = 1.0f;
 	bool no_bvh = false;
 
+	std::vector< uint32_t > crop_window; //pathtracer crop window (x_begin y_begin x_end y_end) if not empty
+	uint32_t crop_samples = 0; //if nonzero, refine the crop window of a full render with this many samples
+
 	uint32_t film_width = -1U; //override film width (if not -1U)
 	uint32_t film_height = -1U; //override film height (if not -1U)
 	uint32_t film_samples = -1U; //override film samples (if not -1U)
 	uint32_t film_max_ray_depth = -1U; //override film max ray depth (if not -1U)
 	std::string film_sample_pattern = ""; //override film sample pattern (if not "")
 
+	Rasterizer::Settings raster_settings;
+	std::string raster_transparency = ""; //override transparency mode (if not "")
+	uint32_t raster_frames_in_flight = 1; //animation frames to rasterize concurrently
+	uint32_t bucket_size = 0; //if nonzero, render in buckets of this size and stream output as PPM
+
 	std::string write_file = ""; //write file (useful for conversions)
 
 
@@ -52,23 +69,34 @@ int main(int argc, char** argv) {
 	auto tests_option = args.add_option("--run-tests", tests_prefix, "Run all tests starting with prefix", true);
 	tests_option->expected(0, 1);
 
+	auto benchmark_option = args.add_option("--raster-benchmark", benchmark_filter, "Run all rasterizer benchmarks including string (uses --film-width, --film-height if given)", true);
+	benchmark_option->expected(0, 1);
+	args.add_option("--raster-benchmark-time", benchmark_seconds, "Minimum time to run each rasterizer benchmark (seconds)");
+
 	args.add_option("-s,--scene", set.scene_file, "Scene file to load");
 	args.add_option("--write", write_file, "Re-save file and exit");
 	args.add_flag("--trace", pathtrace, "Path trace scene without opening the GUI");
 	args.add_flag("--rasterize", rasterize, "Rasterize scene without opening the GUI");
-	args.add_option("-c,--camera", camera_name, "Camera instance to render (if headless)");
-	args.add_option("-o,--output", output_file, "Image file to write (if headless) [for animation, can also be a directory]");
+	args.add_option("-c,--camera", camera_names, "Camera instance(s) to render (if headless) [for several cameras, outputs are suffixed with the camera name]");
+	args.add_flag("--all-cameras", all_cameras, "Render through every camera instance in the scene (if headless)");
+	args.add_option("-o,--output", output_file, "Image file to write (if headless) [for animation, can also be a directory; .pfm writes raw radiance]");
 	args.add_flag("--animate", animate, "Output animation frames [min_frame,max_frame] (if headless)");
 	args.add_option("--min-frame", min_frame, "First animation frame");
 	args.add_option("--max-frame", max_frame, "Last animation frame (-1 is last keyframe)");
 	args.add_flag("--no_bvh", no_bvh, "Don't use BVH (if headless)");
 	args.add_option("--exposure", exp, "Output exposure (if headless)");
+	args.add_option("--crop", crop_window, "Only path trace pixels in [x_begin,x_end)x[y_begin,y_end), from the bottom left (if headless)")->expected(4);
+	args.add_option("--crop-samples", crop_samples, "Path trace the whole film, then add this many samples per pixel inside --crop");
 	args.add_option("--seed", RNG::fixed_seed, "Use fixed seed for RNG when rendering; (0 disables).");
 	args.add_option("--film-width",          film_width, "Override camera film width (pixels)");
 	args.add_option("--film-height",         film_height, "Override camera film height (pixels)");
 	args.add_option("--film-samples",        film_samples, "Override film samples-per-pixel (for pathtracer)");
 	args.add_option("--film-max-ray-depth",  film_max_ray_depth, "Override film max ray depth (for pathtracer)");
 	args.add_option("--film-sample-pattern", film_sample_pattern, "Override film sample pattern (for rasterizer)");
+	args.add_option("--raster-transparency", raster_transparency, "Transparency mode for rasterizer (sorted, weighted, kbuffer)");
+	args.add_flag("--raster-deferred", raster_settings.deferred, "Use deferred shading in rasterizer");
+	args.add_option("--raster-frames-in-flight", raster_frames_in_flight, "Number of animation frames to rasterize concurrently (if headless)");
+	args.add_option("--bucket-size", bucket_size, "Render in NxN pixel buckets, streaming bands of them to a PPM file (if headless; allows films larger than the rasterizer framebuffer)");
 	args.add_option("--force-dpi", Platform::force_dpi, "Force DPI to a given number (will scale UI).");
 
 	CLI11_PARSE(args, argc, argv);
@@ -82,11 +110,29 @@ int main(int argc, char** argv) {
 		}
 	}
 
+	// if benchmarks are to be run, run them and return:
+	if (benchmark_option->count() > 0) {
+		uint32_t width = (film_width != -1U ? film_width : 512);
+		uint32_t height = (film_height != -1U ? film_height : 512);
+		try {
+			RasterBenchmark::run(benchmark_filter, width, height, benchmark_seconds);
+		} catch (std::exception const &e) {
+			warn("ERROR: Failed to run rasterizer benchmarks: %s", e.what());
+			return 1;
+		}
+		return 0;
+	}
+
 	if (animate && !(pathtrace || rasterize)) {
 		warn("ERROR: must specify --trace or --rasterize when doing --animate.");
 		return 1;
 	}
 
+	if (crop_samples != 0 && crop_window.empty()) {
+		warn("ERROR: --crop-samples requires a --crop window.");
+		return 1;
+	}
+
 	if ((min_frame != 0 || max_frame != -1) && !animate) {
 		warn("ERROR: --min-frame and --max-frame should only be used with --animate");
 		return 1;
@@ -121,72 +167,123 @@ int main(int argc, char** argv) {
 			return 0;
 		}
 
-		//find camera:
-		std::weak_ptr< Instance::Camera > camera_instance = scene.get<Instance::Camera>(camera_name);
-		if (!camera_instance.lock()) {
-			std::string all_cameras = "Camera instances in scene:";
+		//find cameras:
+		if (all_cameras) {
+			camera_names.clear();
 			for (auto const &[name, camera] : scene.instances.cameras) {
-				all_cameras += "\n    '" + name + "'";
+				camera_names.emplace_back(name);
 			}
-			warn("ERROR: Failed to find camera: %s", camera_name.c_str());
-			info("%s", all_cameras.c_str());
-			return 1;
+			std::sort(camera_names.begin(), camera_names.end());
 		}
-		std::shared_ptr< Camera > camera = camera_instance.lock()->camera.lock();
-		assert(camera && "valid scenes always have valid data references in instances");
-
-		//override camera parameters if requested:
-		if (film_width != -1U && film_height != -1U) {
-			camera->film.width = film_width;
-			camera->film.height = film_height;
-			camera->aspect_ratio = camera->film.width / float(camera->film.height);
-			std::cout << "  Set film size to [" << camera->film.width << "x" << camera->film.height << "]." << std::endl;
-		} else if (film_width != -1U) {
-			camera->film.width = film_width;
-			camera->film.height = uint32_t(std::round(camera->film.width / camera->aspect_ratio));
-			std::cout << "  Set film size to [" << camera->film.width << "x" << camera->film.height << "] (height determined from aspect ratio)." << std::endl;
-		} else if (film_height != -1U) {
-			camera->film.height = film_height;
-			camera->film.width = uint32_t(std::round(camera->film.height * camera->aspect_ratio));
-			std::cout << "  Set film size to [" << camera->film.width << "x" << camera->film.height << "] (width determined from aspect ratio)." << std::endl;
+		if (camera_names.empty()) camera_names.emplace_back(""); //(will fail and list cameras)
+
+		std::vector< std::shared_ptr< Instance::Camera > > camera_instances;
+		for (auto const &camera_name : camera_names) {
+			std::shared_ptr< Instance::Camera > camera_instance = scene.get<Instance::Camera>(camera_name).lock();
+			if (!camera_instance) {
+				std::string all_cameras = "Camera instances in scene:";
+				for (auto const &[name, camera] : scene.instances.cameras) {
+					all_cameras += "\n    '" + name + "'";
+				}
+				warn("ERROR: Failed to find camera: %s", camera_name.c_str());
+				info("%s", all_cameras.c_str());
+				return 1;
+			}
+			camera_instances.emplace_back(camera_instance);
 		}
 
-		if (film_samples != -1U) {
-			camera->film.samples = film_samples;
-			std::cout << "  Set film path tracer samples to " << camera->film.samples << "." << std::endl;
-		}
+		//override camera parameters if requested:
+		// (cameras may share data, so each one is only overridden once)
+		std::unordered_set< Camera * > overridden;
+		for (auto const &camera_instance : camera_instances) {
+			std::shared_ptr< Camera > camera = camera_instance->camera.lock();
+			assert(camera && "valid scenes always have valid data references in instances");
+			if (!overridden.emplace(camera.get()).second) continue;
+
+			if (film_width != -1U && film_height != -1U) {
+				camera->film.width = film_width;
+				camera->film.height = film_height;
+				camera->aspect_ratio = camera->film.width / float(camera->film.height);
+				std::cout << "  Set film size to [" << camera->film.width << "x" << camera->film.height << "]." << std::endl;
+			} else if (film_width != -1U) {
+				camera->film.width = film_width;
+				camera->film.height = uint32_t(std::round(camera->film.width / camera->aspect_ratio));
+				std::cout << "  Set film size to [" << camera->film.width << "x" << camera->film.height << "] (height determined from aspect ratio)." << std::endl;
+			} else if (film_height != -1U) {
+				camera->film.height = film_height;
+				camera->film.width = uint32_t(std::round(camera->film.height * camera->aspect_ratio));
+				std::cout << "  Set film size to [" << camera->film.width << "x" << camera->film.height << "] (width determined from aspect ratio)." << std::endl;
+			}
 
-		if (film_max_ray_depth != -1U) {
-			camera->film.max_ray_depth = film_max_ray_depth;
-			std::cout << "  Set film max ray depth to " << camera->film.max_ray_depth << "." << std::endl;
-		}
+			if (film_samples != -1U) {
+				camera->film.samples = film_samples;
+				std::cout << "  Set film path tracer samples to " << camera->film.samples << "." << std::endl;
+			}
 
-		if (film_sample_pattern != "") {
-			std::vector< SamplePattern > const &patterns = SamplePattern::all_patterns();
-			bool found = false;
-			for (auto const &p : patterns) {
-				if (p.name == film_sample_pattern) {
-					camera->film.sample_pattern = p.id;
-					std::cout << "  Set film rasterizer sample pattern to '" << p.name << "'." << std::endl;
-					found = true;
-					break;
-				}
+			if (film_max_ray_depth != -1U) {
+				camera->film.max_ray_depth = film_max_ray_depth;
+				std::cout << "  Set film max ray depth to " << camera->film.max_ray_depth << "." << std::endl;
 			}
-			if (!found) {
-				std::string all_patterns = "Available Sample Patterns:";
+
+			if (film_sample_pattern != "") {
+				std::vector< SamplePattern > const &patterns = SamplePattern::all_patterns();
+				bool found = false;
 				for (auto const &p : patterns) {
-					all_patterns += "\n    '" + p.name + "'";
+					if (p.name == film_sample_pattern) {
+						camera->film.sample_pattern = p.id;
+						std::cout << "  Set film rasterizer sample pattern to '" << p.name << "'." << std::endl;
+						found = true;
+						break;
+					}
+				}
+				if (!found) {
+					std::string all_patterns = "Available Sample Patterns:";
+					for (auto const &p : patterns) {
+						all_patterns += "\n    '" + p.name + "'";
+					}
+					warn("ERROR: Failed to find sample pattern: %s", film_sample_pattern.c_str());
+					info("%s", all_patterns.c_str());
+					return 1;
 				}
-				warn("ERROR: Failed to find sample pattern: %s", film_sample_pattern.c_str());
-				info("%s", all_patterns.c_str());
+			}
+		}
+
+		if (raster_transparency != "") {
+			if (raster_transparency == "sorted") {
+				raster_settings.transparency = Rasterizer::Transparency::sorted;
+			} else if (raster_transparency == "weighted") {
+				raster_settings.transparency = Rasterizer::Transparency::weighted;
+			} else if (raster_transparency == "kbuffer") {
+				raster_settings.transparency = Rasterizer::Transparency::kbuffer;
+			} else {
+				warn("ERROR: Unknown rasterizer transparency mode '%s' (expected sorted, weighted, or kbuffer).", raster_transparency.c_str());
 				return 1;
 			}
 		}
 
+		bool oversize_film = false;
+		for (auto const &camera_instance : camera_instances) {
+			std::shared_ptr< Camera > camera = camera_instance->camera.lock();
+			if (camera->film.width > Framebuffer::MaxWidth || camera->film.height > Framebuffer::MaxHeight) oversize_film = true;
+		}
+		if (rasterize && bucket_size == 0 && oversize_film) {
+			bucket_size = 1024;
+			info("Film is larger than the rasterizer framebuffer limit (%ux%u); rendering in %u pixel buckets.", Framebuffer::MaxWidth, Framebuffer::MaxHeight, bucket_size);
+		}
+
+		if (bucket_size != 0 && output_file == "") {
+			warn("ERROR: bucket rendering streams to the output file, so --output must not be empty.");
+			return 1;
+		}
+
 		if (RNG::fixed_seed == 0) {
 			RNG::fixed_seed = (std::random_device())();
 		}
 
+		//threads shared by simulation steps and by concurrently running rasterizers:
+		// (one pool, so frames in flight don't each start hardware_concurrency threads)
+		Thread_Pool thread_pool(std::max(1u, std::thread::hardware_concurrency()));
+
 		//----------------------------
 		//animation setup
 
@@ -207,7 +304,7 @@ int main(int argc, char** argv) {
 					Scene::StepOpts opts;
 					opts.reset = (frame == 0);
 					opts.use_bvh = !no_bvh;
-					opts.thread_pool = nullptr; //TODO
+					opts.thread_pool = &thread_pool;
 					scene.step(animator, float(frame), float(frame + 1), 1.0f / animator.frame_rate, opts);
 				}
 			} else {
@@ -227,121 +324,276 @@ int main(int argc, char** argv) {
 		//rendering loop
 
 		info("Render settings:");
-		info("\twidth: %d", camera->film.width);
-		info("\theight: %d", camera->film.height);
+		for (uint32_t c = 0; c < camera_instances.size(); ++c) {
+			std::shared_ptr< Camera > camera = camera_instances[c]->camera.lock();
+			if (camera_instances.size() > 1) info("\tcamera '%s':", camera_names[c].c_str());
+			info("\twidth: %d", camera->film.width);
+			info("\theight: %d", camera->film.height);
+			if (pathtrace) {
+				info("\tsamples: %d", camera->film.samples);
+				info("\tmax depth: %d", camera->film.max_ray_depth);
+			} else { assert(rasterize);
+				std::string name;
+				if (SamplePattern const *p = SamplePattern::from_id(camera->film.sample_pattern)) {
+					name = p->name;
+				} else {
+					name = "???"; //this *probably* will cause rasterizer to fail anyway
+				}
+				info("\tsample pattern: '%s' (%d)", name.c_str(), camera->film.sample_pattern);
+			}
+		}
 		info("\texposure: %f", exp);
 		info("\tseed: 0x%X", RNG::fixed_seed);
 		if (pathtrace) {
-			info("\tsamples: %d", camera->film.samples);
-			info("\tmax depth: %d", camera->film.max_ray_depth);
 			info("\trender threads: %u", std::thread::hardware_concurrency());
 			if (no_bvh) info("\tusing object list instead of BVH");
+			if (!crop_window.empty()) {
+				info("\tcrop window: [%u,%u)x[%u,%u)", crop_window[0], crop_window[2], crop_window[1], crop_window[3]);
+				if (crop_samples != 0) info("\tcrop window samples: %u (after full render)", crop_samples);
+			}
 			info("\tpathtracing...");
 		} else { assert(rasterize);
-			std::string name;
-			if (SamplePattern const *p = SamplePattern::from_id(camera->film.sample_pattern)) {
-				name = p->name;
-			} else {
-				name = "???"; //this *probably* will cause rasterizer to fail anyway
-			}
-			info("\tsample pattern: '%s' (%d)", name.c_str(), camera->film.sample_pattern);
+			info("\ttransparency: %s", Rasterizer::Transparency_Names[uint8_t(raster_settings.transparency)]);
+			if (raster_settings.deferred) info("\tusing deferred shading");
+			if (animate && raster_frames_in_flight > 1 && bucket_size == 0) info("\tframes in flight: %u", raster_frames_in_flight);
 			info("\trasterizing...");
 		}
-		for (int32_t frame = min_frame; frame <= max_frame; ++frame) {
-			//do the render:
-			info(" frame %d", frame);
-
-			auto print_progress = [](float f) {
-				std::cout << "Progress: [";
-
-				int32_t console = static_cast<int32_t>(Platform::console_width());
-				int32_t width = std::clamp(console - 30, 0, 50);
-				if (width) {
-					int32_t bar = static_cast<int32_t>(width * f);
-					for (int32_t i = 0; i < bar; i++) std::cout << "-";
-					for (int32_t i = bar; i < width; i++) std::cout << " ";
-					std::cout << "] ";
+		if (bucket_size != 0) info("\tbucket size: %u (streaming PPM output)", bucket_size);
+
+		//output file name for a frame through camera_instances[c]
+		// (numbered if animating, and named after the camera if rendering several):
+		auto frame_filename = [&](int32_t frame, uint32_t c, std::string const &dir_ext) -> std::filesystem::path {
+			std::filesystem::path filename(output_file);
+
+			bool several_cameras = camera_instances.size() > 1;
+			if (animate || several_cameras) {
+				std::string camera = (several_cameras ? camera_names[c] : "");
+				std::stringstream str;
+				if (animate) str << std::setfill('0') << std::setw(4) << frame;
+
+				std::error_code ec;
+				if (std::filesystem::is_directory(filename, ec) ) {
+					//named + numbered files within the directory:
+					filename = filename / (camera + str.str() + dir_ext);
+				} else {
+					//camera name and number go after the stem:
+					std::filesystem::path ext = filename.extension();
+					filename.replace_extension("");
+					if (several_cameras) filename += "-" + camera;
+					filename += str.str();
+					filename += ext;
 				}
+			}
+			return filename;
+		};
 
-				float percent = 100.0f * f;
-				if (percent < 10.0f) std::cout << " ";
-				std::cout << std::setprecision(2) << std::fixed;
-				std::cout << percent << "%    \r";
-				std::cout.flush();
+		//write a frame rendered through camera_instances[c] to output_file:
+		// (tonemapping and encoding happen on a background thread, overlapping the next render)
+		Image_Writer image_writer;
+		auto write_frame = [&](int32_t frame, uint32_t c, HDR_Image &&display_hdr) -> bool {
+			if (output_file == "") {
+				std::cout << "No output was requested, not writing any file." << std::endl;
+			} else {
+				std::filesystem::path filename = frame_filename(frame, c, ".png");
+				if (!image_writer.write(filename.generic_string(), std::move(display_hdr), exp)) {
+					return false;
+				}
+			}
+			return true;
+		};
+
+		//pipelined rasterization of animation frames:
+		// each Rasterizer copies the scene as it is after stepping to its frame, so up to
+		// raster_frames_in_flight frames render concurrently while the scene is stepped ahead;
+		// frames are still written in order. (with several cameras, each frame's cameras are
+		// started one after another and count separately against raster_frames_in_flight)
+		if (rasterize && animate && raster_frames_in_flight > 1 && bucket_size == 0) {
+			struct InFlight {
+				int32_t frame;
+				uint32_t camera; //index into camera_instances
+				std::unique_ptr< Rasterizer > rasterizer;
+			};
+			std::deque< InFlight > in_flight;
+			std::shared_ptr< RasterJob > spare_job; //finished job, re-used by the next frame started
+			Rasterizer::Settings in_flight_settings = raster_settings;
+			in_flight_settings.thread_pool = &thread_pool;
+
+			//wait for the oldest frame and write it:
+			auto finish_oldest = [&]() -> bool {
+				InFlight &oldest = in_flight.front();
+				oldest.rasterizer->wait();
+				info(" frame %d done in %.3fs.", oldest.frame, oldest.rasterizer->completion_time);
+				bool ok = write_frame(oldest.frame, oldest.camera, oldest.rasterizer->framebuffer->resolve_colors());
+				spare_job = oldest.rasterizer->release();
+				in_flight.pop_front();
+				return ok;
 			};
 
-			std::mutex report_mut;
-			float percent_done = 0.0f;
-			HDR_Image display_hdr;
+			for (int32_t frame = min_frame; frame <= max_frame; ++frame) {
+				info(" frame %d", frame);
+				for (uint32_t c = 0; c < camera_instances.size(); ++c) {
+					//bound memory use by the number of frames in flight:
+					while (in_flight.size() >= raster_frames_in_flight) {
+						if (!finish_oldest()) return 1;
+					}
 
-			auto report_callback = [&](auto&& report) {
-				std::lock_guard<std::mutex> lock(report_mut);
-				if (report.first > percent_done) {
-					percent_done = report.first;
-					display_hdr = std::move(report.second);
+					in_flight.emplace_back(InFlight{
+						frame, c,
+						std::make_unique< Rasterizer >(std::move(spare_job), scene, *camera_instances[c], [](Rasterizer::Render_Report &&) {}, in_flight_settings)
+					});
 				}
-			};
 
-			if (pathtrace) {
-				bool quit = false;
-				PT::Pathtracer pathtracer;
+				//advance (rasterizer has its own copy of the scene, so this can overlap rendering):
+				if (frame != max_frame) {
+					Scene::StepOpts opts;
+					opts.use_bvh = !no_bvh;
+					opts.thread_pool = &thread_pool;
+					scene.step(animator, float(frame), float(frame + 1), 1.0f / animator.frame_rate, opts);
+				}
+			}
+			while (!in_flight.empty()) {
+				if (!finish_oldest()) return 1;
+			}
 
-				pathtracer.use_bvh(!no_bvh);
-				pathtracer.render(scene, camera_instance.lock(), std::move(report_callback), &quit);
+			return image_writer.finish() ? 0 : 1;
+		}
 
-				while (pathtracer.in_progress()) {
-					print_progress(percent_done);
-					std::this_thread::sleep_for(std::chrono::milliseconds(250));
+		//converted scene data is kept between cameras and frames, and only rebuilt when needed:
+		std::shared_ptr< RasterJob > raster_job;
+		std::unique_ptr< PT::Pathtracer > pathtracer;
+		if (pathtrace) {
+			pathtracer = std::make_unique< PT::Pathtracer >();
+			pathtracer->use_bvh(!no_bvh);
+		}
+
+		for (int32_t frame = min_frame; frame <= max_frame; ++frame) {
+			for (uint32_t c = 0; c < camera_instances.size(); ++c) {
+				//do the render:
+				if (camera_instances.size() > 1) {
+					info(" frame %d, camera '%s'", frame, camera_names[c].c_str());
+				} else {
+					info(" frame %d", frame);
 				}
-				std::cout << std::endl;
+				std::shared_ptr< Camera > camera = camera_instances[c]->camera.lock();
 
-			} else { assert(rasterize);
+				//the scene doesn't change between cameras, so the pathtracer only builds it once per frame:
+				if (pathtracer) pathtracer->reuse_scene(c > 0);
 
-				Rasterizer rasterizer(scene, *camera_instance.lock(), std::move(report_callback));
-				while (rasterizer.in_progress()) {
-					print_progress(percent_done);
-					std::this_thread::sleep_for(std::chrono::milliseconds(250));
-				}
-				std::cout << std::endl;
-			}
-			info("\tdone.");
+				auto print_progress = [](float f) {
+					std::cout << "Progress: [";
 
-			//write frame:
-			if (output_file == "") {
-				std::cout << "No output was requested, not writing any file." << std::endl;
-			} else {
+					int32_t console = static_cast<int32_t>(Platform::console_width());
+					int32_t width = std::clamp(console - 30, 0, 50);
+					if (width) {
+						int32_t bar = static_cast<int32_t>(width * f);
+						for (int32_t i = 0; i < bar; i++) std::cout << "-";
+						for (int32_t i = bar; i < width; i++) std::cout << " ";
+						std::cout << "] ";
+					}
 
-				std::filesystem::path filename(output_file);
-
-				if (animate) {
-					std::stringstream str;
-					str << std::setfill('0') << std::setw(4) << frame;
-
-					std::error_code ec;
-					if (std::filesystem::is_directory(filename, ec) ) {
-						//numbered files within the directory:
-						filename = filename / (str.str() + ".png");
-					} else {
-						//number goes after the stem:
-						std::filesystem::path ext = filename.extension();
-						filename.replace_extension("");
-						filename += str.str();
-						filename += ext;
+					float percent = 100.0f * f;
+					if (percent < 10.0f) std::cout << " ";
+					std::cout << std::setprecision(2) << std::fixed;
+					std::cout << percent << "%    \r";
+					std::cout.flush();
+				};
+
+				std::mutex report_mut;
+				float percent_done = 0.0f;
+				HDR_Image display_hdr;
+
+				auto report_callback = [&](auto&& report) {
+					std::lock_guard<std::mutex> lock(report_mut);
+					if (report.first > percent_done) {
+						percent_done = report.first;
+						display_hdr = std::move(report.second);
+					}
+				};
+
+				if (bucket_size != 0) {
+					//bucket rendering streams finished bands straight to the output file:
+					std::filesystem::path filename = frame_filename(frame, c, ".ppm");
+					if (filename.extension() != ".ppm") {
+						filename.replace_extension(".ppm");
+						info("Bucket rendering writes PPM images; writing to '%s'.", filename.generic_string().c_str());
 					}
-				}
 
-				uint32_t data_w, data_h;
-				std::vector<uint8_t> data;
-				display_hdr.tonemap_to(data, exp);
-				data_w = display_hdr.w;
-				data_h = display_hdr.h;
+					try {
+						PPM_Writer writer(filename.generic_string(), camera->film.width, camera->film.height, exp);
+						uint32_t rows = 0;
+						auto write_band = [&](uint32_t y_begin, HDR_Image &&band) {
+							writer.write_band(y_begin, band);
+							rows += band.h;
+							std::cout << "  " << rows << " / " << camera->film.height << " rows written    \r";
+							std::cout.flush();
+						};
+						if (pathtrace) {
+							bool quit = false;
+							pathtracer->render_bands(scene, camera_instances[c], bucket_size, write_band, &quit);
+						} else { assert(rasterize);
+							raster_job = Rasterizer::render_bands(std::move(raster_job), scene, *camera_instances[c], bucket_size, write_band, raster_settings);
+						}
+						std::cout << std::endl;
+						writer.close();
+					} catch (std::exception const &e) {
+						warn("ERROR: Failed to write output to '%s': %s", filename.generic_string().c_str(), e.what());
+						return 1;
+					}
+					std::cout << "Wrote result to '" << filename.generic_string() << "'." << std::endl;
+
+				} else if (pathtrace) {
+					bool quit = false;
+					PT::Crop crop;
+					if (!crop_window.empty()) {
+						crop.x_begin = crop_window[0];
+						crop.y_begin = crop_window[1];
+						crop.x_end = crop_window[2];
+						crop.y_end = crop_window[3];
+					}
 
-				stbi_flip_vertically_on_write(true);
-				if (!stbi_write_png(filename.generic_string().c_str(), data_w, data_h, 4, data.data(), data_w * 4)) {
-					warn("ERROR: Failed to write output to '%s'", filename.generic_string().c_str());
-					return 1;
+					//with --crop-samples, the crop window is refined after rendering everything:
+					bool refine = (crop_samples != 0);
+					pathtracer->render(scene, camera_instances[c], report_callback, &quit, false, refine ? PT::Crop{} : crop);
+
+					while (pathtracer->in_progress()) {
+						print_progress(percent_done);
+						std::this_thread::sleep_for(std::chrono::milliseconds(250));
+					}
+					std::cout << std::endl;
+
+					if (refine) {
+						info("\trefining crop window...");
+						{
+							std::lock_guard<std::mutex> lock(report_mut);
+							percent_done = 0.0f;
+						}
+						//(the pathtracer copies the camera, so the sample count can be swapped just for this call)
+						uint32_t samples = camera->film.samples;
+						camera->film.samples = crop_samples;
+						pathtracer->render(scene, camera_instances[c], report_callback, &quit, true, crop);
+						camera->film.samples = samples;
+
+						while (pathtracer->in_progress()) {
+							print_progress(percent_done);
+							std::this_thread::sleep_for(std::chrono::milliseconds(250));
+						}
+						std::cout << std::endl;
+					}
+
+				} else { assert(rasterize);
+
+					Rasterizer rasterizer(std::move(raster_job), scene, *camera_instances[c], std::move(report_callback), raster_settings);
+					while (rasterizer.in_progress()) {
+						print_progress(percent_done);
+						std::this_thread::sleep_for(std::chrono::milliseconds(250));
+					}
+					std::cout << std::endl;
+					raster_job = rasterizer.release();
 				}
-				std::cout << "Wrote result to '" << filename.generic_string() << "'." << std::endl;
+				info("\tdone.");
+
+				//write frame (bucket rendering has already written it):
+				if (bucket_size == 0 && !write_frame(frame, c, std::move(display_hdr))) return 1;
 			}
 
 			//advance (if animating):
@@ -349,13 +601,13 @@ int main(int argc, char** argv) {
 				info("Advancing %d -> %d", frame, frame + 1);
 				Scene::StepOpts opts;
 				opts.use_bvh = !no_bvh;
-				opts.thread_pool = nullptr; //TODO
+				opts.thread_pool = &thread_pool;
 				scene.step(animator, float(frame), float(frame + 1), 1.0f / animator.frame_rate, opts);
 			}
 
 		}
 
-		return 0;
+		return image_writer.finish() ? 0 : 1;
 	}
 
 
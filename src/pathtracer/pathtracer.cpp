@@ -341,6 +341,8 @@ void Pathtracer::build_scene(Scene& scene_) {
 			scene = Aggregate(List<Instance>(std::move(objects)));
 		}
 	}
+
+	scene_built = true;
 }
 
 void Pathtracer::set_camera(std::shared_ptr<::Instance::Camera> camera_) {
@@ -353,9 +355,14 @@ void Pathtracer::set_camera(std::shared_ptr<::Instance::Camera> camera_) {
 }
 
 void Pathtracer::use_bvh(bool bvh) {
+	if (bvh != scene_use_bvh) scene_built = false;
 	scene_use_bvh = bvh;
 }
 
+void Pathtracer::reuse_scene(bool reuse) {
+	scene_reuse = reuse;
+}
+
 void Pathtracer::log_ray(const Ray& ray, float t, Spectrum color) {
 	std::lock_guard<std::mutex> lock(ray_log_mut);
 	ray_log.push_back(Ray_Log{ray, t, color});
@@ -367,12 +374,12 @@ void Pathtracer::accumulate(Tile const &tile, const HDR_Image& data) {
 
 	for (uint32_t py = tile.y_begin; py < tile.y_end; ++py) {
 		for (uint32_t px = tile.x_begin; px < tile.x_end; ++px) {
-			uint32_t idx = py * accumulator_w + px;
+			uint32_t idx = (py - accumulator_y) * accumulator_w + px;
 			uint32_t &samples = accumulator_samples[idx];
 			std::array< int64_t, 3 > &spectrum = accumulator[idx];
 
 			//convert to 40.24 fixed point and add:
-			const Spectrum& n = data.at(px, py);
+			const Spectrum& n = data.at(px - tile.x_begin, py - tile.y_begin);
 			spectrum[0] += int64_t(n.r * (1ll<<24ll));
 			spectrum[1] += int64_t(n.g * (1ll<<24ll));
 			spectrum[2] += int64_t(n.b * (1ll<<24ll));
@@ -401,7 +408,8 @@ HDR_Image Pathtracer::accumulator_to_image() const {
 void Pathtracer::do_trace(RNG &rng, Tile const &tile) {
 	//A3T1 - Step 0: understand this function!
 
-	HDR_Image sample(camera.film.width, camera.film.height, Spectrum(0.0f, 0.0f, 0.0f));
+	//samples for the pixels of this tile (sample.at(0,0) is pixel (x_begin, y_begin)):
+	HDR_Image sample(tile.x_end - tile.x_begin, tile.y_end - tile.y_begin, Spectrum(0.0f, 0.0f, 0.0f));
 	for (uint32_t py = tile.y_begin; py < tile.y_end; ++py) {
 		for (uint32_t px = tile.x_begin; px < tile.x_end; ++px) {
 			for (uint32_t s = tile.s_begin; s < tile.s_end; ++s) {
@@ -423,7 +431,7 @@ void Pathtracer::do_trace(RNG &rng, Tile const &tile) {
 				Spectrum p = (emissive + light) / pdf;
 
 				if (p.valid()) {
-					sample.at(px, py) += p;
+					sample.at(px - tile.x_begin, py - tile.y_begin) += p;
 				}
 
 				if (cancel_flag && *cancel_flag) return;
@@ -447,7 +455,7 @@ uint32_t Pathtracer::visualize_bvh(GL::Lines& lines, GL::Lines& active, uint32_t
 
 void Pathtracer::render(Scene& scene_, std::shared_ptr<::Instance::Camera> camera_,
                         std::function<void(Render_Report &&)>&& f, bool* quit,
-                        bool add_samples) {
+                        bool add_samples, Crop const &crop) {
 	assert(camera_);
 	assert(!camera_->camera.expired());
 
@@ -464,10 +472,11 @@ void Pathtracer::render(Scene& scene_, std::shared_ptr<::Instance::Camera> camer
 
 	if (!add_samples) {
 		build_timer.reset();
-		build_scene(scene_);
+		if (!(scene_reuse && scene_built)) build_scene(scene_);
 		build_timer.pause();
 		accumulator_w = camera.film.width;
 		accumulator_h = camera.film.height;
+		accumulator_y = 0;
 		std::array< int64_t, 3 > zero;
 		zero.fill(0);
 		accumulator.assign(accumulator_w * accumulator_h, zero);
@@ -490,10 +499,16 @@ void Pathtracer::render(Scene& scene_, std::shared_ptr<::Instance::Camera> camer
 	RNG seeds_rng;
 	if (RNG::fixed_seed != 0) seeds_rng.seed(RNG::fixed_seed);
 
-	for (uint32_t y_begin = 0; y_begin < camera.film.height; y_begin += tile_height) {
-		uint32_t y_end = std::min(y_begin + tile_height, camera.film.height);
-		for (uint32_t x_begin = 0; x_begin < camera.film.width; x_begin += tile_width) {
-			uint32_t x_end = std::min(x_begin + tile_width, camera.film.width);
+	//only trace pixels inside the crop window:
+	uint32_t x_min = std::min(crop.x_begin, camera.film.width);
+	uint32_t x_max = std::min(crop.x_end, camera.film.width);
+	uint32_t y_min = std::min(crop.y_begin, camera.film.height);
+	uint32_t y_max = std::min(crop.y_end, camera.film.height);
+
+	for (uint32_t y_begin = y_min; y_begin < y_max; y_begin += tile_height) {
+		uint32_t y_end = std::min(y_begin + tile_height, y_max);
+		for (uint32_t x_begin = x_min; x_begin < x_max; x_begin += tile_width) {
+			uint32_t x_end = std::min(x_begin + tile_width, x_max);
 			for (uint32_t s_begin = 0; s_begin < camera.film.samples; s_begin += tile_samples) {
 				uint32_t s_end = std::min(s_begin + tile_samples, camera.film.samples);
 				uint32_t seed = seeds_rng.mt();
@@ -503,12 +518,12 @@ void Pathtracer::render(Scene& scene_, std::shared_ptr<::Instance::Camera> camer
 	}
 
 	//a bit of flare -- do the tiles in a fancy order:
-	std::stable_sort(tiles.begin(), tiles.end(), [this](Tile const &a, Tile const &b){
-		//do tiles from the inside out:
-		auto distance_from_center = [this](Tile const &t) {
+	std::stable_sort(tiles.begin(), tiles.end(), [&](Tile const &a, Tile const &b){
+		//do tiles from the inside (of the crop window) out:
+		auto distance_from_center = [&](Tile const &t) {
 			return Vec2(
-				0.5f * (t.x_begin + t.x_end) - camera.film.width * 0.5f, 
-				0.5f * (t.y_begin + t.y_end) - camera.film.height * 0.5f
+				0.5f * (t.x_begin + t.x_end) - (x_min + x_max) * 0.5f,
+				0.5f * (t.y_begin + t.y_end) - (y_min + y_max) * 0.5f
 			).norm();
 		};
 		float da = distance_from_center(a);
@@ -520,6 +535,13 @@ void Pathtracer::render(Scene& scene_, std::shared_ptr<::Instance::Camera> camer
 	});
 
 
+	//(empty crop window => nothing to trace)
+	if (tiles.empty()) {
+		render_timer.pause();
+		report_fn({1.0f, accumulator_to_image()});
+		return;
+	}
+
 	//actually launch the render jobs:
 	total_tiles = uint32_t(tiles.size());
 	for (auto const &tile : tiles) {
@@ -541,6 +563,77 @@ void Pathtracer::render(Scene& scene_, std::shared_ptr<::Instance::Camera> camer
 	}
 }
 
+void Pathtracer::render_bands(Scene& scene_, std::shared_ptr<::Instance::Camera> camera_,
+                              uint32_t bucket_size,
+                              std::function<void(uint32_t y_begin, HDR_Image &&band)> const &band_fn,
+                              bool* quit) {
+	assert(camera_);
+	assert(!camera_->camera.expired());
+	assert(bucket_size > 0);
+
+	cancel();
+	cancel_flag = quit;
+	report_fn = [](Render_Report &&) {};
+
+	set_camera(camera_);
+
+	build_timer.reset();
+	if (!(scene_reuse && scene_built)) build_scene(scene_);
+	build_timer.pause();
+	ray_log.clear();
+
+	render_timer.reset();
+
+	constexpr uint32_t tile_samples = 50;
+
+	RNG seeds_rng;
+	if (RNG::fixed_seed != 0) seeds_rng.seed(RNG::fixed_seed);
+
+	for (uint32_t y_end = camera.film.height; y_end > 0; ) {
+		uint32_t y_begin = (y_end > bucket_size ? y_end - bucket_size : 0);
+
+		//accumulator only holds this band:
+		accumulator_w = camera.film.width;
+		accumulator_h = y_end - y_begin;
+		accumulator_y = y_begin;
+		std::array< int64_t, 3 > zero;
+		zero.fill(0);
+		accumulator.assign(accumulator_w * accumulator_h, zero);
+		accumulator_samples.assign(accumulator_w * accumulator_h, 0);
+
+		//trace the band's buckets and wait for them to finish:
+		std::vector< std::future< void > > traced;
+		for (uint32_t x_begin = 0; x_begin < camera.film.width; x_begin += bucket_size) {
+			uint32_t x_end = std::min(x_begin + bucket_size, camera.film.width);
+			for (uint32_t s_begin = 0; s_begin < camera.film.samples; s_begin += tile_samples) {
+				uint32_t s_end = std::min(s_begin + tile_samples, camera.film.samples);
+				uint32_t seed = seeds_rng.mt();
+				Tile tile{seed, x_begin, x_end, y_begin, y_end, s_begin, s_end};
+				traced.emplace_back(thread_pool.enqueue([tile, this]() {
+					RNG rng(tile.seed);
+					do_trace(rng, tile);
+				}));
+			}
+		}
+		for (auto &t : traced) {
+			t.get();
+		}
+		if (quit && *quit) break;
+
+		band_fn(y_begin, accumulator_to_image());
+
+		y_end = y_begin;
+	}
+
+	//the accumulator doesn't hold a whole image, so don't let a later render add samples to it:
+	accumulator_w = accumulator_h = 0;
+	accumulator_y = 0;
+	accumulator.clear();
+	accumulator_samples.clear();
+
+	render_timer.pause();
+}
+
 void Pathtracer::cancel() {
 	if (cancel_flag) *cancel_flag = true;
 	thread_pool.clear();
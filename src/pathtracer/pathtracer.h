@@ -16,6 +16,13 @@
 
 namespace PT {
 
+//a region of the film in pixels ([x_begin,x_end) x [y_begin,y_end), bottom-left origin);
+// the default covers the whole film:
+struct Crop {
+	uint32_t x_begin = 0, x_end = -1U;
+	uint32_t y_begin = 0, y_end = -1U;
+};
+
 class Pathtracer {
 public:
 	struct Shading_Info {
@@ -35,13 +42,26 @@ public:
 	~Pathtracer();
 
 	void use_bvh(bool use_bvh);
+	//when set, render() and render_bands() keep the previously built scene instead of rebuilding
+	// it (for rendering an unchanged scene through several cameras):
+	void reuse_scene(bool reuse);
 	uint32_t visualize_bvh(GL::Lines& lines, GL::Lines& active, uint32_t level);
 	const std::vector<Ray_Log> copy_ray_log(); //copy ray log (with proper locking)
 
 	using Render_Report = std::pair<float, HDR_Image>;
+	//only tiles inside crop (clamped to the film) are traced; pixels outside it keep whatever the
+	// accumulator holds, so with add_samples a region of an earlier render can be refined:
 	void render(Scene& scene, std::shared_ptr<::Instance::Camera> camera,
-	            std::function<void(Render_Report &&)>&& f, bool* quit, bool add_samples = false);
+	            std::function<void(Render_Report &&)>&& f, bool* quit, bool add_samples = false,
+	            Crop const &crop = Crop{});
 	
+	//bucket rendering (blocks until done): traces the film in horizontal bands of bucket_size-tall
+	// tiles and hands each finished band (and the row it starts at) to band_fn, top band first.
+	// Only the current band is accumulated, so memory use grows with film width * bucket_size
+	// rather than with the film size:
+	void render_bands(Scene& scene, std::shared_ptr<::Instance::Camera> camera, uint32_t bucket_size,
+	                  std::function<void(uint32_t y_begin, HDR_Image &&band)> const &band_fn, bool* quit);
+
 	bool in_progress() const;
 	std::pair<float, float> completion_time() const;
 
@@ -73,10 +93,13 @@ private:
 
 	Thread_Pool thread_pool;
 	bool scene_use_bvh = true;
+	bool scene_reuse = false;
+	bool scene_built = false; //has build_scene() been run with the current settings?
 	Timer render_timer, build_timer;
 
 	std::mutex accumulator_mut;
 	uint32_t accumulator_w = 0, accumulator_h = 0;
+	uint32_t accumulator_y = 0; //first film row stored in the accumulator (nonzero when rendering bands)
 	//accumulator will store spectrums as 40.24 fixed point to avoid order-of-addition nondeterminism:
 	std::vector< std::array< int64_t, 3 > > accumulator;
 	//accumulator will store sample counts as well:
@@ -0,0 +1,276 @@
+// clang-format off
+#include "benchmark.h"
+
+#include "../lib/log.h"
+#include "../scene/texture.h"
+#include "../util/timer.h"
+#include "framebuffer.h"
+#include "raster_pipelines.h"
+#include "sample_pattern.h"
+
+namespace RasterBenchmark {
+
+using Vertex = RasterPipelines::Lambertian_Replace_Less_Correct_Vertex;
+
+// vertex with position given directly in clip space (workloads are drawn with identity transforms):
+static Vertex make_vertex(float x, float y, float z, float u, float v) {
+	Vertex vertex;
+	vertex.attributes[Programs::Lambertian::VA_PositionX] = x;
+	vertex.attributes[Programs::Lambertian::VA_PositionY] = y;
+	vertex.attributes[Programs::Lambertian::VA_PositionZ] = z;
+	vertex.attributes[Programs::Lambertian::VA_NormalX] = 0.0f;
+	vertex.attributes[Programs::Lambertian::VA_NormalY] = 0.0f;
+	vertex.attributes[Programs::Lambertian::VA_NormalZ] = 1.0f;
+	vertex.attributes[Programs::Lambertian::VA_TexCoordU] = u;
+	vertex.attributes[Programs::Lambertian::VA_TexCoordV] = v;
+	return vertex;
+}
+
+// adds two triangles covering the clip-space rectangle [x0,x1]x[y0,y1] at depth z:
+static void add_quad(std::vector<Vertex>* vertices, float x0, float y0, float x1, float y1, float z) {
+	auto corner = [&](float x, float y) {
+		return make_vertex(x, y, z, 0.5f * x + 0.5f, 0.5f * y + 0.5f);
+	};
+	vertices->emplace_back(corner(x0, y0));
+	vertices->emplace_back(corner(x1, y0));
+	vertices->emplace_back(corner(x1, y1));
+	vertices->emplace_back(corner(x0, y0));
+	vertices->emplace_back(corner(x1, y1));
+	vertices->emplace_back(corner(x0, y1));
+}
+
+// synthetic workloads:
+struct Workload {
+	std::string name;
+	std::vector<Vertex> vertices; // triangles or lines, depending on the workload
+};
+
+static std::vector<Workload> triangle_workloads(uint32_t width, uint32_t height) {
+	std::vector<Workload> workloads;
+
+	{ // many small triangles: a grid of 4x4-pixel cells, two triangles each:
+		Workload w{"small_triangles", {}};
+		uint32_t cells_x = std::max(1u, width / 4);
+		uint32_t cells_y = std::max(1u, height / 4);
+		for (uint32_t y = 0; y < cells_y; ++y) {
+			for (uint32_t x = 0; x < cells_x; ++x) {
+				add_quad(&w.vertices, 2.0f * x / cells_x - 1.0f, 2.0f * y / cells_y - 1.0f,
+				         2.0f * (x + 1) / cells_x - 1.0f, 2.0f * (y + 1) / cells_y - 1.0f, 0.0f);
+			}
+		}
+		workloads.emplace_back(std::move(w));
+	}
+
+	{ // a few huge triangles, each covering the whole framebuffer, front to back:
+		Workload w{"large_triangles", {}};
+		for (uint32_t i = 0; i < 8; ++i) {
+			float z = -0.5f + 0.1f * i;
+			w.vertices.emplace_back(make_vertex(-1.0f, -1.0f, z, 0.0f, 0.0f));
+			w.vertices.emplace_back(make_vertex( 3.0f, -1.0f, z, 2.0f, 0.0f));
+			w.vertices.emplace_back(make_vertex(-1.0f,  3.0f, z, 0.0f, 2.0f));
+		}
+		workloads.emplace_back(std::move(w));
+	}
+
+	{ // high overdraw: full-screen quads drawn back to front (so every layer passes a depth test):
+		Workload w{"overdraw", {}};
+		for (uint32_t i = 0; i < 32; ++i) {
+			add_quad(&w.vertices, -1.0f, -1.0f, 1.0f, 1.0f, 0.9f - 0.05f * i);
+		}
+		workloads.emplace_back(std::move(w));
+	}
+
+	{ // triangles that cross the frustum sides and near plane (exercises clipping):
+		Workload w{"clipped_triangles", {}};
+		for (uint32_t i = 0; i < 256; ++i) {
+			float a = 0.0245f * i;
+			float c = std::cos(a), s = std::sin(a);
+			w.vertices.emplace_back(make_vertex(0.0f, 0.0f, -1.5f, 0.5f, 0.5f));
+			w.vertices.emplace_back(make_vertex(3.0f * c, 3.0f * s, 0.5f, c, s));
+			w.vertices.emplace_back(make_vertex(-3.0f * s, 3.0f * c, 0.5f, -s, c));
+		}
+		workloads.emplace_back(std::move(w));
+	}
+
+	return workloads;
+}
+
+static std::vector<Workload> line_workloads(uint32_t width, uint32_t height) {
+	std::vector<Workload> workloads;
+
+	{ // wireframe of an 8x8-pixel grid (as drawn for DrawStyle::Wireframe instances):
+		Workload w{"wireframe", {}};
+		uint32_t cells_x = std::max(1u, width / 8);
+		uint32_t cells_y = std::max(1u, height / 8);
+		for (uint32_t y = 0; y < cells_y; ++y) {
+			for (uint32_t x = 0; x < cells_x; ++x) {
+				float x0 = 2.0f * x / cells_x - 1.0f, x1 = 2.0f * (x + 1) / cells_x - 1.0f;
+				float y0 = 2.0f * y / cells_y - 1.0f, y1 = 2.0f * (y + 1) / cells_y - 1.0f;
+				w.vertices.emplace_back(make_vertex(x0, y0, 0.0f, 0.0f, 0.0f));
+				w.vertices.emplace_back(make_vertex(x1, y0, 0.0f, 1.0f, 0.0f));
+				w.vertices.emplace_back(make_vertex(x0, y0, 0.0f, 0.0f, 0.0f));
+				w.vertices.emplace_back(make_vertex(x0, y1, 0.0f, 0.0f, 1.0f));
+				w.vertices.emplace_back(make_vertex(x0, y0, 0.0f, 0.0f, 0.0f));
+				w.vertices.emplace_back(make_vertex(x1, y1, 0.0f, 1.0f, 1.0f));
+			}
+		}
+		workloads.emplace_back(std::move(w));
+	}
+
+	{ // long lines fanning out past the edges of the framebuffer:
+		Workload w{"long_lines", {}};
+		for (uint32_t i = 0; i < 1024; ++i) {
+			float a = 0.00614f * i;
+			w.vertices.emplace_back(make_vertex(0.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+			w.vertices.emplace_back(make_vertex(2.0f * std::cos(a), 2.0f * std::sin(a), 0.0f, 1.0f, 1.0f));
+		}
+		workloads.emplace_back(std::move(w));
+	}
+
+	return workloads;
+}
+
+// checkerboard texture, so fragment shading does real texture lookups:
+static HDR_Image checker_image() {
+	HDR_Image image(64, 64);
+	for (uint32_t y = 0; y < image.h; ++y) {
+		for (uint32_t x = 0; x < image.w; ++x) {
+			image.at(x, y) = ((x / 8 + y / 8) % 2 ? Spectrum(0.9f, 0.8f, 0.7f) : Spectrum(0.2f, 0.3f, 0.4f));
+		}
+	}
+	return image;
+}
+
+// type tag, used to hand a pipeline type to a generic lambda:
+template<typename T> struct Type {
+	using type = T;
+};
+
+// draw 'workload' through pipeline P until at least min_seconds have passed:
+template<typename P>
+static Result measure(std::string const& name, Workload const& workload,
+                      Programs::Lambertian::Parameters const& parameters,
+                      Framebuffer* framebuffer, float min_seconds) {
+	Result result;
+	result.name = name;
+
+	Timer timer;
+	do {
+		framebuffer->clear();
+		P::run(workload.vertices, parameters, framebuffer, &result.stats);
+		result.runs += 1;
+	} while (timer.s() < min_seconds);
+	result.seconds = timer.s();
+
+	PipelineStats const& stats = result.stats;
+	double stage_seconds = stats.shade_vertex_seconds + stats.clip_seconds + stats.rasterize_seconds + stats.fragment_seconds;
+	auto percent = [&](double seconds) {
+		return stage_seconds > 0.0 ? 100.0 * seconds / stage_seconds : 0.0;
+	};
+	log("%-56s %6u runs %9.3f ms/run %9.3f Mprim/s %9.3f Mfrag/s | vertex %4.1f%% clip %4.1f%% raster %4.1f%% fragment %4.1f%%\n",
+	    name.c_str(), result.runs, 1e3 * result.seconds / result.runs,
+	    1e-6 * stats.primitives / result.seconds, 1e-6 * stats.fragments / result.seconds,
+	    percent(stats.shade_vertex_seconds), percent(stats.clip_seconds),
+	    percent(stats.rasterize_seconds), percent(stats.fragment_seconds));
+
+	return result;
+}
+
+std::vector<Result> run(std::string const& filter, uint32_t width, uint32_t height,
+                        float min_seconds) {
+
+	Framebuffer framebuffer(width, height, *SamplePattern::from_id(1));
+
+	Textures::Image image(Textures::Image::Sampler::nearest, checker_image());
+
+	Programs::Lambertian::Parameters parameters;
+	parameters.local_to_clip = Mat4::I;
+	parameters.normal_to_world = Mat4::I;
+	parameters.image = &image;
+	parameters.sun_energy = Spectrum(1.0f, 1.0f, 1.0f);
+	parameters.sun_direction = Vec3(0.0f, 0.0f, 1.0f);
+	parameters.sky_energy = Spectrum(0.5f, 0.5f, 0.5f);
+	parameters.ground_energy = Spectrum(0.01f, 0.01f, 0.01f);
+	parameters.sky_direction = Vec3(0.0f, 1.0f, 0.0f);
+	parameters.opacity = 0.5f; // (so blending does something)
+
+	log("\nRasterizer benchmarks including '%s' (%ux%u framebuffer, at least %.2fs each):\n\n",
+	    filter.c_str(), width, height, min_seconds);
+
+	std::vector<Result> results;
+
+	// run workload through pipeline P if the resulting name passes the filter:
+	// (names drop the "Lambertian_" prefix and "_Pipeline" suffix)
+	auto bench = [&](Workload const& workload, std::string pipeline, auto pipeline_type) {
+		using P = typename decltype(pipeline_type)::type;
+		pipeline = pipeline.substr(std::string("Lambertian_").size());
+		pipeline = pipeline.substr(0, pipeline.size() - std::string("_Pipeline").size());
+		std::string name = workload.name + "." + pipeline;
+		if (name.find(filter) == std::string::npos) return;
+		results.emplace_back(measure<P>(name, workload, parameters, &framebuffer, min_seconds));
+	};
+
+	#define BENCH(W, P) bench(W, #P, Type<RasterPipelines::P>{})
+
+	for (Workload const& w : triangle_workloads(width, height)) {
+		BENCH(w, Lambertian_Triangles_Replace_Always_Flat_Pipeline);
+		BENCH(w, Lambertian_Triangles_Replace_Always_Smooth_Pipeline);
+		BENCH(w, Lambertian_Triangles_Replace_Always_Correct_Pipeline);
+		BENCH(w, Lambertian_Triangles_Replace_Never_Flat_Pipeline);
+		BENCH(w, Lambertian_Triangles_Replace_Never_Smooth_Pipeline);
+		BENCH(w, Lambertian_Triangles_Replace_Never_Correct_Pipeline);
+		BENCH(w, Lambertian_Triangles_Replace_Less_Flat_Pipeline);
+		BENCH(w, Lambertian_Triangles_Replace_Less_Smooth_Pipeline);
+		BENCH(w, Lambertian_Triangles_Replace_Less_Correct_Pipeline);
+		BENCH(w, Lambertian_Triangles_Add_Always_Flat_Pipeline);
+		BENCH(w, Lambertian_Triangles_Add_Always_Smooth_Pipeline);
+		BENCH(w, Lambertian_Triangles_Add_Always_Correct_Pipeline);
+		BENCH(w, Lambertian_Triangles_Add_Never_Flat_Pipeline);
+		BENCH(w, Lambertian_Triangles_Add_Never_Smooth_Pipeline);
+		BENCH(w, Lambertian_Triangles_Add_Never_Correct_Pipeline);
+		BENCH(w, Lambertian_Triangles_Add_Less_Flat_Pipeline);
+		BENCH(w, Lambertian_Triangles_Add_Less_Smooth_Pipeline);
+		BENCH(w, Lambertian_Triangles_Add_Less_Correct_Pipeline);
+		BENCH(w, Lambertian_Triangles_Over_Always_Flat_Pipeline);
+		BENCH(w, Lambertian_Triangles_Over_Always_Smooth_Pipeline);
+		BENCH(w, Lambertian_Triangles_Over_Always_Correct_Pipeline);
+		BENCH(w, Lambertian_Triangles_Over_Never_Flat_Pipeline);
+		BENCH(w, Lambertian_Triangles_Over_Never_Smooth_Pipeline);
+		BENCH(w, Lambertian_Triangles_Over_Never_Correct_Pipeline);
+		BENCH(w, Lambertian_Triangles_Over_Less_Flat_Pipeline);
+		BENCH(w, Lambertian_Triangles_Over_Less_Smooth_Pipeline);
+		BENCH(w, Lambertian_Triangles_Over_Less_Correct_Pipeline);
+	}
+	for (Workload const& w : line_workloads(width, height)) {
+		BENCH(w, Lambertian_Lines_Replace_Always_Pipeline);
+		BENCH(w, Lambertian_Lines_Replace_Never_Pipeline);
+		BENCH(w, Lambertian_Lines_Replace_Less_Pipeline);
+		BENCH(w, Lambertian_Lines_Add_Always_Pipeline);
+		BENCH(w, Lambertian_Lines_Add_Never_Pipeline);
+		BENCH(w, Lambertian_Lines_Add_Less_Pipeline);
+		BENCH(w, Lambertian_Lines_Over_Always_Pipeline);
+		BENCH(w, Lambertian_Lines_Over_Never_Pipeline);
+		BENCH(w, Lambertian_Lines_Over_Less_Pipeline);
+	}
+
+	#undef BENCH
+
+	// totals:
+	Result total;
+	for (Result const& r : results) {
+		total.runs += r.runs;
+		total.seconds += r.seconds;
+		total.stats.primitives += r.stats.primitives;
+		total.stats.fragments += r.stats.fragments;
+	}
+	if (total.seconds > 0.0) {
+		log("\nRan %u benchmarks: %.3f Mprim/s, %.3f Mfrag/s overall.\n\n", uint32_t(results.size()),
+		    1e-6 * total.stats.primitives / total.seconds, 1e-6 * total.stats.fragments / total.seconds);
+	} else {
+		log("\nNo benchmarks include '%s'.\n\n", filter.c_str());
+	}
+
+	return results;
+}
+
+} // namespace RasterBenchmark
@@ -0,0 +1,29 @@
+#pragma once
+
+/*
+ * `RasterBenchmark` measures software rasterizer throughput on synthetic workloads, drawn with
+ * the same Pipeline configurations RasterJob uses (raster_pipelines.h).
+ *
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pipeline.h"
+
+namespace RasterBenchmark {
+
+struct Result {
+	std::string name;     // "workload.pipeline"
+	uint32_t runs = 0;    // number of times the workload was drawn
+	double seconds = 0.0; // total time over all runs
+	PipelineStats stats;  // accumulated over all runs
+};
+
+// run every benchmark whose name includes 'filter' on a (width x height) framebuffer, drawing
+// each workload repeatedly for at least 'min_seconds'; results are logged as they complete:
+std::vector<Result> run(std::string const& filter, uint32_t width, uint32_t height,
+                        float min_seconds);
+
+} // namespace RasterBenchmark
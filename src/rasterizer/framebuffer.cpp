@@ -21,8 +21,14 @@ Framebuffer::Framebuffer(uint32_t width_, uint32_t height_, SamplePattern const&
 		width * height * static_cast<uint32_t>(sample_pattern.centers_and_weights.size());
 
 	// allocate storage for color and depth samples:
-	colors.assign(samples, Spectrum{0.0f, 0.0f, 0.0f});
-	depths.assign(samples, 1.0f);
+	colors.resize(samples);
+	depths.resize(samples);
+	clear();
+}
+
+void Framebuffer::clear() {
+	std::fill(colors.begin(), colors.end(), Spectrum{0.0f, 0.0f, 0.0f});
+	std::fill(depths.begin(), depths.end(), 1.0f);
 }
 
 HDR_Image Framebuffer::resolve_colors() const {
@@ -39,3 +45,56 @@ HDR_Image Framebuffer::resolve_colors() const {
 
 	return image;
 }
+
+void Framebuffer::clear_gbuffer(uint32_t stride) {
+	gbuffer_stride = stride;
+	gbuffer.resize(colors.size() * stride);
+	gbuffer_ids.assign(colors.size(), GBufferEmpty);
+	gbuffer_id = 0;
+}
+
+void Framebuffer::clear_oit(bool kbuffer) {
+	oit_accum.assign(colors.size(), Spectrum{0.0f, 0.0f, 0.0f});
+	oit_weight.assign(colors.size(), 0.0f);
+	oit_revealage.assign(colors.size(), 1.0f);
+	if (kbuffer) {
+		oit_layers.assign(colors.size() * KBufferLayers, OITFragment{Spectrum{}, 0.0f, 1.0f});
+		oit_counts.assign(colors.size(), 0);
+	} else {
+		oit_layers.clear();
+		oit_counts.clear();
+	}
+}
+
+void Framebuffer::resolve_oit() {
+	if (oit_accum.size() != colors.size()) return; //nothing was allocated
+
+	bool kbuffer = !oit_counts.empty();
+
+	for (uint32_t i = 0; i < colors.size(); ++i) {
+		Spectrum& color = colors[i];
+
+		// weighted-blended composite (also holds k-buffer overflow, which is always farther than
+		// the stored layers, so it is composited first):
+		float revealage = oit_revealage[i];
+		if (revealage < 1.0f) {
+			Spectrum average = oit_accum[i] * (1.0f / std::max(oit_weight[i], 1e-5f));
+			color = average * (1.0f - revealage) + color * revealage;
+		}
+
+		// k-buffer layers, "over" blended back-to-front:
+		if (kbuffer && oit_counts[i] > 0) {
+			OITFragment* layers = &oit_layers[i * KBufferLayers];
+			OITFragment* end = layers + oit_counts[i];
+			std::sort(layers, end, [](OITFragment const& a, OITFragment const& b) {
+				return a.depth > b.depth;
+			});
+			for (OITFragment const* f = layers; f != end; ++f) {
+				color = f->color * f->opacity + color * (1.0f - f->opacity);
+			}
+		}
+	}
+
+	// reset (but keep allocations) so a second resolve is a no-op:
+	clear_oit(kbuffer);
+}
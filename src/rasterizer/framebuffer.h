@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "../lib/spectrum.h"
@@ -21,6 +23,9 @@ struct Framebuffer {
 	//  - having an even size avoids some corner cases if you choose to rasterize with quadfrags
 	Framebuffer(uint32_t width, uint32_t height, SamplePattern const& sample_pattern);
 
+	// reset all color samples to black and depth samples to 1.0 (keeps allocations):
+	void clear();
+
 	const uint32_t width, height;
 	SamplePattern const& sample_pattern;
 
@@ -51,4 +56,82 @@ struct Framebuffer {
 
 	// resolve_colors creates a weighted average of the color samples:
 	HDR_Image resolve_colors() const;
+
+	// deferred shading storage (G-buffer), written by pipelines with Pipeline_GBufferWriteBit:
+	//  per sample, gbuffer_stride floats of fragment attributes followed by their derivatives, and
+	//  the value of gbuffer_id when the sample was written (or GBufferEmpty if never written):
+	static constexpr uint32_t GBufferEmpty = ~0u;
+
+	uint32_t gbuffer_stride = 0;
+	std::vector<float> gbuffer;
+	std::vector<uint32_t> gbuffer_ids;
+	uint32_t gbuffer_id = 0; // id stored with samples written by the next pipeline run
+
+	// (re-)allocate and clear G-buffer storage with 'stride' floats per sample:
+	void clear_gbuffer(uint32_t stride);
+
+	// order-independent transparency (OIT) storage, used by the Pipeline_Blend_OIT_* modes:
+	//  - weighted-blended OIT accumulates every fragment into a weighted color sum and a
+	//    product of transmittances, which resolve_oit() normalizes into a single composite;
+	//  - the k-buffer keeps the KBufferLayers nearest fragments per sample and composites them
+	//    in depth order; fragments that don't fit fall back to the weighted accumulators.
+	// these buffers are empty until allocated with clear_oit():
+	static constexpr uint32_t KBufferLayers = 4;
+
+	struct OITFragment {
+		Spectrum color;
+		float opacity;
+		float depth;
+	};
+
+	std::vector<Spectrum> oit_accum;    // sum of weight * opacity * color
+	std::vector<float> oit_weight;      // sum of weight * opacity
+	std::vector<float> oit_revealage;   // product of (1 - opacity)
+	std::vector<OITFragment> oit_layers; // KBufferLayers (unsorted) fragments per sample
+	std::vector<uint8_t> oit_counts;    // number of used layers per sample
+
+	// (re-)allocate and clear OIT storage; k-buffer layers are only allocated if 'kbuffer':
+	void clear_oit(bool kbuffer);
+
+	// composite OIT storage over the color samples (and clear it):
+	void resolve_oit();
+
+	// weighted-blended OIT: accumulate a fragment into sample s of pixel (x,y):
+	void oit_accumulate(uint32_t x, uint32_t y, uint32_t s, Spectrum const& color, float opacity,
+	                    float depth) {
+		accumulate_weighted(index(x, y, s), color, opacity, depth);
+	}
+
+	// k-buffer OIT: insert a fragment into sample s of pixel (x,y), evicting the farthest stored
+	// fragment (or the incoming one) to the weighted accumulators when the list is full:
+	void oit_insert(uint32_t x, uint32_t y, uint32_t s, Spectrum const& color, float opacity,
+	                float depth) {
+		uint32_t i = index(x, y, s);
+		OITFragment* layers = &oit_layers[i * KBufferLayers];
+		uint8_t& count = oit_counts[i];
+		if (count < KBufferLayers) {
+			layers[count++] = OITFragment{color, opacity, depth};
+			return;
+		}
+		OITFragment* farthest = std::max_element(
+			layers, layers + KBufferLayers,
+			[](OITFragment const& a, OITFragment const& b) { return a.depth < b.depth; });
+		if (depth < farthest->depth) {
+			accumulate_weighted(i, farthest->color, farthest->opacity, farthest->depth);
+			*farthest = OITFragment{color, opacity, depth};
+		} else {
+			accumulate_weighted(i, color, opacity, depth);
+		}
+	}
+
+private:
+	void accumulate_weighted(uint32_t i, Spectrum const& color, float opacity, float depth) {
+		// depth-based weight from McGuire and Bavoil, "Weighted Blended Order-Independent
+		// Transparency" (2013), eq. 10 -- nearer fragments contribute more to the average:
+		float d = 1.0f - std::clamp(depth, 0.0f, 1.0f);
+		float weight = opacity * std::clamp(3e3f * d * d * d, 1e-2f, 3e3f);
+		oit_accum[i] += color * weight;
+		oit_weight[i] += weight;
+		oit_revealage[i] *= 1.0f - opacity;
+	}
 };
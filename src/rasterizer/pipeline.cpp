@@ -1,20 +1,41 @@
 // clang-format off
 #include "pipeline.h"
 
+#include <chrono>
 #include <iostream>
 
 #include "../lib/log.h"
 #include "../lib/mathlib.h"
+#include "../scene/texture.h"
 #include "framebuffer.h"
 #include "sample_pattern.h"
 template<PrimitiveType primitive_type, class Program, uint32_t flags>
 void Pipeline<primitive_type, Program, flags>::run(std::vector<Vertex> const& vertices,
                                                    typename Program::Parameters const& parameters,
-                                                   Framebuffer* framebuffer_) {
+                                                   Framebuffer* framebuffer_,
+                                                   PipelineStats* stats) {
 	// Framebuffer must be non-null:
 	assert(framebuffer_);
 	auto& framebuffer = *framebuffer_;
 
+	// per-stage timing (only if stats were requested):
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point stage_start;
+	if (stats) stage_start = Clock::now();
+	auto end_stage = [&](double PipelineStats::*seconds) {
+		if (!stats) return;
+		Clock::time_point now = Clock::now();
+		stats->*seconds += std::chrono::duration<double>(now - stage_start).count();
+		stage_start = now;
+	};
+
+	// G-buffer (if used) must have been allocated for this program's attributes:
+	if constexpr ((flags & Pipeline_GBufferWriteBit) != 0) {
+		static_assert((flags & PipelineMask_Blend) == Pipeline_Blend_Replace, "Deferred shading only supports replace blending.");
+		assert(framebuffer.gbuffer_stride == FA + 2 * FD);
+		assert(framebuffer.gbuffer_ids.size() == framebuffer.colors.size());
+	}
+
 	// A1T7: sample loop
 	// TODO: update this function to rasterize to *all* sample locations in the framebuffer.
 	//  	 This will probably involve inserting a loop of the form:
@@ -34,6 +55,7 @@ void Pipeline<primitive_type, Program, flags>::run(std::vector<Vertex> const& ve
 		Program::shade_vertex(parameters, v.attributes, &sv.clip_position, &sv.attributes);
 		shaded_vertices.emplace_back(sv);
 	}
+	end_stage(&PipelineStats::shade_vertex_seconds);
 
 	//--------------------------
 	// assemble + clip + homogeneous divide vertices:
@@ -86,6 +108,7 @@ void Pipeline<primitive_type, Program, flags>::run(std::vector<Vertex> const& ve
 	} else {
 		static_assert(primitive_type == PrimitiveType::Lines, "Unsupported primitive type.");
 	}
+	end_stage(&PipelineStats::clip_seconds);
 
 	//--------------------------
 	// rasterize primitives:
@@ -107,11 +130,67 @@ void Pipeline<primitive_type, Program, flags>::run(std::vector<Vertex> const& ve
 	} else {
 		static_assert(primitive_type == PrimitiveType::Lines, "Unsupported primitive type.");
 	}
+	end_stage(&PipelineStats::rasterize_seconds);
 
 	//--------------------------
 	// depth test + shade + blend fragments:
 	uint32_t out_of_range = 0; // check if rasterization produced fragments outside framebuffer 
 							   // (indicates something is wrong with clipping)
+	uint32_t passed = 0; // fragments that passed the depth test (for stats)
+
+	// fragments that pass the depth test are shaded in blocks (of at most Textures::Image::BlockSize)
+	// through Program::shade_fragment_block, then blended in the order they arrived; shading doesn't
+	// read the framebuffer, so this matches shading and blending each fragment as it passes:
+	constexpr uint32_t BlockSize = Textures::Image::BlockSize;
+	std::array<std::array<float, FA>, BlockSize> block_attributes;
+	std::array<std::array<Vec2, FD>, BlockSize> block_derivatives;
+	std::array<ShadedFragment, BlockSize> block_shaded;
+	std::array<Spectrum, BlockSize> block_colors;
+	std::array<float, BlockSize> block_opacities;
+	uint32_t block_count = 0;
+
+	auto flush = [&]() {
+		if (block_count == 0) return;
+		Program::shade_fragment_block(parameters, block_count, block_attributes.data(),
+		                              block_derivatives.data(), block_colors.data(),
+		                              block_opacities.data());
+		for (uint32_t b = 0; b < block_count; ++b) {
+			ShadedFragment& sf = block_shaded[b];
+			sf.color = block_colors[b];
+			sf.opacity = block_opacities[b];
+
+			// write color to framebuffer if color writes aren't disabled:
+			if constexpr (!(flags & Pipeline_ColorWriteDisableBit)) {
+				// local name that refers to destination sample's color in framebuffer:
+				int32_t x = (int32_t)std::floor(sf.fb_position.x);
+				int32_t y = (int32_t)std::floor(sf.fb_position.y);
+				Spectrum& fb_color = framebuffer.color_at(x, y, 0);
+
+				// blend fragment:
+				if constexpr ((flags & PipelineMask_Blend) == Pipeline_Blend_Replace) {
+					fb_color = sf.color;
+				} else if constexpr ((flags & PipelineMask_Blend) == Pipeline_Blend_Add) {
+					// A1T4: Blend_Add
+					// TODO: framebuffer color should have fragment color multiplied by fragment opacity added to it.
+					fb_color = sf.color; //<-- replace this line
+				} else if constexpr ((flags & PipelineMask_Blend) == Pipeline_Blend_Over) {
+					// A1T4: Blend_Over
+					// TODO: set framebuffer color to the result of "over" blending (also called "alpha blending") the fragment color over the framebuffer color, using the fragment's opacity
+					// 		 You may assume that the framebuffer color has its alpha premultiplied already, and you just want to compute the resulting composite color
+					fb_color = sf.color; //<-- replace this line
+				} else if constexpr ((flags & PipelineMask_Blend) == Pipeline_Blend_OIT_Weighted) {
+					// order-independent transparency; composited later by Framebuffer::resolve_oit():
+					framebuffer.oit_accumulate(x, y, 0, sf.color, sf.opacity, sf.fb_position.z);
+				} else if constexpr ((flags & PipelineMask_Blend) == Pipeline_Blend_OIT_KBuffer) {
+					framebuffer.oit_insert(x, y, 0, sf.color, sf.opacity, sf.fb_position.z);
+				} else {
+					static_assert((flags & PipelineMask_Blend) <= Pipeline_Blend_OIT_KBuffer, "Unknown blending flag.");
+				}
+			}
+		}
+		block_count = 0;
+	};
+
 	for (auto const& f : fragments) {
 
 		// fragment location (in pixels):
@@ -127,9 +206,9 @@ void Pipeline<primitive_type, Program, flags>::run(std::vector<Vertex> const& ve
 			continue;
 		}
 
-		// local names that refer to destination sample in framebuffer:
+		// local name that refers to destination sample's depth in framebuffer:
+		// (its color is written once the fragment is shaded, see flush() above)
 		float& fb_depth = framebuffer.depth_at(x, y, 0);
-		Spectrum& fb_color = framebuffer.color_at(x, y, 0);
 
 
 		// depth test:
@@ -146,35 +225,46 @@ void Pipeline<primitive_type, Program, flags>::run(std::vector<Vertex> const& ve
 			static_assert((flags & PipelineMask_Depth) <= Pipeline_Depth_Always, "Unknown depth test flag.");
 		}
 
+		++passed;
+
 		// if depth test passes, and depth writes aren't disabled, write depth to depth buffer:
 		if constexpr (!(flags & Pipeline_DepthWriteDisableBit)) {
 			fb_depth = f.fb_position.z;
 		}
 
-		// shade fragment:
-		ShadedFragment sf;
-		sf.fb_position = f.fb_position;
-		Program::shade_fragment(parameters, f.attributes, f.derivatives, &sf.color, &sf.opacity);
-
-		// write color to framebuffer if color writes aren't disabled:
-		if constexpr (!(flags & Pipeline_ColorWriteDisableBit)) {
-			// blend fragment:
-			if constexpr ((flags & PipelineMask_Blend) == Pipeline_Blend_Replace) {
-				fb_color = sf.color;
-			} else if constexpr ((flags & PipelineMask_Blend) == Pipeline_Blend_Add) {
-				// A1T4: Blend_Add
-				// TODO: framebuffer color should have fragment color multiplied by fragment opacity added to it.
-				fb_color = sf.color; //<-- replace this line
-			} else if constexpr ((flags & PipelineMask_Blend) == Pipeline_Blend_Over) {
-				// A1T4: Blend_Over
-				// TODO: set framebuffer color to the result of "over" blending (also called "alpha blending") the fragment color over the framebuffer color, using the fragment's opacity
-				// 		 You may assume that the framebuffer color has its alpha premultiplied already, and you just want to compute the resulting composite color
-				fb_color = sf.color; //<-- replace this line
-			} else {
-				static_assert((flags & PipelineMask_Blend) <= Pipeline_Blend_Over, "Unknown blending flag.");
+		// deferred shading: store attributes for shade_deferred() instead of shading now:
+		if constexpr ((flags & Pipeline_GBufferWriteBit) != 0) {
+			uint32_t i = framebuffer.index(x, y, 0);
+			float* g = &framebuffer.gbuffer[i * framebuffer.gbuffer_stride];
+			for (uint32_t a = 0; a < FA; ++a) {
+				g[a] = f.attributes[a];
 			}
+			for (uint32_t d = 0; d < FD; ++d) {
+				g[FA + 2 * d + 0] = f.derivatives[d].x;
+				g[FA + 2 * d + 1] = f.derivatives[d].y;
+			}
+			framebuffer.gbuffer_ids[i] = framebuffer.gbuffer_id;
+			continue;
 		}
+
+		// queue fragment for shading:
+		block_shaded[block_count].fb_position = f.fb_position;
+		block_attributes[block_count] = f.attributes;
+		block_derivatives[block_count] = f.derivatives;
+		if (++block_count == BlockSize) flush();
 	}
+	flush();
+	end_stage(&PipelineStats::fragment_seconds);
+
+	if (stats) {
+		constexpr uint32_t per_primitive = (primitive_type == PrimitiveType::Lines ? 2 : 3);
+		stats->vertices += vertices.size();
+		stats->primitives += vertices.size() / per_primitive;
+		stats->clipped_primitives += clipped_vertices.size() / per_primitive;
+		stats->fragments += fragments.size();
+		stats->passed_fragments += passed;
+	}
+
 	if (out_of_range > 0) {
 		if constexpr (primitive_type == PrimitiveType::Lines) {
 			warn("Produced %d fragments outside framebuffer; this indicates something is likely "
@@ -188,6 +278,60 @@ void Pipeline<primitive_type, Program, flags>::run(std::vector<Vertex> const& ve
 	}
 }
 
+template<PrimitiveType primitive_type, class Program, uint32_t flags>
+void Pipeline<primitive_type, Program, flags>::shade_deferred(
+	std::vector<typename Program::Parameters> const& parameters, Framebuffer* framebuffer_,
+	uint32_t begin, uint32_t end) {
+	assert(framebuffer_);
+	auto& framebuffer = *framebuffer_;
+	assert(framebuffer.gbuffer_stride == FA + 2 * FD);
+	assert(end <= framebuffer.gbuffer_ids.size());
+
+	// visible samples are gathered into blocks that share parameters, then shaded together:
+	constexpr uint32_t BlockSize = Textures::Image::BlockSize;
+	std::array<std::array<float, FA>, BlockSize> attributes;
+	std::array<std::array<Vec2, FD>, BlockSize> derivatives;
+	std::array<uint32_t, BlockSize> indices;
+	std::array<Spectrum, BlockSize> colors;
+	std::array<float, BlockSize> opacities;
+	uint32_t count = 0;
+	uint32_t block_id = Framebuffer::GBufferEmpty;
+
+	auto flush = [&]() {
+		if (count == 0) return;
+		Program::shade_fragment_block(parameters[block_id], count, attributes.data(),
+		                              derivatives.data(), colors.data(), opacities.data());
+		if constexpr (!(flags & Pipeline_ColorWriteDisableBit)) {
+			for (uint32_t b = 0; b < count; ++b) {
+				framebuffer.colors[indices[b]] = colors[b];
+			}
+		}
+		count = 0;
+	};
+
+	for (uint32_t i = begin; i < end; ++i) {
+		uint32_t id = framebuffer.gbuffer_ids[i];
+		if (id == Framebuffer::GBufferEmpty) continue;
+		assert(id < parameters.size());
+
+		if (id != block_id || count == BlockSize) {
+			flush();
+			block_id = id;
+		}
+
+		float const* g = &framebuffer.gbuffer[i * framebuffer.gbuffer_stride];
+		for (uint32_t a = 0; a < FA; ++a) {
+			attributes[count][a] = g[a];
+		}
+		for (uint32_t d = 0; d < FD; ++d) {
+			derivatives[count][d] = Vec2(g[FA + 2 * d + 0], g[FA + 2 * d + 1]);
+		}
+		indices[count] = i;
+		++count;
+	}
+	flush();
+}
+
 // -------------------------------------------------------------------------
 // clipping functions
 
@@ -1200,6 +1344,32 @@ template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
                          Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Smooth>;
 template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
                          Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Correct>;
+// deferred (G-buffer) triangles:
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Flat | Pipeline_GBufferWriteBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Smooth | Pipeline_GBufferWriteBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Correct | Pipeline_GBufferWriteBit>;
+// transparent triangles (depth-tested against, but not written to, the depth buffer):
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Flat | Pipeline_DepthWriteDisableBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Smooth | Pipeline_DepthWriteDisableBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Correct | Pipeline_DepthWriteDisableBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_OIT_Weighted | Pipeline_Depth_Less | Pipeline_Interp_Flat | Pipeline_DepthWriteDisableBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_OIT_Weighted | Pipeline_Depth_Less | Pipeline_Interp_Smooth | Pipeline_DepthWriteDisableBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_OIT_Weighted | Pipeline_Depth_Less | Pipeline_Interp_Correct | Pipeline_DepthWriteDisableBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_OIT_KBuffer | Pipeline_Depth_Less | Pipeline_Interp_Flat | Pipeline_DepthWriteDisableBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_OIT_KBuffer | Pipeline_Depth_Less | Pipeline_Interp_Smooth | Pipeline_DepthWriteDisableBit>;
+template struct Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+                         Pipeline_Blend_OIT_KBuffer | Pipeline_Depth_Less | Pipeline_Interp_Correct | Pipeline_DepthWriteDisableBit>;
 template struct Pipeline<PrimitiveType::Lines, Programs::Lambertian,
                          Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
 template struct Pipeline<PrimitiveType::Lines, Programs::Lambertian,
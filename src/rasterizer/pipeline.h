@@ -26,9 +26,13 @@ enum PipelineFlags : uint32_t {
 
 	Pipeline_ColorWriteDisableBit = 0x4000, //if 1, color buffer writes are disabled
 
+	Pipeline_GBufferWriteBit = 0x2000, //if 1, fragments passing the depth test are stored in the framebuffer's G-buffer instead of being shaded (see shade_deferred)
+
 	Pipeline_Blend_Replace  = 0x0, //incoming fragment color replaces framebuffer color
 	Pipeline_Blend_Add      = 0x1, //incoming fragment color sums with framebuffer color
 	Pipeline_Blend_Over     = 0x2, //incoming fragment color is 'over blended' using opacity
+	Pipeline_Blend_OIT_Weighted = 0x3, //incoming fragment is accumulated for weighted-blended order-independent transparency
+	Pipeline_Blend_OIT_KBuffer  = 0x4, //incoming fragment is inserted into the framebuffer's per-sample k-buffer
 
 	Pipeline_Depth_Always   = 0x00, //depth test always passes
 	Pipeline_Depth_Never    = 0x10, //depth test never passes (not super useful)
@@ -83,6 +87,21 @@ struct ShadedFragment {
 	float opacity;
 };
 
+//Statistics optionally gathered by Pipeline::run (counts and times accumulate over runs):
+struct PipelineStats {
+	uint64_t vertices = 0; //input vertices
+	uint64_t primitives = 0; //input primitives (lines or triangles)
+	uint64_t clipped_primitives = 0; //primitives left after clipping
+	uint64_t fragments = 0; //fragments produced by rasterization
+	uint64_t passed_fragments = 0; //fragments that passed the depth test (and were shaded or stored)
+
+	//time spent in each stage, in seconds:
+	double shade_vertex_seconds = 0.0;
+	double clip_seconds = 0.0; //(includes assembly and homogeneous divide)
+	double rasterize_seconds = 0.0;
+	double fragment_seconds = 0.0; //(depth test + shade + blend)
+};
+
 //A Pipeline depends on the following configuration:
 template<
 	PrimitiveType primitive_type, //primitive type (how primitives are assembled for rasterization)
@@ -143,6 +162,8 @@ struct Pipeline {
 
 	//(8) transforms fragments via Program::shade_fragment() to produce a color and opacity, stored
 	//	  in a ShadedFragment:
+	//	  (fragments that pass the depth test are shaded in blocks, of at most Textures::Image::BlockSize,
+	//	   through Program::shade_fragment_block, then written in the order they were rasterized)
 	using ShadedFragment = ::ShadedFragment;
 
 	//(9) writes color and/or depth to framebuffer (based on flags)
@@ -151,6 +172,18 @@ struct Pipeline {
 	// 		vertices: list of vertices to rasterize
 	//  	parameters: global parameters for vertex and fragment programs
 	//  	framebuffer (must not be null): framebuffer to write results into
+	//  	stats (may be null): if given, counts and per-stage times are added to it
 	static void run(std::vector<Vertex> const& vertices,
-	                typename Program::Parameters const& parameters, Framebuffer* framebuffer);
+	                typename Program::Parameters const& parameters, Framebuffer* framebuffer,
+	                PipelineStats* stats = nullptr);
+
+	// Deferred shading: when run with Pipeline_GBufferWriteBit, step (8) is postponed; each sample
+	// of the G-buffer holds the attributes and derivatives of its visible fragment along with the
+	// value of framebuffer->gbuffer_id at the time it was written.
+	// "shade_deferred" then shades samples [begin,end) using parameters[gbuffer_id] and writes
+	// (replaces) their colors. Disjoint ranges may be shaded concurrently.
+	// Consecutive samples with the same parameters are shaded in blocks (of at most
+	// Textures::Image::BlockSize) through Program::shade_fragment_block.
+	static void shade_deferred(std::vector<typename Program::Parameters> const& parameters,
+	                           Framebuffer* framebuffer, uint32_t begin, uint32_t end);
 };
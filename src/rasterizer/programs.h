@@ -93,19 +93,10 @@ struct Lambertian {
 		fa[FA_NormalZ] = fa_normal.z;
 	}
 
-	static void shade_fragment(Parameters const& parameters,
-	                           std::array<float, FA> const& fa, // interpolated fragment attributes
-	                           std::array<Vec2, FD> const& fd,  // fragment attribute derivatives
-	                           Spectrum* color_,                // output color (must be non-null)
-	                           float* opacity_                  // output opacity (must be non-null)
+	// mip-map level to sample from, given texture coordinate derivatives:
+	static float texture_lod(Parameters const& parameters,
+	                         std::array<Vec2, FD> const& fd // fragment attribute derivatives
 	) {
-		auto& color = *color_;
-		auto& opacity = *opacity_;
-
-		// make local names for fragment attributes and derivatives:
-		Vec2 fa_texcoord{fa[FA_TexCoordU], fa[FA_TexCoordV]};
-		Vec3 fa_normal{fa[FA_NormalX], fa[FA_NormalY], fa[FA_NormalZ]};
-
 		// make local names for fragment attribute derivatives:
 		Vec2 fdx_texcoord{fd[FA_TexCoordU].x, fd[FA_TexCoordV].x};
 		Vec2 fdy_texcoord{fd[FA_TexCoordU].y, fd[FA_TexCoordV].y};
@@ -126,19 +117,67 @@ struct Lambertian {
 		float lod = 0.0f; //<-- replace this line
 		//-----
 
-		Vec3 normal = fa_normal.unit();
+		return lod;
+	}
 
-		Spectrum light =
+	// light arriving at a surface with (unit) normal 'normal':
+	static Spectrum lighting(Parameters const& parameters, Vec3 normal) {
+		return
 			// sun contribution:
 			parameters.sun_energy * std::max(dot(parameters.sun_direction, normal), 0.0f)
 			// sky contribution:
 			+ (parameters.sky_energy - parameters.ground_energy) *
 				  (0.5f * dot(parameters.sky_direction, normal) + 0.5f) +
 			parameters.ground_energy;
+	}
 
-		color = parameters.image->evaluate(fa_texcoord, lod) * light;
+	static void shade_fragment(Parameters const& parameters,
+	                           std::array<float, FA> const& fa, // interpolated fragment attributes
+	                           std::array<Vec2, FD> const& fd,  // fragment attribute derivatives
+	                           Spectrum* color_,                // output color (must be non-null)
+	                           float* opacity_                  // output opacity (must be non-null)
+	) {
+		auto& color = *color_;
+		auto& opacity = *opacity_;
+
+		// make local names for fragment attributes:
+		Vec2 fa_texcoord{fa[FA_TexCoordU], fa[FA_TexCoordV]};
+		Vec3 fa_normal{fa[FA_NormalX], fa[FA_NormalY], fa[FA_NormalZ]};
+
+		float lod = texture_lod(parameters, fd);
+
+		Vec3 normal = fa_normal.unit();
+
+		color = parameters.image->evaluate(fa_texcoord, lod) * lighting(parameters, normal);
 		opacity = parameters.opacity;
 	}
+
+	// shade 'count' (at most Textures::Image::BlockSize) fragments at once;
+	//  same results as shade_fragment, but texture lookups are batched:
+	static void shade_fragment_block(Parameters const& parameters, uint32_t count,
+	                                 std::array<float, FA> const* fa, // interpolated fragment attributes
+	                                 std::array<Vec2, FD> const* fd,  // fragment attribute derivatives
+	                                 Spectrum* color,                 // output colors (must be non-null)
+	                                 float* opacity                   // output opacities (must be non-null)
+	) {
+		assert(count <= Textures::Image::BlockSize);
+
+		std::array<Vec2, Textures::Image::BlockSize> texcoord;
+		std::array<float, Textures::Image::BlockSize> lod{};
+		std::array<Spectrum, Textures::Image::BlockSize> texel;
+		for (uint32_t i = 0; i < count; ++i) {
+			texcoord[i] = Vec2{fa[i][FA_TexCoordU], fa[i][FA_TexCoordV]};
+			lod[i] = texture_lod(parameters, fd[i]);
+		}
+
+		parameters.image->evaluate_block(count, texcoord.data(), lod.data(), texel.data());
+
+		for (uint32_t i = 0; i < count; ++i) {
+			Vec3 normal = Vec3{fa[i][FA_NormalX], fa[i][FA_NormalY], fa[i][FA_NormalZ]}.unit();
+			color[i] = texel[i] * lighting(parameters, normal);
+			opacity[i] = parameters.opacity;
+		}
+	}
 };
 
 // The 'Copy' shader copies everything from vertex attributes:
@@ -204,6 +243,17 @@ struct Copy {
 		color = Spectrum(fa[FA_ColorR], fa[FA_ColorG], fa[FA_ColorB]);
 		opacity = fa[FA_ColorA];
 	}
+
+	static void shade_fragment_block(Parameters const& parameters, uint32_t count,
+	                                 std::array<float, FA> const* fa, // interpolated fragment attributes
+	                                 std::array<Vec2, FD> const* fd,  // fragment attribute derivatives
+	                                 Spectrum* color,                 // output colors (must be non-null)
+	                                 float* opacity                   // output opacities (must be non-null)
+	) {
+		for (uint32_t i = 0; i < count; ++i) {
+			shade_fragment(parameters, fa[i], fd[i], &color[i], &opacity[i]);
+		}
+	}
 };
 
 } // namespace Programs
@@ -0,0 +1,126 @@
+#pragma once
+// clang-format off
+/*
+ * `RasterPipelines` names the Pipeline configurations used to draw scene instances
+ * (see RasterJob in rasterizer.cpp); shared with the throughput benchmark (benchmark.h).
+ *
+ */
+
+#include "pipeline.h"
+#include "programs.h"
+
+struct RasterPipelines {
+	// All 3 * 3 * 3 triangle blend + depth + interpolation combinations
+	using Lambertian_Triangles_Replace_Always_Flat_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
+	using Lambertian_Triangles_Replace_Always_Smooth_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Smooth>;
+	using Lambertian_Triangles_Replace_Always_Correct_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Correct>;
+	using Lambertian_Triangles_Replace_Never_Flat_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
+	using Lambertian_Triangles_Replace_Never_Smooth_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Never | Pipeline_Interp_Smooth>;
+	using Lambertian_Triangles_Replace_Never_Correct_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Never | Pipeline_Interp_Correct>;
+	using Lambertian_Triangles_Replace_Less_Flat_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
+	using Lambertian_Triangles_Replace_Less_Smooth_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Smooth>;
+	using Lambertian_Triangles_Replace_Less_Correct_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Correct>;
+	using Lambertian_Triangles_Add_Always_Flat_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
+	using Lambertian_Triangles_Add_Always_Smooth_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Always | Pipeline_Interp_Smooth>;
+	using Lambertian_Triangles_Add_Always_Correct_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Always | Pipeline_Interp_Correct>;
+	using Lambertian_Triangles_Add_Never_Flat_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
+	using Lambertian_Triangles_Add_Never_Smooth_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Never | Pipeline_Interp_Smooth>;
+	using Lambertian_Triangles_Add_Never_Correct_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Never | Pipeline_Interp_Correct>;
+	using Lambertian_Triangles_Add_Less_Flat_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
+	using Lambertian_Triangles_Add_Less_Smooth_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Less | Pipeline_Interp_Smooth>;
+	using Lambertian_Triangles_Add_Less_Correct_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Less | Pipeline_Interp_Correct>;
+	using Lambertian_Triangles_Over_Always_Flat_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
+	using Lambertian_Triangles_Over_Always_Smooth_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Always | Pipeline_Interp_Smooth>;
+	using Lambertian_Triangles_Over_Always_Correct_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Always | Pipeline_Interp_Correct>;
+	using Lambertian_Triangles_Over_Never_Flat_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
+	using Lambertian_Triangles_Over_Never_Smooth_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Never | Pipeline_Interp_Smooth>;
+	using Lambertian_Triangles_Over_Never_Correct_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Never | Pipeline_Interp_Correct>;
+	using Lambertian_Triangles_Over_Less_Flat_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
+	using Lambertian_Triangles_Over_Less_Smooth_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Smooth>;
+	using Lambertian_Triangles_Over_Less_Correct_Pipeline =
+		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Correct>;
+	// All 3 * 3 wireframe blend + depth combinations
+	using Lambertian_Lines_Replace_Always_Pipeline =
+		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
+	using Lambertian_Lines_Replace_Never_Pipeline =
+		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
+	using Lambertian_Lines_Replace_Less_Pipeline =
+		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
+	             Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
+	using Lambertian_Lines_Add_Always_Pipeline =
+		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
+	using Lambertian_Lines_Add_Never_Pipeline =
+		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
+	using Lambertian_Lines_Add_Less_Pipeline =
+		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
+	             Pipeline_Blend_Add | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
+	using Lambertian_Lines_Over_Always_Pipeline =
+		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
+	using Lambertian_Lines_Over_Never_Pipeline =
+		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
+	using Lambertian_Lines_Over_Less_Pipeline =
+		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
+	             Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
+	// Lambertian Vertex used for mesh manipulations
+	using Lambertian_Replace_Less_Correct_Vertex =
+		Lambertian_Triangles_Replace_Less_Correct_Pipeline::Vertex;
+};
@@ -2,154 +2,64 @@
 #include "rasterizer.h"
 #include "../geometry/util.h"
 #include "../scene/scene.h"
+#include "../util/thread_pool.h"
 #include "../util/timer.h"
 #include "framebuffer.h"
 #include "pipeline.h"
 #include "programs.h"
+#include "raster_pipelines.h"
 #include "sample_pattern.h"
 
-struct RasterJob {
+#include <unordered_map>
+
+struct RasterJob : RasterPipelines {
 	// used to tell the job to quit early:
 	bool quit = false;
 
 	// scene data:
 	using Image = Textures::Image;
-	std::vector<Image> images;
+	// converted textures, by source texture (kept between renders, see update()):
+	struct CachedImage {
+		Image image;
+		bool used = false; // referenced by the scene during the latest update()?
+	};
+	std::unordered_map<::Texture const*, CachedImage> images;
+	Image error_image; // bright magenta
 	struct Material {
 		Image* image; // must be non-null!
 		enum class Type {
 			Lambertian, // rendered with Programs::Lambertian and Blend::Replace
 			Emissive,   // rendered with Programs::Unshaded and Blend::Additive
-			Transparent // rendered with Programs::Lambertian, sorted back-to-front, with and
-			            // Blend::Over
+			Transparent // rendered with Programs::Lambertian after all other instances, composited
+			            // as per Rasterizer::Settings::transparency
 		} type;
+		float opacity = 1.0f; // (only used by Transparent materials)
 	};
 	std::vector<Material> materials;
 
-	// All 3 * 3 * 3 triangle blend + depth + interpolation combinations
-	using Lambertian_Triangles_Replace_Always_Flat_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
-	using Lambertian_Triangles_Replace_Always_Smooth_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Smooth>;
-	using Lambertian_Triangles_Replace_Always_Correct_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Correct>;
-	using Lambertian_Triangles_Replace_Never_Flat_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
-	using Lambertian_Triangles_Replace_Never_Smooth_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Never | Pipeline_Interp_Smooth>;
-	using Lambertian_Triangles_Replace_Never_Correct_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Never | Pipeline_Interp_Correct>;
-	using Lambertian_Triangles_Replace_Less_Flat_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
-	using Lambertian_Triangles_Replace_Less_Smooth_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Smooth>;
-	using Lambertian_Triangles_Replace_Less_Correct_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Correct>;
-	using Lambertian_Triangles_Add_Always_Flat_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
-	using Lambertian_Triangles_Add_Always_Smooth_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Always | Pipeline_Interp_Smooth>;
-	using Lambertian_Triangles_Add_Always_Correct_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Always | Pipeline_Interp_Correct>;
-	using Lambertian_Triangles_Add_Never_Flat_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
-	using Lambertian_Triangles_Add_Never_Smooth_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Never | Pipeline_Interp_Smooth>;
-	using Lambertian_Triangles_Add_Never_Correct_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Never | Pipeline_Interp_Correct>;
-	using Lambertian_Triangles_Add_Less_Flat_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
-	using Lambertian_Triangles_Add_Less_Smooth_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Less | Pipeline_Interp_Smooth>;
-	using Lambertian_Triangles_Add_Less_Correct_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Less | Pipeline_Interp_Correct>;
-	using Lambertian_Triangles_Over_Always_Flat_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
-	using Lambertian_Triangles_Over_Always_Smooth_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Always | Pipeline_Interp_Smooth>;
-	using Lambertian_Triangles_Over_Always_Correct_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Always | Pipeline_Interp_Correct>;
-	using Lambertian_Triangles_Over_Never_Flat_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
-	using Lambertian_Triangles_Over_Never_Smooth_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Never | Pipeline_Interp_Smooth>;
-	using Lambertian_Triangles_Over_Never_Correct_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Never | Pipeline_Interp_Correct>;
-	using Lambertian_Triangles_Over_Less_Flat_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
-	using Lambertian_Triangles_Over_Less_Smooth_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Smooth>;
-	using Lambertian_Triangles_Over_Less_Correct_Pipeline =
-		Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Correct>;
-	// All 3 * 3 wireframe blend + depth combinations
-	using Lambertian_Lines_Replace_Always_Pipeline =
-		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
-	using Lambertian_Lines_Replace_Never_Pipeline =
-		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
-	using Lambertian_Lines_Replace_Less_Pipeline =
-		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
-	             Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
-	using Lambertian_Lines_Add_Always_Pipeline =
-		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
-	using Lambertian_Lines_Add_Never_Pipeline =
-		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
-	using Lambertian_Lines_Add_Less_Pipeline =
-		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
-	             Pipeline_Blend_Add | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
-	using Lambertian_Lines_Over_Always_Pipeline =
-		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Always | Pipeline_Interp_Flat>;
-	using Lambertian_Lines_Over_Never_Pipeline =
-		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Never | Pipeline_Interp_Flat>;
-	using Lambertian_Lines_Over_Less_Pipeline =
-		Pipeline<PrimitiveType::Lines, Programs::Lambertian,
-	             Pipeline_Blend_Over | Pipeline_Depth_Less | Pipeline_Interp_Flat>;
-	// Lambertian Vertex used for mesh manipulations
-	using Lambertian_Replace_Less_Correct_Vertex =
-		Lambertian_Triangles_Replace_Less_Correct_Pipeline::Vertex;
+	// transmissive materials have no single opacity; the rasterizer draws them half-covering:
+	static constexpr float TransparentOpacity = 0.5f;
+
 
 	struct Mesh {
 		Halfedge_Mesh source;
 		std::vector<Lambertian_Replace_Less_Correct_Vertex> lamb_triangles;
 		std::vector<Lambertian_Replace_Less_Correct_Vertex> lamb_edges;
+		uint64_t fingerprint = 0; // of the data 'source' was copied from, for plain meshes (see fingerprint())
+		bool used = false; // referenced by the scene during the latest update()?
+		// for skinned meshes, what 'source' was posed from (see Skinned_Mesh::table()):
+		std::shared_ptr<Skinning_Table const> skinning_table;
+		uint32_t subdivision_levels = 0;
+		std::vector<Mat4> bind_pose, current_pose;
 	};
-	std::vector<Mesh> meshes;
+	// converted meshes, by source mesh (kept between renders, see update()):
+	std::unordered_map<Halfedge_Mesh const*, Mesh> meshes;
+	std::unordered_map<Skinned_Mesh const*, Mesh> skinned_meshes;
+	Mesh sphere_mesh; // unit sphere used for Shapes::Sphere (built when first needed)
 	struct Instance {
 		std::string name; // for DEBUG output
 		Mat4 local_to_world;
-		Mesh* mesh; // pointer into 'meshes' vector, above
+		Mesh* mesh; // pointer into one of the mesh caches, above
 		Material* material; // pointer into 'materials' vector, above
 		DrawStyle draw_style; // draw style (Lines / Flat Triangles / Smooth Triangles / Correct Triangles)
 		BlendStyle blend_style; // blend style (Blend Replace / Blend Add / Blend Over)
@@ -168,6 +78,15 @@ struct RasterJob {
 	// camera info:
 	Mat4 world_to_clip; // camera.proj() * camera.world_to_local()
 
+	// rendering options:
+	Rasterizer::Settings settings;
+
+	// deferred shading state: parameters for each instance in the G-buffer (indexed by
+	// Framebuffer::gbuffer_id), and threads used by the screen-space shading pass (if
+	// settings.thread_pool isn't supplied):
+	std::vector<Programs::Lambertian::Parameters> deferred_parameters;
+	std::unique_ptr<Thread_Pool> thread_pool;
+
 	// reporting function:
 	std::function<void(Rasterizer::Render_Report)> report_fn;
 
@@ -176,42 +95,137 @@ struct RasterJob {
 
 	// copy data into this raster job:
 	RasterJob(Scene const& scene, ::Instance::Camera const& camera,
-	          std::function<void(Rasterizer::Render_Report)>&& report_fn_)
-		: report_fn(report_fn_),
+	          std::function<void(Rasterizer::Render_Report)>&& report_fn_,
+	          Rasterizer::Settings const& settings_)
+		: settings(settings_), report_fn(report_fn_),
+		  framebuffer(camera.camera.lock()->film.width, camera.camera.lock()->film.height,
+	                  *SamplePattern::from_id(camera.camera.lock()->film.sample_pattern)) {
+		update(scene, camera);
+	}
+
+	// copy data into this raster job, taking converted textures and meshes from 'previous'
+	// (used when previous.framebuffer can't be re-used because the film changed):
+	RasterJob(RasterJob&& previous, Scene const& scene, ::Instance::Camera const& camera,
+	          std::function<void(Rasterizer::Render_Report)>&& report_fn_,
+	          Rasterizer::Settings const& settings_)
+		: settings(settings_), report_fn(report_fn_),
 		  framebuffer(camera.camera.lock()->film.width, camera.camera.lock()->film.height,
 	                  *SamplePattern::from_id(camera.camera.lock()->film.sample_pattern)) {
+		take_caches(std::move(previous));
+		update(scene, camera);
+	}
 
-		// copy scene data:
+	// copy data into this raster job, with a (width) x (height) framebuffer in place of the film
+	// (used to render the film one tile at a time, see Rasterizer::render_bands), taking converted
+	// textures and meshes from 'previous' if it isn't null:
+	RasterJob(RasterJob* previous, Scene const& scene, ::Instance::Camera const& camera,
+	          uint32_t width, uint32_t height,
+	          std::function<void(Rasterizer::Render_Report)>&& report_fn_,
+	          Rasterizer::Settings const& settings_)
+		: settings(settings_), report_fn(report_fn_),
+		  framebuffer(width, height, *SamplePattern::from_id(camera.camera.lock()->film.sample_pattern)) {
+		if (previous) take_caches(std::move(*previous));
+		update(scene, camera);
+	}
+
+	// move converted textures and meshes out of 'previous':
+	void take_caches(RasterJob&& previous) {
+		// (unordered_map nodes don't move, so pointers into these stay valid:)
+		images = std::move(previous.images);
+		meshes = std::move(previous.meshes);
+		skinned_meshes = std::move(previous.skinned_meshes);
+		sphere_mesh = std::move(previous.sphere_mesh);
+	}
+
+	// can this job's framebuffer be re-used as a (width) x (height) framebuffer with 'pattern'?
+	bool matches_framebuffer(uint32_t width, uint32_t height, SamplePattern const* pattern) const {
+		return framebuffer.width == width && framebuffer.height == height &&
+		       &framebuffer.sample_pattern == pattern;
+	}
+
+	// can this job's framebuffer be re-used to render through 'camera'?
+	bool matches_film(::Instance::Camera const& camera) const {
+		Camera const& film_camera = *camera.camera.lock();
+		return matches_framebuffer(film_camera.film.width, film_camera.film.height,
+		                           SamplePattern::from_id(film_camera.film.sample_pattern));
+	}
+
+	// get a finished job ready to run again (keeping framebuffer allocations):
+	void reset(std::function<void(Rasterizer::Render_Report)>&& report_fn_,
+	           Rasterizer::Settings const& settings_) {
+		quit = false;
+		report_fn = std::move(report_fn_);
+		settings = settings_;
+		framebuffer.clear();
+	}
+
+	// fingerprints of the data make_lamb_triangles reads, used to notice when a cached mesh is
+	// out of date without keeping a second copy of it around to compare against:
+	static uint64_t fingerprint(Halfedge_Mesh const& mesh) {
+		uint64_t hash = 0xcbf29ce484222325ull; // FNV-1a
+		auto add = [&hash](void const* data, size_t size) {
+			for (size_t i = 0; i < size; ++i) {
+				hash = (hash ^ static_cast<uint8_t const*>(data)[i]) * 0x100000001b3ull;
+			}
+		};
+		for (auto const& f : mesh.faces) {
+			if (f.boundary) continue;
+			Halfedge_Mesh::HalfedgeCRef h = f.halfedge;
+			do {
+				add(&h->vertex->position, sizeof(Vec3));
+				add(&h->corner_normal, sizeof(Vec3));
+				add(&h->corner_uv, sizeof(Vec2));
+				h = h->next;
+			} while (h != f.halfedge);
+			add(&f.id, sizeof(f.id)); // (also marks the end of the face)
+		}
+		return hash;
+	}
+	// bring copied scene data up to date with 'scene' and 'camera':
+	//  converted textures and meshes are only re-copied if their source changed (and dropped if
+	//  no longer used); instances are refreshed in place; materials, lighting, and camera info are
+	//  rebuilt.
+	void update(Scene const& scene, ::Instance::Camera const& camera) {
+
+		// everything cached is unused until found in the scene again:
+		for (auto& [key, image] : images) image.used = false;
+		for (auto& [key, mesh] : meshes) mesh.used = false;
+		for (auto& [key, mesh] : skinned_meshes) mesh.used = false;
 
 		// Scene Textures get converted to images:
-		images.reserve(1 + scene.textures.size());
-		images.emplace_back(Textures::Image::Sampler::nearest,
-		                    HDR_Image(1, 1, {Spectrum{1.0f, 0.0f, 1.0f}}));
-		Image* const error_image = &images.back();
-
-		// Helper to add a texture from the scene to the local data;
-		// uses texture_to_local to keep track of duplicates:
-		std::unordered_map<::Texture const*, Image*> texture_to_local;
+		Image* const error_image = &this->error_image;
+		if (error_image->image.w == 0) {
+			*error_image = Image(Textures::Image::Sampler::nearest,
+			                     HDR_Image(1, 1, {Spectrum{1.0f, 0.0f, 1.0f}}));
+		}
+
+		// Helper to add a texture from the scene to the local data, re-using the cached copy if
+		// it still matches:
 		auto add_texture = [&](::Texture const& to_add) -> Image* {
-			Image*& local = texture_to_local.emplace(&to_add, nullptr).first->second;
-			if (!local) {
-				if (Textures::Image const* image = std::get_if<Textures::Image>(&to_add.texture)) {
-					images.emplace_back(image->copy());
-					local = &images.back();
-				} else if (Textures::Constant const* constant =
-				               std::get_if<Textures::Constant>(&to_add.texture)) {
-					images.emplace_back(Textures::Image::Sampler::nearest,
-					                    HDR_Image(1, 1, {constant->color * constant->scale}));
-					local = &images.back();
-				} else {
-					warn("Encountered unknown Texture variant, replacing with error image.");
-					local = error_image;
+			auto found = images.find(&to_add);
+			if (Textures::Image const* image = std::get_if<Textures::Image>(&to_add.texture)) {
+				if (found == images.end() || found->second.image.sampler != image->sampler ||
+				    found->second.image != *image) {
+					found = images.insert_or_assign(&to_add, CachedImage{image->copy()}).first;
 				}
+			} else if (Textures::Constant const* constant =
+			               std::get_if<Textures::Constant>(&to_add.texture)) {
+				Spectrum color = constant->color * constant->scale;
+				if (found == images.end() || found->second.image.image.w != 1 ||
+				    found->second.image.image.h != 1 || found->second.image.image.at(0, 0) != color) {
+					found = images.insert_or_assign(&to_add, CachedImage{Image(Textures::Image::Sampler::nearest,
+					                                                           HDR_Image(1, 1, {color}))}).first;
+				}
+			} else {
+				warn("Encountered unknown Texture variant, replacing with error image.");
+				return error_image;
 			}
-			return local;
+			found->second.used = true;
+			return &found->second.image;
 		};
 
 		// Scene Materials get converted to Material structs:
+		materials.clear();
 		materials.reserve(1 + scene.materials.size());
 		materials.emplace_back();
 		materials.back().image = error_image;
@@ -238,11 +252,13 @@ struct RasterJob {
 					materials.emplace_back();
 					materials.back().image = add_texture(*glass->transmittance.lock());
 					materials.back().type = Material::Type::Transparent;
+					materials.back().opacity = TransparentOpacity;
 					local = &materials.back();
 				} else if (Materials::Refract const* refract = std::get_if<Materials::Refract>(&to_add.material)) {
 					materials.emplace_back();
 					materials.back().image = add_texture(*refract->transmittance.lock());
 					materials.back().type = Material::Type::Transparent;
+					materials.back().opacity = TransparentOpacity;
 					local = &materials.back();
 				} else {
 					warn("Encountered unknown Material variant, replacing with bright magenta.");
@@ -252,63 +268,76 @@ struct RasterJob {
 			return local;
 		};
 
-		// Scene Meshes, Skinned_Meshes, and Shapes get converted to Mesh structs:
-		meshes.reserve(1 + scene.meshes.size() + scene.skinned_meshes.size());
-		std::unordered_map<Halfedge_Mesh const*, Mesh*> mesh_to_local;
+		// Scene Meshes, Skinned_Meshes, and Shapes get converted to Mesh structs; cached copies are
+		// re-used if their fingerprints still match:
 		auto add_mesh = [&](Halfedge_Mesh const& to_add) -> Mesh* {
-			Mesh*& local = mesh_to_local.emplace(&to_add, nullptr).first->second;
-			if (!local) {
-				meshes.emplace_back();
-				meshes.back().source = to_add.copy();
-				local = &meshes.back();
+			auto [found, inserted] = meshes.try_emplace(&to_add);
+			Mesh& local = found->second;
+			if (!local.used) {
+				uint64_t hash = fingerprint(to_add);
+				if (inserted || local.fingerprint != hash) {
+					local = Mesh{};
+					local.source = to_add.copy();
+					local.fingerprint = hash;
+				}
+				local.used = true;
 			}
-			return local;
+			return &local;
 		};
-		std::unordered_map<Skinned_Mesh const*, Mesh*> skinned_mesh_to_local;
+		// (skinned meshes are only re-posed if their table, subdivision levels, or poses changed)
 		auto add_skinned_mesh = [&](Skinned_Mesh const& to_add) -> Mesh* {
-			Mesh*& local = skinned_mesh_to_local.emplace(&to_add, nullptr).first->second;
-			if (!local) {
-				meshes.emplace_back();
-				meshes.back().source = Halfedge_Mesh::from_indexed_mesh(to_add.posed_mesh());
-				local = &meshes.back();
+			auto [found, inserted] = skinned_meshes.try_emplace(&to_add);
+			Mesh& local = found->second;
+			if (!local.used) {
+				std::shared_ptr<Skinning_Table const> table = to_add.table();
+				std::vector<Mat4> bind_pose = to_add.skeleton.bind_pose();
+				std::vector<Mat4> current_pose = to_add.skeleton.current_pose();
+				if (inserted || local.skinning_table != table ||
+				    local.subdivision_levels != to_add.subdivision_levels ||
+				    local.bind_pose != bind_pose || local.current_pose != current_pose) {
+					local = Mesh{};
+					local.source = Halfedge_Mesh::from_indexed_mesh(to_add.posed_mesh());
+					local.skinning_table = std::move(table);
+					local.subdivision_levels = to_add.subdivision_levels;
+					local.bind_pose = std::move(bind_pose);
+					local.current_pose = std::move(current_pose);
+				}
+				local.used = true;
 			}
-			return local;
+			return &local;
 		};
 
-		Mesh* sphere_mesh = nullptr; // will get set if shapes need it
 		auto add_sphere = [&]() -> Mesh* {
-			if (!sphere_mesh) {
-				meshes.emplace_back();
-				meshes.back().source = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 2));
-				sphere_mesh = &meshes.back();
+			if (sphere_mesh.source.faces.empty()) {
+				sphere_mesh.source = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 2));
 			}
-			return sphere_mesh;
+			return &sphere_mesh;
 		};
 
 		// Scene instances get converted to Instances:
-		instances.reserve(scene.instances.meshes.size() + scene.instances.skinned_meshes.size() +
-		                  scene.instances.shapes.size());
+		//  (entries are overwritten in place, so names only re-allocate when they change)
+		size_t n_instances = 0;
+		auto add_instance = [&](std::string const& name, auto const& to_add, Mat4 const& local_to_world,
+		                        Mesh* mesh) {
+			if (n_instances == instances.size()) instances.emplace_back();
+			Instance& instance = instances[n_instances++];
+			if (instance.name != name) instance.name = name;
+			instance.local_to_world = local_to_world;
+			instance.mesh = mesh;
+			instance.material = add_material(*to_add.material.lock());
+			instance.draw_style = to_add.settings.draw_style;
+			instance.blend_style = to_add.settings.blend_style;
+			instance.depth_style = to_add.settings.depth_style;
+		};
 		for (auto const& [name, to_add] : scene.instances.meshes) {
 			if (!to_add->settings.visible) continue;
-			instances.emplace_back();
-			instances.back().name = name;
-			instances.back().local_to_world = to_add->transform.lock()->local_to_world();
-			instances.back().mesh = add_mesh(*to_add->mesh.lock());
-			instances.back().material = add_material(*to_add->material.lock());
-			instances.back().draw_style = to_add->settings.draw_style;
-			instances.back().blend_style = to_add->settings.blend_style;
-			instances.back().depth_style = to_add->settings.depth_style;
+			add_instance(name, *to_add, to_add->transform.lock()->local_to_world(),
+			             add_mesh(*to_add->mesh.lock()));
 		}
 		for (auto const& [name, to_add] : scene.instances.skinned_meshes) {
 			if (!to_add->settings.visible) continue;
-			instances.emplace_back();
-			instances.back().name = name;
-			instances.back().local_to_world = to_add->transform.lock()->local_to_world();
-			instances.back().mesh = add_skinned_mesh(*to_add->mesh.lock());
-			instances.back().material = add_material(*to_add->material.lock());
-			instances.back().draw_style = to_add->settings.draw_style;
-			instances.back().blend_style = to_add->settings.blend_style;
-			instances.back().depth_style = to_add->settings.depth_style;
+			add_instance(name, *to_add, to_add->transform.lock()->local_to_world(),
+			             add_skinned_mesh(*to_add->mesh.lock()));
 		}
 		for (auto const& [name, to_add] : scene.instances.shapes) {
 			if (!to_add->settings.visible) continue;
@@ -316,22 +345,28 @@ struct RasterJob {
 			        std::get_if<Shapes::Sphere>(&to_add->shape.lock()->shape)) {
 				// use unit sphere mesh and account for radius by scaling:
 				float const r = sphere->radius;
-				instances.emplace_back();
-				instances.back().name = name;
-				instances.back().local_to_world =
-					to_add->transform.lock()->local_to_world() * Mat4::scale(Vec3{r, r, r});
-				instances.back().mesh = add_sphere();
-				instances.back().material = add_material(*to_add->material.lock());
-				instances.back().draw_style = to_add->settings.draw_style;
-				instances.back().blend_style = to_add->settings.blend_style;
-				instances.back().depth_style = to_add->settings.depth_style;
+				add_instance(name, *to_add,
+				             to_add->transform.lock()->local_to_world() * Mat4::scale(Vec3{r, r, r}),
+				             add_sphere());
 			} else {
 				warn("Shape %s is an unsupported variant.", name.c_str());
 			}
 		}
+		instances.erase(instances.begin() + n_instances, instances.end());
 
 		// TODO: particles?
 
+		// drop cached data the scene no longer uses:
+		auto sweep = [](auto& cache) {
+			for (auto it = cache.begin(); it != cache.end();) {
+				if (it->second.used) ++it;
+				else it = cache.erase(it);
+			}
+		};
+		sweep(images);
+		sweep(meshes);
+		sweep(skinned_meshes);
+
 		// set lighting to something default-ish:
 
 		// "sun + sky" style:
@@ -425,9 +460,43 @@ struct RasterJob {
 		uint32_t done = 0;
 		uint32_t count = static_cast<uint32_t>(instances.size());
 
+		// transparent instances are drawn after everything else (and after deferred shading):
+		std::vector<Instance const*> transparent;
+
 		for (auto const& instance : instances) {
 			if (quit) break;
-			if (instance.material->type == Material::Type::Lambertian) {
+			if (instance.material->type == Material::Type::Transparent &&
+			    instance.draw_style != DrawStyle::Wireframe) {
+				transparent.emplace_back(&instance);
+				continue;
+			}
+			// opaque, depth-tested triangles can be shaded after all of them are rasterized, since
+			// only the nearest fragment survives regardless of drawing order:
+			if (settings.deferred && instance.material->type == Material::Type::Lambertian &&
+			    instance.draw_style != DrawStyle::Wireframe &&
+			    instance.blend_style == BlendStyle::Replace &&
+			    instance.depth_style == DepthStyle::Less) {
+				make_lamb_triangles(instance.mesh);
+
+				parameters.local_to_clip = world_to_clip * instance.local_to_world;
+				parameters.normal_to_world = normal_to_world(instance.local_to_world);
+				parameters.image = instance.material->image;
+
+				if (deferred_parameters.empty()) {
+					framebuffer.clear_gbuffer(Programs::Lambertian::FA + 2 * Programs::Lambertian::FD);
+				}
+				framebuffer.gbuffer_id = static_cast<uint32_t>(deferred_parameters.size());
+				deferred_parameters.emplace_back(parameters);
+
+				draw_deferred(instance, parameters);
+				done += 1;
+				continue;
+			}
+			// ...everything else depends on drawing order, so shade pending samples first:
+			shade_deferred();
+
+			if (instance.material->type == Material::Type::Lambertian ||
+			    instance.material->type == Material::Type::Transparent) {
 				parameters.local_to_clip = world_to_clip * instance.local_to_world;
 				parameters.normal_to_world = normal_to_world(instance.local_to_world);
 
@@ -649,17 +718,158 @@ struct RasterJob {
 				// TODO: other material types!
 			}
 			done += 1;
-			report_fn(std::make_pair(done / float(count), framebuffer.resolve_colors()));
+			if (report_fn) {
+				report_fn(std::make_pair(done / float(count), framebuffer.resolve_colors()));
+			}
+		}
+
+		shade_deferred();
+
+		if (!transparent.empty() && !quit) {
+			if (settings.transparency == Rasterizer::Transparency::sorted) {
+				// sort back-to-front by the clip-space w (i.e., view depth) of each instance's origin:
+				std::vector<std::pair<float, Instance const*>> sorted;
+				sorted.reserve(transparent.size());
+				for (Instance const* instance : transparent) {
+					float w = (world_to_clip * instance->local_to_world * Vec4(0.0f, 0.0f, 0.0f, 1.0f)).w;
+					sorted.emplace_back(w, instance);
+				}
+				std::stable_sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) {
+					return a.first > b.first;
+				});
+				for (uint32_t i = 0; i < sorted.size(); ++i) transparent[i] = sorted[i].second;
+			} else {
+				// order-independent modes composite everything at the end, so no sort is needed:
+				framebuffer.clear_oit(settings.transparency == Rasterizer::Transparency::kbuffer);
+			}
+
+			for (Instance const* instance : transparent) {
+				if (quit) break;
+				make_lamb_triangles(instance->mesh);
+
+				parameters.local_to_clip = world_to_clip * instance->local_to_world;
+				parameters.normal_to_world = normal_to_world(instance->local_to_world);
+				parameters.image = instance->material->image;
+				parameters.opacity = instance->material->opacity;
+
+				if (settings.transparency == Rasterizer::Transparency::sorted) {
+					draw_transparent<Pipeline_Blend_Over>(*instance, parameters);
+				} else if (settings.transparency == Rasterizer::Transparency::weighted) {
+					draw_transparent<Pipeline_Blend_OIT_Weighted>(*instance, parameters);
+				} else if (settings.transparency == Rasterizer::Transparency::kbuffer) {
+					draw_transparent<Pipeline_Blend_OIT_KBuffer>(*instance, parameters);
+				}
+				parameters.opacity = 1.0f;
+
+				done += 1;
+				if (report_fn && settings.transparency == Rasterizer::Transparency::sorted) {
+					report_fn(std::make_pair(done / float(count), framebuffer.resolve_colors()));
+				}
+			}
+
+			framebuffer.resolve_oit();
+		}
+
+		if (report_fn) report_fn(std::make_pair(1.0f, framebuffer.resolve_colors()));
+	}
+
+	// rasterize an instance's (already converted) triangles into the G-buffer:
+	void draw_deferred(Instance const& instance, Programs::Lambertian::Parameters const& parameters) {
+		constexpr uint32_t flags = Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_GBufferWriteBit;
+		std::vector<Lambertian_Replace_Less_Correct_Vertex> const& triangles = instance.mesh->lamb_triangles;
+		if (instance.draw_style == DrawStyle::Flat) {
+			Pipeline<PrimitiveType::Triangles, Programs::Lambertian, flags | Pipeline_Interp_Flat>::run(
+				triangles, parameters, &framebuffer);
+		} else if (instance.draw_style == DrawStyle::Smooth) {
+			Pipeline<PrimitiveType::Triangles, Programs::Lambertian, flags | Pipeline_Interp_Smooth>::run(
+				triangles, parameters, &framebuffer);
+		} else {
+			Pipeline<PrimitiveType::Triangles, Programs::Lambertian, flags | Pipeline_Interp_Correct>::run(
+				triangles, parameters, &framebuffer);
+		}
+	}
+
+	// shade all samples in the G-buffer (in parallel bands), then clear it:
+	void shade_deferred() {
+		if (deferred_parameters.empty()) return;
+
+		Thread_Pool* pool = settings.thread_pool;
+		if (!pool) {
+			if (!thread_pool) {
+				thread_pool = std::make_unique<Thread_Pool>(std::max(1u, std::thread::hardware_concurrency()));
+			}
+			pool = thread_pool.get();
+		}
+
+		// (shading doesn't depend on the interpolation mode, so any G-buffer pipeline will do:)
+		using Deferred = Pipeline<PrimitiveType::Triangles, Programs::Lambertian,
+		                          Pipeline_Blend_Replace | Pipeline_Depth_Less | Pipeline_Interp_Correct | Pipeline_GBufferWriteBit>;
+
+		uint32_t samples = static_cast<uint32_t>(framebuffer.gbuffer_ids.size());
+		uint32_t band = std::max(1024u, samples / (4 * std::max(1u, std::thread::hardware_concurrency())));
+
+		std::vector<std::future<void>> futures;
+		for (uint32_t begin = 0; begin < samples; begin += band) {
+			uint32_t end = std::min(samples, begin + band);
+			futures.emplace_back(pool->enqueue([this, begin, end]() {
+				Deferred::shade_deferred(deferred_parameters, &framebuffer, begin, end);
+			}));
+		}
+		for (auto& f : futures) {
+			f.get();
+		}
+
+		deferred_parameters.clear();
+		framebuffer.gbuffer_ids.assign(framebuffer.gbuffer_ids.size(), Framebuffer::GBufferEmpty);
+		framebuffer.gbuffer_id = 0;
+	}
+
+	// draw an instance's (already converted) triangles with a transparent blend mode, testing
+	// against but not writing depth:
+	template<uint32_t blend>
+	void draw_transparent(Instance const& instance, Programs::Lambertian::Parameters const& parameters) {
+		constexpr uint32_t flags = blend | Pipeline_Depth_Less | Pipeline_DepthWriteDisableBit;
+		std::vector<Lambertian_Replace_Less_Correct_Vertex> const& triangles = instance.mesh->lamb_triangles;
+		if (instance.draw_style == DrawStyle::Flat) {
+			Pipeline<PrimitiveType::Triangles, Programs::Lambertian, flags | Pipeline_Interp_Flat>::run(
+				triangles, parameters, &framebuffer);
+		} else if (instance.draw_style == DrawStyle::Smooth) {
+			Pipeline<PrimitiveType::Triangles, Programs::Lambertian, flags | Pipeline_Interp_Smooth>::run(
+				triangles, parameters, &framebuffer);
+		} else {
+			Pipeline<PrimitiveType::Triangles, Programs::Lambertian, flags | Pipeline_Interp_Correct>::run(
+				triangles, parameters, &framebuffer);
 		}
-		report_fn(std::make_pair(1.0f, framebuffer.resolve_colors()));
 	}
 };
 
+const char* Rasterizer::Transparency_Names[] = {"Sorted", "Weighted OIT", "K-Buffer OIT"};
+
 Rasterizer::Rasterizer(Scene const& scene, Instance::Camera const& camera,
-                       std::function<void(Render_Report)>&& report_fn) {
+                       std::function<void(Render_Report)>&& report_fn, Settings const& settings)
+	: Rasterizer(nullptr, scene, camera, std::move(report_fn), settings) {
+}
+
+Rasterizer::Rasterizer(Scene const& scene, Instance::Camera const& camera,
+                       std::function<void(Render_Report)>&& report_fn)
+	: Rasterizer(scene, camera, std::move(report_fn), Settings{}) {
+}
+
+Rasterizer::Rasterizer(std::shared_ptr<RasterJob> reuse, Scene const& scene,
+                       Instance::Camera const& camera,
+                       std::function<void(Render_Report)>&& report_fn, Settings const& settings) {
 
 	// copy data into the rasterization job:
-	job = std::make_unique<RasterJob>(scene, camera, std::move(report_fn));
+	if (reuse && reuse->matches_film(camera)) {
+		// same film, so the old framebuffer can be cleared and used again:
+		job = std::move(reuse);
+		job->reset(std::move(report_fn), settings);
+		job->update(scene, camera);
+	} else if (reuse) {
+		job = std::make_shared<RasterJob>(std::move(*reuse), scene, camera, std::move(report_fn), settings);
+	} else {
+		job = std::make_shared<RasterJob>(scene, camera, std::move(report_fn), settings);
+	}
 
 	// get pointer to output framebuffer (for later use):
 	framebuffer = &job->framebuffer;
@@ -701,3 +911,67 @@ bool Rasterizer::in_progress() {
 	}
 	return future.valid();
 }
+
+std::shared_ptr<RasterJob> Rasterizer::render_bands(
+	std::shared_ptr<RasterJob> reuse, Scene const& scene, Instance::Camera const& camera,
+	uint32_t bucket_size, std::function<void(uint32_t y_begin, HDR_Image&& band)> const& band_fn,
+	Settings const& settings) {
+	Camera const& film_camera = *camera.camera.lock();
+	uint32_t width = film_camera.film.width;
+	uint32_t height = film_camera.film.height;
+
+	// tiles are framebuffers, so they must have even dimensions within the framebuffer limits:
+	uint32_t tile_w = std::min({bucket_size, Framebuffer::MaxWidth, width + 1}) & ~1u;
+	uint32_t tile_h = std::min({bucket_size, Framebuffer::MaxHeight, height + 1}) & ~1u;
+	tile_w = std::max(tile_w, 2u);
+	tile_h = std::max(tile_h, 2u);
+
+	std::shared_ptr<RasterJob> job;
+	if (reuse && reuse->matches_framebuffer(tile_w, tile_h, SamplePattern::from_id(film_camera.film.sample_pattern))) {
+		job = std::move(reuse);
+		job->reset(nullptr, settings);
+		job->update(scene, camera);
+	} else {
+		job = std::make_shared<RasterJob>(reuse.get(), scene, camera, tile_w, tile_h, nullptr, settings);
+	}
+	Mat4 film_world_to_clip = job->world_to_clip;
+
+	// film-to-tile scale (the offset depends on the tile's position):
+	float sx = width / float(tile_w);
+	float sy = height / float(tile_h);
+
+	for (uint32_t y_end = height; y_end > 0;) {
+		uint32_t y_begin = (y_end > tile_h ? y_end - tile_h : 0);
+		HDR_Image band(width, y_end - y_begin);
+
+		for (uint32_t x_begin = 0; x_begin < width; x_begin += tile_w) {
+			// map the part of clip space covered by the tile to all of clip space:
+			Vec3 offset(sx - 1.0f - 2.0f * x_begin / float(tile_w),
+			            sy - 1.0f - 2.0f * y_begin / float(tile_h), 0.0f);
+			job->world_to_clip =
+				Mat4::translate(offset) * Mat4::scale(Vec3(sx, sy, 1.0f)) * film_world_to_clip;
+			job->reset(nullptr, settings);
+			job->run();
+
+			// copy the part of the tile that lies inside the film and band:
+			HDR_Image colors = job->framebuffer.resolve_colors();
+			uint32_t w = std::min(tile_w, width - x_begin);
+			for (uint32_t y = 0; y < band.h; ++y) {
+				for (uint32_t x = 0; x < w; ++x) {
+					band.at(x_begin + x, y) = colors.at(x, y);
+				}
+			}
+		}
+
+		band_fn(y_begin, std::move(band));
+		y_end = y_begin;
+	}
+
+	return job;
+}
+
+std::shared_ptr<RasterJob> Rasterizer::release() {
+	cancel();
+	framebuffer = nullptr;
+	return std::move(job);
+}
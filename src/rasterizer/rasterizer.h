@@ -8,12 +8,15 @@
  *
  */
 
+#include <cstdint>
 #include <future>
+#include <memory>
 #include <string>
 
 #include "../util/hdr_image.h"
 
 class Scene;
+class Thread_Pool;
 struct RasterJob;
 struct Framebuffer;
 namespace Instance {
@@ -32,6 +35,27 @@ public:
 	};
 	*/
 
+	// how instances with transparent (Glass, Refract) materials are composited:
+	enum class Transparency : uint8_t {
+		sorted,   // instances sorted back-to-front by origin and 'over' blended
+		weighted, // weighted-blended order-independent transparency (fast, approximate)
+		kbuffer,  // per-sample lists of the nearest Framebuffer::KBufferLayers fragments, composited
+		          // in depth order (exact unless more layers overlap)
+		count
+	};
+	static const char* Transparency_Names[static_cast<uint8_t>(Transparency::count)];
+
+	// options that change how (but not what) the scene is rasterized:
+	struct Settings {
+		Transparency transparency = Transparency::sorted;
+		// deferred shading: depth-tested opaque triangles are rasterized into a G-buffer and only
+		// their visible samples are shaded, in parallel (saves shading work under overdraw):
+		bool deferred = false;
+		// threads for the deferred shading pass; if null, each job starts its own pool
+		// (share one when several Rasterizers run at once, so they don't oversubscribe the CPU):
+		Thread_Pool* thread_pool = nullptr;
+	};
+
 	// to start rendering a scene, construct a Rasterizer and pass the scene and camera through
 	// which to render it.
 	//
@@ -39,8 +63,16 @@ public:
 	// render) camera does not need to be member of the scene report_fn will be called with updates
 	// on progress and copies of the image produced so far.
 	// 		(report_fn will run in a separate thread! be careful to synchronize.)
+	Rasterizer(Scene const& scene, Instance::Camera const& camera,
+	           std::function<void(Render_Report)>&& report_fn, Settings const& settings);
+	// (with default settings:)
 	Rasterizer(Scene const& scene, Instance::Camera const& camera,
 	           std::function<void(Render_Report)>&& report_fn);
+	// (re-using the job from an earlier Rasterizer, see release(); may be null:)
+	//  converted meshes and textures are only re-copied if they changed in the scene, and the
+	//  framebuffer's allocations are re-used if the camera's film is the same.
+	Rasterizer(std::shared_ptr<RasterJob> reuse, Scene const& scene, Instance::Camera const& camera,
+	           std::function<void(Render_Report)>&& report_fn, Settings const& settings);
 
 	// Destroying the rasterizer will cancel rasterization:
 	~Rasterizer();
@@ -57,6 +89,22 @@ public:
 	// ...or just ask if it is still running:
 	bool in_progress();
 
+	// cancel rasterization (if running) and give up the job, so a later Rasterizer can re-use its
+	// copy of the scene data; framebuffer is null afterward:
+	std::shared_ptr<RasterJob> release();
+
+	// tiled rendering (blocks until done): rasterizes the film in bucket_size x bucket_size tiles
+	// (rounded down to even and clamped to the Framebuffer limits), so films larger than
+	// Framebuffer::MaxWidth x MaxHeight can be rendered. Finished bands of tiles are handed to
+	// band_fn along with the film row they start at, top band first.
+	// Like the constructor, this re-uses converted scene data from 'reuse' (may be null); the job
+	// is returned so that later renders can do the same:
+	static std::shared_ptr<RasterJob>
+	render_bands(std::shared_ptr<RasterJob> reuse, Scene const& scene, Instance::Camera const& camera,
+	             uint32_t bucket_size,
+	             std::function<void(uint32_t y_begin, HDR_Image&& band)> const& band_fn,
+	             Settings const& settings);
+
 	// if finished, you may read:
 	// 		(otherwise, beware that async job may be writing these)
 	float completion_time = std::numeric_limits<float>::quiet_NaN();
@@ -67,7 +115,7 @@ public:
 
 private:
 	// contains all the state needed by the other thread:
-	std::unique_ptr<RasterJob> job;
+	std::shared_ptr<RasterJob> job;
 
 	// future used to manage async compute thread:
 	std::future<void> future;
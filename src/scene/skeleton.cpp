@@ -1,6 +1,7 @@
 #include <unordered_set>
 #include "skeleton.h"
 #include "test.h"
+#include "../geometry/mesh_bvh.h"
 #include <iostream>
 
 void Skeleton::Bone::compute_rotation_axes(Vec3 *x_, Vec3 *y_, Vec3 *z_) const {
@@ -122,6 +123,79 @@ void Skeleton::assign_bone_weights(Halfedge_Mesh *mesh_) const {
 
 	//you should fill in the helper closest_point_on_line_segment() before working on this function
 
+	//on dense meshes, testing every vertex against every bone is slow; a Mesh_BVH built once
+	// can instead return just the vertices within radius of a bone (Mesh_BVH::vertices_near_segment)
+
+}
+
+Skinning_Table::Skinning_Table(Halfedge_Mesh const &mesh) {
+	//vertices are numbered in list order:
+	std::unordered_map< Halfedge_Mesh::VertexCRef, uint32_t > vertex_index;
+	vertex_index.reserve(mesh.vertices.size());
+	positions.reserve(mesh.vertices.size());
+	vertex_ids.reserve(mesh.vertices.size());
+	weight_begin.reserve(mesh.vertices.size() + 1);
+	weight_begin.emplace_back(0);
+	for (auto v = mesh.vertices.begin(); v != mesh.vertices.end(); ++v) {
+		vertex_index.emplace(v, uint32_t(positions.size()));
+		positions.emplace_back(v->position);
+		vertex_ids.emplace_back(v->id);
+		weights.insert(weights.end(), v->bone_weights.begin(), v->bone_weights.end());
+		weight_begin.emplace_back(uint32_t(weights.size()));
+	}
+
+	//corners in the same order as Indexed_Mesh::from_halfedge_mesh(mesh, SplitEdges):
+	for (auto const &f : mesh.faces) {
+		if (f.boundary) continue;
+		uint32_t corners_begin = uint32_t(corner_vertex.size());
+		auto h = f.halfedge;
+		do {
+			corner_vertex.emplace_back(vertex_index.at(h->vertex));
+			corner_normals.emplace_back(h->corner_normal);
+			corner_uvs.emplace_back(h->corner_uv);
+			corner_ids.emplace_back(f.id);
+			h = h->next;
+		} while (h != f.halfedge);
+		uint32_t corners_end = uint32_t(corner_vertex.size());
+
+		//divide face into a triangle fan:
+		for (uint32_t i = corners_begin + 1; i + 1 < corners_end; ++i) {
+			indices.emplace_back(corners_begin);
+			indices.emplace_back(i);
+			indices.emplace_back(i + 1);
+		}
+	}
+}
+
+bool Skinning_Table::matches(Halfedge_Mesh const &mesh) const {
+	if (mesh.vertices.size() != positions.size()) return false;
+
+	uint32_t v = 0;
+	for (auto const &vertex : mesh.vertices) {
+		if (vertex.id != vertex_ids[v] || vertex.position != positions[v]) return false;
+		if (vertex.bone_weights.size() != weight_begin[v+1] - weight_begin[v]) return false;
+		for (uint32_t w = 0; w < vertex.bone_weights.size(); ++w) {
+			auto const &bw = weights[weight_begin[v] + w];
+			if (vertex.bone_weights[w].bone != bw.bone || vertex.bone_weights[w].weight != bw.weight) return false;
+		}
+		++v;
+	}
+
+	//(vertex ids are unique, and corners are checked against their face's id, so a face
+	// with a different corner count or a different vertex at a corner will not match)
+	uint32_t c = 0;
+	for (auto const &f : mesh.faces) {
+		if (f.boundary) continue;
+		auto h = f.halfedge;
+		do {
+			if (c == corner_vertex.size()) return false;
+			if (corner_ids[c] != f.id || vertex_ids[corner_vertex[c]] != h->vertex->id) return false;
+			if (corner_normals[c] != h->corner_normal || corner_uvs[c] != h->corner_uv) return false;
+			++c;
+			h = h->next;
+		} while (h != f.halfedge);
+	}
+	return c == corner_vertex.size();
 }
 
 Indexed_Mesh Skeleton::skin(Halfedge_Mesh const &mesh, std::vector< Mat4 > const &bind, std::vector< Mat4 > const &current) {
@@ -167,6 +241,56 @@ Indexed_Mesh Skeleton::skin(Halfedge_Mesh const &mesh, std::vector< Mat4 > const
 	return result;
 }
 
+void Skeleton::skin(Skinning_Table const &table, std::vector< Mat4 > const &bind, std::vector< Mat4 > const &current, Indexed_Mesh &out) {
+	assert(bind.size() == current.size());
+
+	//bind-to-current transform of every bone:
+	std::vector< Mat4 > bone_transforms(bind.size());
+	for (uint32_t b = 0; b < bind.size(); ++b) {
+		bone_transforms[b] = current[b] * bind[b].inverse();
+	}
+
+	//positions (and the transform for normals) at every vertex:
+	uint32_t vertices = uint32_t(table.positions.size());
+	std::vector< Vec3 > skinned_positions(vertices);
+	std::vector< Mat4 > normal_transforms(vertices);
+	Halfedge_Mesh::parallel_for(vertices, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t v = begin; v < end; ++v) {
+			if (table.weight_begin[v] == table.weight_begin[v+1]) {
+				//(vertices with no bone weights stay in place)
+				skinned_positions[v] = table.positions[v];
+				normal_transforms[v] = Mat4::I;
+				continue;
+			}
+			Mat4 blended = Mat4::Zero;
+			for (uint32_t w = table.weight_begin[v]; w < table.weight_begin[v+1]; ++w) {
+				if (table.weights[w].bone >= bone_transforms.size()) continue;
+				blended += table.weights[w].weight * bone_transforms[table.weights[w].bone];
+			}
+			skinned_positions[v] = blended * table.positions[v];
+			normal_transforms[v] = blended.inverse().T();
+		}
+	});
+
+	//corners, in SplitEdges layout:
+	uint32_t corners = uint32_t(table.corner_vertex.size());
+	std::vector< Indexed_Mesh::Vert > &verts = out.vertices();
+	verts.resize(corners);
+	Halfedge_Mesh::parallel_for(corners, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t c = begin; c < end; ++c) {
+			uint32_t v = table.corner_vertex[c];
+			Indexed_Mesh::Vert &vert = verts[c];
+			vert.pos = skinned_positions[v];
+			vert.norm = normal_transforms[v].rotate(table.corner_normals[c]).unit();
+			vert.uv = table.corner_uvs[c];
+			vert.id = table.corner_ids[c];
+		}
+	});
+
+	//triangles only depend on the table's connectivity:
+	out.indices() = table.indices;
+}
+
 void Skeleton::for_bones(const std::function<void(Bone&)>& f) {
 	for (auto& bone : bones) {
 		f(bone);
@@ -290,9 +414,60 @@ Indexed_Mesh Skinned_Mesh::bind_mesh() const {
 }
 
 Indexed_Mesh Skinned_Mesh::posed_mesh() const {
-	return Skeleton::skin(mesh, skeleton.bind_pose(), skeleton.current_pose());
+	Indexed_Mesh posed;
+	posed_mesh(posed);
+	return posed;
+}
+
+std::shared_ptr< Skinning_Table const > Skinned_Mesh::table() const {
+	//flatten the mesh for skinning only after mesh_changed() has dropped the old table:
+	// (the vertex count check is O(1) and catches edits that forgot to call mesh_changed())
+	std::shared_ptr< Skinning_Table const > table = std::atomic_load(&skinning_table);
+	if (!table || table->positions.size() != mesh.vertices.size()) {
+		table = std::make_shared< Skinning_Table const >(mesh);
+		std::atomic_store(&skinning_table, table);
+		std::atomic_store(&subdivision_stencils, std::shared_ptr< Subdivision_Stencils const >());
+	}
+	return table;
+}
+
+void Skinned_Mesh::posed_mesh(Indexed_Mesh &out) const {
+	std::shared_ptr< Skinning_Table const > table = this->table();
+
+	if (subdivision_levels == 0) {
+		Skeleton::skin(*table, skeleton.bind_pose(), skeleton.current_pose(), out);
+		return;
+	}
+
+	Indexed_Mesh posed;
+	Skeleton::skin(*table, skeleton.bind_pose(), skeleton.current_pose(), posed);
+
+	//subdivide the skinned cage with precomputed stencils:
+	try {
+		std::shared_ptr< Subdivision_Stencils const > stencils = std::atomic_load(&subdivision_stencils);
+		if (!stencils || stencils->levels() != subdivision_levels) {
+			stencils = std::make_shared< Subdivision_Stencils const >(mesh, subdivision_levels);
+			std::atomic_store(&subdivision_stencils, stencils);
+		}
+		out = stencils->refine(stencils->cage_positions_from_corners(posed));
+	} catch (std::exception &e) {
+		warn("Not subdividing skinned mesh: %s", e.what());
+		out = std::move(posed);
+	}
+}
+
+void Skinned_Mesh::mesh_changed() {
+	std::atomic_store(&skinning_table, std::shared_ptr< Skinning_Table const >());
+	std::atomic_store(&subdivision_stencils, std::shared_ptr< Subdivision_Stencils const >());
 }
 
 Skinned_Mesh Skinned_Mesh::copy() {
-	return Skinned_Mesh{mesh.copy(), skeleton.copy()};
+	Skinned_Mesh ret;
+	ret.mesh = mesh.copy();
+	ret.skeleton = skeleton.copy();
+	ret.subdivision_levels = subdivision_levels;
+	//(copy has the same mesh data, so can share what was derived from it)
+	ret.subdivision_stencils = std::atomic_load(&subdivision_stencils);
+	ret.skinning_table = std::atomic_load(&skinning_table);
+	return ret;
 }
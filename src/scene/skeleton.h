@@ -3,12 +3,39 @@
 
 #include "../geometry/halfedge.h"
 #include "../geometry/indexed.h"
+#include "../geometry/subdivision.h"
 #include "../lib/mathlib.h"
 #include "introspect.h"
 
 #include <functional>
 #include <memory>
 
+//A flattened copy of everything skinning reads from a Halfedge_Mesh, so posing is loops over arrays:
+// (building one walks the mesh once; Skinned_Mesh keeps one until told the mesh changed)
+class Skinning_Table {
+public:
+	Skinning_Table() = default;
+	explicit Skinning_Table(Halfedge_Mesh const &mesh);
+
+	//does 'mesh' still have exactly the data in this table?
+	// (one pass over the mesh with no allocation; much cheaper than rebuilding)
+	bool matches(Halfedge_Mesh const &mesh) const;
+
+	//--- vertices (in mesh.vertices order) ---
+	std::vector< Vec3 > positions; //bind-pose positions
+	std::vector< uint32_t > vertex_ids;
+	//bone weights of vertex v are [weight_begin[v], weight_begin[v+1]) of weights:
+	std::vector< uint32_t > weight_begin;
+	std::vector< Halfedge_Mesh::Vertex::Bone_Weight > weights;
+
+	//--- corners (laid out like Indexed_Mesh::from_halfedge_mesh(mesh, SplitEdges)'s vertices) ---
+	std::vector< uint32_t > corner_vertex; //vertex (index into positions) at each corner
+	std::vector< Vec3 > corner_normals; //bind-pose normals
+	std::vector< Vec2 > corner_uvs;
+	std::vector< uint32_t > corner_ids; //id of the face each corner belongs to
+	std::vector< Indexed_Mesh::Index > indices; //triangle fans over corners
+};
+
 class Skeleton {
 public:
 	using BoneIndex = uint32_t;
@@ -116,6 +143,9 @@ public:
 	// vertices with empty bone weights are not moved
 	// outputs an Indexed_Mesh with split normals
 	static Indexed_Mesh skin(Halfedge_Mesh const &mesh, std::vector< Mat4 > const &bind, std::vector< Mat4 > const &current);
+	//linear blend skinning of a mesh flattened into a Skinning_Table; writes into 'out' (reusing its storage):
+	// (same layout as skin() above; used by Skinned_Mesh::posed_mesh)
+	static void skin(Skinning_Table const &table, std::vector< Mat4 > const &bind, std::vector< Mat4 > const &current, Indexed_Mesh &out);
 
 	//helpers for the UI:
 
@@ -155,10 +185,24 @@ public:
 	Halfedge_Mesh mesh;
 	Skeleton skeleton;
 
+	//rounds of Catmull-Clark subdivision applied to the posed mesh when rendering:
+	// (not saved with the scene)
+	uint32_t subdivision_levels = 0;
+
 	Skinned_Mesh copy();
 
 	Indexed_Mesh bind_mesh() const;
 	Indexed_Mesh posed_mesh() const;
+	//posed_mesh(), written into 'out' (reusing its storage, e.g. from the previous frame):
+	void posed_mesh(Indexed_Mesh &out) const;
+
+	//call after editing mesh (positions, connectivity, corner data, or bone weights), so the
+	// data cached for posing it is rebuilt: (Undo::update_cached does this for every edit it records)
+	void mesh_changed();
+
+	//the table posed_mesh() skins (built if needed); mesh_changed() replaces it rather than editing it,
+	// so posed_mesh() gives the same result as long as this, subdivision_levels, and the skeleton's poses do:
+	std::shared_ptr< Skinning_Table const > table() const;
 
 	template< Intent I, typename F, typename T >
 	static void introspect(F&& f, T&& t) {
@@ -166,4 +210,10 @@ public:
 		f("skeleton", t.skeleton);
 	}
 	static inline const char *TYPE = "Skinned_Mesh";
+
+private:
+	//data derived from mesh, built on first use and dropped by mesh_changed():
+	// (accessed with std::atomic_load/store since renderers may pose meshes concurrently)
+	mutable std::shared_ptr< Subdivision_Stencils const > subdivision_stencils; //for subdivision_levels
+	mutable std::shared_ptr< Skinning_Table const > skinning_table;
 };
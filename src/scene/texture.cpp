@@ -1,6 +1,7 @@
 
 #include "texture.h"
 
+#include <array>
 #include <iostream>
 
 namespace Textures {
@@ -37,6 +38,31 @@ Spectrum sample_trilinear(HDR_Image const &base, std::vector< HDR_Image > const
 	return sample_nearest(base, uv); //placeholder so image doesn't look blank
 }
 
+//block version of sample_nearest, used by Image::evaluate_block:
+// texel addresses for the whole block are computed in a branch-free loop (which the compiler
+// can vectorize), then texels are gathered.
+void sample_nearest_block(HDR_Image const &image, uint32_t count, Vec2 const *uv, Spectrum *out) {
+	assert(count <= Image::BlockSize);
+
+	float w = float(image.w);
+	float h = float(image.h);
+	int32_t max_x = int32_t(image.w) - 1;
+	int32_t max_y = int32_t(image.h) - 1;
+
+	std::array< uint32_t, Image::BlockSize > index;
+	for (uint32_t i = 0; i < count; ++i) {
+		//same computation as sample_nearest (x,y are non-negative, so truncation is floor):
+		int32_t ix = std::min(int32_t(w * std::clamp(uv[i].x, 0.0f, 1.0f)), max_x);
+		int32_t iy = std::min(int32_t(h * std::clamp(uv[i].y, 0.0f, 1.0f)), max_y);
+		index[i] = uint32_t(iy) * image.w + uint32_t(ix);
+	}
+
+	Spectrum const *pixels = image.data().data();
+	for (uint32_t i = 0; i < count; ++i) {
+		out[i] = pixels[index[i]];
+	}
+}
+
 /*
  * generate_mipmap- generate mipmap levels from a base image.
  *  base: the base image
@@ -125,6 +151,22 @@ Spectrum Image::evaluate(Vec2 uv, float lod) const {
 	}
 }
 
+void Image::evaluate_block(uint32_t count, Vec2 const *uv, float const *lod, Spectrum *out) const {
+	assert(count <= BlockSize);
+	if (image.w == 0 && image.h == 0) {
+		for (uint32_t i = 0; i < count; ++i) out[i] = Spectrum();
+		return;
+	}
+	if (sampler == Sampler::nearest) {
+		sample_nearest_block(image, count, uv, out);
+	} else if (sampler == Sampler::bilinear) {
+		//filtered samplers use the single-sample functions so results match evaluate() exactly:
+		for (uint32_t i = 0; i < count; ++i) out[i] = sample_bilinear(image, uv[i]);
+	} else {
+		for (uint32_t i = 0; i < count; ++i) out[i] = sample_trilinear(image, levels, uv[i], lod[i]);
+	}
+}
+
 void Image::update_mipmap() {
 	if (sampler == Sampler::trilinear) {
 		generate_mipmap(image, &levels);
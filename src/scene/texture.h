@@ -32,6 +32,11 @@ public:
 	//  lod is mipmap level to sample from. Ignored unless Sampler is trilinear.
 	Spectrum evaluate(Vec2 uv, float lod) const;
 
+	//Read a block of values from the image; same as calling evaluate(uv[i], lod[i]) -> out[i]
+	// for i in [0,count), but with sampler dispatch and texel addressing done once per block.
+	//  count must be at most BlockSize.
+	static constexpr uint32_t BlockSize = 8;
+	void evaluate_block(uint32_t count, Vec2 const *uv, float const *lod, Spectrum *out) const;
 
 	Sampler sampler;
 	HDR_Image image;
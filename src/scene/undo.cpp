@@ -1,45 +1,98 @@
 
 #include "undo.h"
 
+#include <algorithm>
+
 Undo::Undo(Scene& sc, Animator& an, Gui::Manager& manager)
 	: scene(sc), animator(an), manager(manager) {
 }
 
+size_t heap_bytes(Halfedge_Mesh const& mesh) {
+	//(list nodes hold an element and two links)
+	auto list_bytes = [](auto const& list) {
+		using T = typename std::decay_t<decltype(list)>::value_type;
+		return list.size() * (sizeof(T) + 2 * sizeof(void*));
+	};
+	size_t total = list_bytes(mesh.vertices) + list_bytes(mesh.edges) + list_bytes(mesh.faces) +
+	               list_bytes(mesh.halfedges);
+	for (auto const& v : mesh.vertices) {
+		total += v.bone_weights.capacity() * sizeof(Halfedge_Mesh::Vertex::Bone_Weight);
+	}
+	return total;
+}
+
+size_t heap_bytes(Skinned_Mesh const& mesh) {
+	return heap_bytes(mesh.mesh);
+}
+
 void Undo::reset() {
-	undos = {};
-	redos = {};
+	undos.clear();
+	redos.clear();
+	total_bytes = 0;
 }
 
 void Undo::action(std::unique_ptr<Action_Base>&& action) {
-	redos = {};
-	undos.push(std::move(action));
+	for (auto& a : redos) total_bytes -= a->bytes();
+	redos.clear();
+	total_bytes += action->bytes();
+	undos.push_back(std::move(action));
 	total_actions++;
+	trim();
 }
 
 void Undo::undo() {
 	if (undos.empty()) return;
-	undos.top()->undo();
-	redos.push(std::move(undos.top()));
-	undos.pop();
+	std::unique_ptr<Action_Base> a = std::move(undos.back());
+	undos.pop_back();
+	//(an action's size may change when it runs, e.g. Action_Update moves values around)
+	total_bytes -= a->bytes();
+	a->undo();
+	total_bytes += a->bytes();
+	redos.push_back(std::move(a));
 	total_actions++;
+	trim();
 }
 
 void Undo::redo() {
 	if (redos.empty()) return;
-	redos.top()->redo();
-	undos.push(std::move(redos.top()));
-	redos.pop();
+	std::unique_ptr<Action_Base> a = std::move(redos.back());
+	redos.pop_back();
+	total_bytes -= a->bytes();
+	a->redo();
+	total_bytes += a->bytes();
+	undos.push_back(std::move(a));
 	total_actions++;
+	trim();
 }
 
 void Undo::bundle_last(size_t n) {
+	//(older actions may have been dropped to fit the budget)
+	n = std::min(n, undos.size());
 	if (!n) return;
 	std::vector<std::unique_ptr<Action_Base>> undo_pack;
 	for (size_t i = 0; i < n; i++) {
-		undo_pack.push_back(std::move(undos.top()));
-		undos.pop();
+		total_bytes -= undos.back()->bytes();
+		undo_pack.push_back(std::move(undos.back()));
+		undos.pop_back();
+	}
+	undos.push_back(std::make_unique<Action_Bundle>(std::move(undo_pack)));
+	total_bytes += undos.back()->bytes();
+}
+
+void Undo::set_budget(size_t budget_) {
+	budget = budget_;
+	trim();
+}
+
+size_t Undo::bytes() const {
+	return total_bytes;
+}
+
+void Undo::trim() {
+	while (total_bytes > budget && undos.size() > 1) {
+		total_bytes -= undos.front()->bytes();
+		undos.pop_front();
 	}
-	undos.push(std::make_unique<Action_Bundle>(std::move(undo_pack)));
 }
 
 size_t Undo::n_actions() {
@@ -1,11 +1,12 @@
 
 #pragma once
 
+#include <deque>
 #include <memory>
-#include <stack>
 
 #include "../gui/manager.h"
 #include "../gui/widgets.h"
+#include "../lib/log.h"
 #include "../util/viewer.h"
 
 #include "animator.h"
@@ -13,9 +14,21 @@
 
 template<typename T> class Action_Update_Cached;
 
+//memory a resource holds beyond sizeof(T), as counted against the undo budget:
+// (only meshes are counted, since they are what makes the history large)
+template<typename T> size_t heap_bytes(T const&) {
+	return 0;
+}
+size_t heap_bytes(Halfedge_Mesh const& mesh);
+size_t heap_bytes(Skinned_Mesh const& mesh);
+
 class Action_Base {
 	virtual void undo() = 0;
 	virtual void redo() = 0;
+	//(approximate) memory held by the action:
+	virtual size_t bytes() const {
+		return sizeof(*this);
+	}
 	friend class Undo;
 	friend class Action_Bundle;
 
@@ -45,6 +58,11 @@ class Action_Bundle : public Action_Base {
 	void redo() {
 		for (auto i = list.rbegin(); i != list.rend(); i++) (*i)->redo();
 	}
+	size_t bytes() const {
+		size_t total = sizeof(*this);
+		for (auto& a : list) total += a->bytes();
+		return total;
+	}
 
 	std::vector<std::unique_ptr<Action_Base>> list;
 
@@ -101,6 +119,9 @@ template<typename T> class Action_Update : public Action_Base {
 			*r = std::move(old_value);
 		}
 	}
+	size_t bytes() const {
+		return sizeof(*this) + heap_bytes(old_value) + heap_bytes(new_value);
+	}
 
 	std::weak_ptr<T> resource;
 	T old_value, new_value;
@@ -135,6 +156,52 @@ public:
 	~Action_Update_Cached() = default;
 };
 
+//Mesh updates that only keep the elements the edit changed (see Halfedge_Mesh::Delta):
+// Only the delta for the next step is stored; each undo/redo diffs the mesh it replaced
+// to get the delta back, so recording an edit costs one diff and the history holds one delta per edit.
+// If a delta doesn't fit the mesh (it was edited without going through undo), the mesh is
+// restored as it was and the step is skipped with a warning.
+class Action_Mesh_Delta : public Action_Base {
+	void redo() {
+		step("redo");
+	}
+	void undo() {
+		step("undo");
+	}
+	void step(char const* what) {
+		if (auto r = resource.lock()) {
+			//(apply() may fail partway, so keep what the mesh was to put back)
+			Halfedge_Mesh before = r->copy();
+			try {
+				r->apply(delta);
+				std::optional<Halfedge_Mesh::Delta> back = Halfedge_Mesh::diff(before, *r);
+				if (!back) throw std::runtime_error("result could not be diffed");
+				delta = std::move(*back);
+			} catch (std::exception const& e) {
+				*r = std::move(before);
+				warn("Could not %s edit of '%s' (%s); leaving the mesh as it was.", what, name.c_str(),
+				     e.what());
+			}
+		}
+		manager.invalidate_gpu(name);
+	}
+	size_t bytes() const {
+		return sizeof(*this) + delta.bytes();
+	}
+
+	std::string name;
+	Gui::Manager& manager;
+	std::weak_ptr<Halfedge_Mesh> resource;
+	Halfedge_Mesh::Delta delta;
+
+public:
+	Action_Mesh_Delta(Gui::Manager& manager, const std::string& name,
+	                  std::weak_ptr<Halfedge_Mesh> resource, Halfedge_Mesh::Delta&& undo_delta)
+		: name(name), manager(manager), resource(std::move(resource)),
+		  delta(std::move(undo_delta)){};
+	~Action_Mesh_Delta() = default;
+};
+
 class Action_Rename : public Action_Base {
 	void redo() {
 		new_name = scene.rename(old_name, new_name).value_or("");
@@ -188,11 +255,32 @@ public:
 	template<typename T>
 	void update_cached(const std::string& name, std::weak_ptr<T> resource, T old_value) {
 		if (resource.expired()) return;
+		if constexpr (std::is_same_v<T, Skinned_Mesh>) {
+			//(the edit being recorded may have changed the mesh, so drop what was derived from it)
+			resource.lock()->mesh_changed();
+		}
+		if constexpr (std::is_same_v<T, Halfedge_Mesh>) {
+			//keep only what changed, unless the meshes can't be diffed (e.g., ids aren't unique):
+			auto current = resource.lock();
+			if (auto undo_delta = Halfedge_Mesh::diff(old_value, *current)) {
+				update_delta(name, resource, std::move(*undo_delta));
+				return;
+			}
+		}
 		manager.invalidate_gpu(name);
 		action(std::make_unique<Action_Update_Cached<T>>(manager, name, resource,
 		                                                 std::move(old_value)));
 	}
 
+	//record a mesh update whose undo delta was already computed (e.g., on a worker thread):
+	void update_delta(const std::string& name, std::weak_ptr<Halfedge_Mesh> resource,
+	                  Halfedge_Mesh::Delta&& undo_delta) {
+		if (resource.expired()) return;
+		manager.invalidate_gpu(name);
+		action(std::make_unique<Action_Mesh_Delta>(manager, name, std::move(resource),
+		                                           std::move(undo_delta)));
+	}
+
 	void rename(const std::string& old_name, const std::string& new_name) {
 		scene.rename(old_name, new_name);
 		action(std::make_unique<Action_Rename>(old_name, new_name, scene, animator));
@@ -209,6 +297,16 @@ public:
 	void inc_actions();
 	void bundle_last(size_t n);
 
+	//the oldest actions are dropped once the history holds more than 'budget' bytes:
+	// (the most recent action is always kept)
+	// This bounds what the history keeps, not the memory an edit uses while it is recorded:
+	// update_cached() is handed a full copy of the old value, since edits aren't instrumented to
+	// report what they touch. Mesh deltas already keep only changed elements and aren't compressed
+	// further; that would need a serialized Delta format and a compressor, neither of which exists here.
+	static constexpr size_t default_budget = size_t(1) << 30;
+	void set_budget(size_t budget);
+	size_t bytes() const;
+
 	void anim_set_max_frame(Gui::Animate& animate, uint32_t new_max_frame, uint32_t old_max_frame);
 	void anim_set_keyframe(const std::string& name, float key);
 	void anim_clear_keyframe(const std::string& name, float key);
@@ -223,7 +321,13 @@ private:
 		action(std::make_unique<Action_Fn<R, U>>(std::move(redo), std::move(undo)));
 	}
 
-	std::stack<std::unique_ptr<Action_Base>> undos;
-	std::stack<std::unique_ptr<Action_Base>> redos;
+	//drop the oldest undos until the history fits the budget:
+	void trim();
+
+	//newest actions are at the back:
+	std::deque<std::unique_ptr<Action_Base>> undos;
+	std::deque<std::unique_ptr<Action_Base>> redos;
 	size_t total_actions = 0;
+	size_t budget = default_budget;
+	size_t total_bytes = 0; //sum of bytes() over undos and redos
 };
\ No newline at end of file
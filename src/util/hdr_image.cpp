@@ -5,7 +5,10 @@
 #include <sf_libs/stb_image.h>
 #include <sf_libs/tinyexr.h>
 
+#include <array>
 #include <cstring>
+#include <fstream>
+#include <mutex>
 
 HDR_Image::HDR_Image(uint32_t w, uint32_t h, Spectrum color) : w(w), h(h) {
 	pixels.resize(w * h, color);
@@ -100,7 +103,16 @@ HDR_Image HDR_Image::load(const std::string& file) {
 }
 
 void HDR_Image::save(std::string const &filename) const {
-	warn("TODO: write image saving!");
+	//PFM: text header, then little-endian float RGB rows starting from the bottom (like 'pixels'):
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+
+	out << "PF\n" << w << " " << h << "\n-1.0\n"; //(negative scale => little-endian)
+	static_assert(sizeof(Spectrum) == 12, "Spectrum is packed");
+	out.write(reinterpret_cast< const char * >(pixels.data()), sizeof(Spectrum) * pixels.size());
+
+	out.close();
+	if (!out) throw std::runtime_error("Failed to write image to '" + filename + "'.");
 }
 
 constexpr char Raw_Float_format[4] = {'r','a','w','f'};
@@ -198,29 +210,81 @@ GL::Tex2D HDR_Image::to_gl(float e) const {
 	return tex;
 }
 
-void HDR_Image::tonemap_to(std::vector<uint8_t>& data, float e) const {
-
-	if (data.size() != w * h * 4) data.resize(w * h * 4);
+//tonemap one channel of radiance:
+static uint8_t tonemap_channel(float c, float e) {
+	float t = 1.0f - std::exp(-c * e);
+	return static_cast<uint8_t>(std::round(Spectrum::to_srgb(t) * 255.0f));
+}
 
-	for (uint32_t j = 0; j < h; j++) {
-		for (uint32_t i = 0; i < w; i++) {
+//Tonemapping calls exp and pow for every channel, which dominates the cost of saving or
+// displaying an image. But for a positive exposure it is a non-decreasing step function of the
+// radiance, so it is enough to know where each of the 255 steps happens: thresholds[k] is the
+// smallest radiance that tonemaps to k or more, and tonemapping becomes a search of the table.
+// (The thresholds are found using tonemap_channel itself, so the output doesn't change.)
+namespace {
+struct Tonemap_Table {
+	float exposure = std::numeric_limits<float>::quiet_NaN();
+	std::array< float, 256 > thresholds;
+
+	void build(float e) {
+		exposure = e;
+		thresholds[0] = -std::numeric_limits<float>::infinity();
+		//bisect on the bit patterns of non-negative floats, which sort like the floats:
+		uint32_t lo = 0;
+		for (uint32_t k = 1; k < 256; ++k) {
+			uint32_t hi = 0x7f800000; //+inf, which tonemaps to 255
+			while (lo < hi) {
+				uint32_t mid = lo + (hi - lo) / 2;
+				float c;
+				std::memcpy(&c, &mid, sizeof(c));
+				if (tonemap_channel(c, e) >= k) hi = mid;
+				else lo = mid + 1;
+			}
+			std::memcpy(&thresholds[k], &lo, sizeof(float));
+		}
+	}
 
-			uint32_t pidx = j * w + i;
-			const Spectrum& sample = pixels[pidx];
+	uint8_t operator()(float c) const {
+		//number of thresholds[1..255] <= c (branchless binary search; NaN and negative => 0):
+		uint32_t k = 0;
+		for (uint32_t step = 128; step > 0; step /= 2) {
+			k += (thresholds[k + step] <= c) ? step : 0;
+		}
+		return static_cast<uint8_t>(k);
+	}
+};
+} // namespace
 
-			float r = 1.0f - std::exp(-sample.r * e);
-			float g = 1.0f - std::exp(-sample.g * e);
-			float b = 1.0f - std::exp(-sample.b * e);
+void HDR_Image::tonemap_to(std::vector<uint8_t>& data, float e) const {
 
-			Spectrum out(r, g, b);
-			out = out.to_srgb();
+	if (data.size() != w * h * 4) data.resize(w * h * 4);
 
-			uint32_t didx = 4 * (j * w + i);
-			data[didx] = static_cast<uint8_t>(std::round(out.r * 255.0f));
-			data[didx + 1] = static_cast<uint8_t>(std::round(out.g * 255.0f));
-			data[didx + 2] = static_cast<uint8_t>(std::round(out.b * 255.0f));
-			data[didx + 3] = 255;
+	if (!(e > 0.0f)) {
+		//tonemapping isn't monotonic, so do it the slow way:
+		for (uint32_t i = 0; i < w * h; i++) {
+			data[4 * i + 0] = tonemap_channel(pixels[i].r, e);
+			data[4 * i + 1] = tonemap_channel(pixels[i].g, e);
+			data[4 * i + 2] = tonemap_channel(pixels[i].b, e);
+			data[4 * i + 3] = 255;
 		}
+		return;
+	}
+
+	//the table for the most recent exposure is kept, since it usually doesn't change:
+	static std::mutex table_mutex;
+	static Tonemap_Table shared_table;
+	Tonemap_Table table;
+	{
+		std::lock_guard< std::mutex > lock(table_mutex);
+		if (shared_table.exposure != e) shared_table.build(e);
+		table = shared_table;
+	}
+
+	for (uint32_t i = 0; i < w * h; i++) {
+		data[4 * i + 0] = table(pixels[i].r);
+		data[4 * i + 1] = table(pixels[i].g);
+		data[4 * i + 2] = table(pixels[i].b);
+		data[4 * i + 3] = 255;
 	}
 }
 
@@ -57,7 +57,7 @@ public:
 
 	//file I/O:
 	static HDR_Image load(const std::string& filename); //load from a file, throws on error
-	void save(std::string const &filename) const;
+	void save(std::string const &filename) const; //save raw radiance as PFM, throws on error
 
 	//memory I/O:
 	static HDR_Image decode(uint8_t const *buffer, size_t length); //load from memory buffer, throws on error
@@ -67,6 +67,7 @@ public:
 	static HDR_Image missing_image();
 
 	GL::Tex2D to_gl(float exposure) const;
+	//RGBA8 (row-major, bottom-left origin) with 1 - exp(-exposure * c) per channel, then sRGB encoded:
 	void tonemap_to(std::vector<uint8_t>& data, float exposure) const;
 
 	uint32_t w = 0, h = 0;
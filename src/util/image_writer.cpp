@@ -0,0 +1,73 @@
+
+#include "image_writer.h"
+#include "../lib/log.h"
+
+#include <filesystem>
+#include <sf_libs/stb_image_write.h>
+
+Image_Writer::Image_Writer(uint32_t max_queued_) : max_queued(std::max(max_queued_, 1u)) {
+	worker = std::thread([this]() { run(); });
+}
+
+Image_Writer::~Image_Writer() {
+	{
+		std::unique_lock< std::mutex > lock(queue_mutex);
+		stop = true;
+	}
+	queue_changed.notify_all();
+	worker.join();
+}
+
+bool Image_Writer::write(std::string const &filename, HDR_Image &&image, float exposure) {
+	std::unique_lock< std::mutex > lock(queue_mutex);
+	queue_changed.wait(lock, [this]() { return failed || queue.size() < max_queued; });
+	if (failed) return false;
+	queue.emplace_back(Job{filename, std::move(image), exposure});
+	lock.unlock();
+	queue_changed.notify_all();
+	return true;
+}
+
+bool Image_Writer::finish() {
+	std::unique_lock< std::mutex > lock(queue_mutex);
+	queue_changed.wait(lock, [this]() { return queue.empty(); });
+	return !failed;
+}
+
+void Image_Writer::run() {
+	std::unique_lock< std::mutex > lock(queue_mutex);
+	for (;;) {
+		//(stop only once everything queued has been written)
+		queue_changed.wait(lock, [this]() { return stop || !queue.empty(); });
+		if (queue.empty()) return;
+
+		//write the front job without holding the lock:
+		Job &job = queue.front();
+		lock.unlock();
+
+		bool ok = true;
+		if (std::filesystem::path(job.filename).extension() == ".pfm") {
+			try {
+				job.image.save(job.filename);
+			} catch (std::exception const &e) {
+				warn("ERROR: %s", e.what());
+				ok = false;
+			}
+		} else {
+			std::vector< uint8_t > data;
+			job.image.tonemap_to(data, job.exposure);
+
+			stbi_flip_vertically_on_write(true);
+			if (!stbi_write_png(job.filename.c_str(), job.image.w, job.image.h, 4, data.data(), job.image.w * 4)) {
+				warn("ERROR: Failed to write output to '%s'", job.filename.c_str());
+				ok = false;
+			}
+		}
+		if (ok) info("Wrote result to '%s'.", job.filename.c_str());
+
+		lock.lock();
+		if (!ok) failed = true;
+		queue.pop_front();
+		queue_changed.notify_all();
+	}
+}
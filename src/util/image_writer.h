@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "hdr_image.h"
+
+/*
+ *
+ * Image_Writer saves images on a background thread, so a renderer can start its next frame
+ * while the last one is tonemapped and encoded. Images are written in the order they are queued.
+ *
+ * Files ending in .pfm get raw floating-point radiance (for compositing); anything else is
+ * tonemapped with the given exposure and written as a PNG.
+ *
+ */
+class Image_Writer {
+public:
+	//at most max_queued images wait to be written (so memory use stays bounded):
+	explicit Image_Writer(uint32_t max_queued = 2);
+	//writes everything still queued:
+	~Image_Writer();
+
+	//queue an image to be written (blocks while the queue is full):
+	// returns false (without queueing) if an earlier write has failed
+	bool write(std::string const &filename, HDR_Image &&image, float exposure);
+
+	//wait for queued images to be written; returns false if any write has failed:
+	bool finish();
+
+	Image_Writer(Image_Writer const &) = delete;
+	Image_Writer &operator=(Image_Writer const &) = delete;
+
+private:
+	struct Job {
+		std::string filename;
+		HDR_Image image;
+		float exposure;
+	};
+
+	void run();
+
+	uint32_t max_queued;
+	std::mutex queue_mutex;
+	std::condition_variable queue_changed;
+	std::deque< Job > queue; //(the front job stays queued while it is being written)
+	bool failed = false;
+	bool stop = false;
+	std::thread worker;
+};
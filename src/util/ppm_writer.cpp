@@ -0,0 +1,43 @@
+
+#include "ppm_writer.h"
+
+#include <stdexcept>
+
+PPM_Writer::PPM_Writer(std::string const &filename_, uint32_t w_, uint32_t h_, float exposure_)
+	: w(w_), h(h_), filename(filename_), exposure(exposure_), y_end(h_) {
+
+	out.open(filename, std::ios::binary);
+	if (!out) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+
+	out << "P6\n" << w << " " << h << "\n255\n";
+	if (!out) throw std::runtime_error("Failed to write header to '" + filename + "'.");
+}
+
+void PPM_Writer::write_band(uint32_t y_begin, HDR_Image const &band) {
+	if (band.w != w) throw std::runtime_error("Band width doesn't match image width.");
+	if (y_begin + band.h != y_end) throw std::runtime_error("Bands must be written top to bottom without gaps.");
+
+	band.tonemap_to(rgba, exposure);
+
+	//drop alpha and flip rows to top-first order:
+	rgb.resize(size_t(w) * band.h * 3);
+	for (uint32_t j = 0; j < band.h; ++j) {
+		uint8_t const *src = rgba.data() + size_t(band.h - 1 - j) * w * 4;
+		uint8_t *dst = rgb.data() + size_t(j) * w * 3;
+		for (uint32_t i = 0; i < w; ++i) {
+			dst[3 * i + 0] = src[4 * i + 0];
+			dst[3 * i + 1] = src[4 * i + 1];
+			dst[3 * i + 2] = src[4 * i + 2];
+		}
+	}
+	out.write(reinterpret_cast< char const * >(rgb.data()), rgb.size());
+	if (!out) throw std::runtime_error("Failed to write to '" + filename + "'.");
+
+	y_end = y_begin;
+}
+
+void PPM_Writer::close() {
+	if (y_end != 0) throw std::runtime_error("Image written to '" + filename + "' is missing rows.");
+	out.close();
+	if (!out) throw std::runtime_error("Failed to finish writing '" + filename + "'.");
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "hdr_image.h"
+
+/*
+ *
+ * PPM_Writer streams a tonemapped image to a binary (P6) PPM file in horizontal bands,
+ * so images too large to hold in memory at once can still be written.
+ *
+ * Bands use HDR_Image's bottom-left origin, but PPM files store the top row first,
+ * so bands must be written from the top of the image down.
+ *
+ */
+class PPM_Writer {
+public:
+	//open the file and write the header (throws on failure):
+	PPM_Writer(std::string const &filename, uint32_t w, uint32_t h, float exposure = 1.0f);
+
+	//write rows [y_begin, y_begin + band.h) of the image:
+	//required: band.w == w, and the band ends where the previously written band began
+	void write_band(uint32_t y_begin, HDR_Image const &band);
+
+	//finish writing (throws if rows are missing or writing failed):
+	void close();
+
+	const uint32_t w, h;
+
+private:
+	std::string filename;
+	std::ofstream out;
+	float exposure;
+	uint32_t y_end; //rows [y_end, h) have been written
+
+	//scratch space for tonemapped rows:
+	std::vector< uint8_t > rgba, rgb;
+};
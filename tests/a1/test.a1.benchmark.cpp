@@ -0,0 +1,67 @@
+#include "test.h"
+#include "rasterizer/benchmark.h"
+
+/*
+The benchmark runs just the workload.pipeline names that include the filter, at least once each,
+and its stats count every primitive it drew
+*/
+Test test_a1_benchmark_filter("a1.benchmark.filter", []() {
+	std::vector< RasterBenchmark::Result > results = RasterBenchmark::run("Triangles_Replace_Always_Flat", 16, 16, 0.0f);
+
+	std::vector< std::string > expected = {
+		"small_triangles.Triangles_Replace_Always_Flat",
+		"large_triangles.Triangles_Replace_Always_Flat",
+		"overdraw.Triangles_Replace_Always_Flat",
+		"clipped_triangles.Triangles_Replace_Always_Flat",
+	};
+	if (results.size() != expected.size()) {
+		throw Test::error("Ran " + std::to_string(results.size()) + " benchmarks, expected " + std::to_string(expected.size()) + ".");
+	}
+	for (uint32_t i = 0; i < results.size(); ++i) {
+		RasterBenchmark::Result const &r = results[i];
+		if (r.name != expected[i]) {
+			throw Test::error("Benchmark " + std::to_string(i) + " is '" + r.name + "', expected '" + expected[i] + "'.");
+		}
+		if (r.runs == 0 || r.stats.vertices == 0 || r.stats.vertices != 3 * r.stats.primitives) {
+			throw Test::error("Benchmark '" + r.name + "' didn't count its runs or triangles.");
+		}
+		if (r.stats.primitives % r.runs != 0) {
+			throw Test::error("Benchmark '" + r.name + "' drew a different number of triangles in different runs.");
+		}
+		//(depth test is "Always", so every fragment inside the framebuffer passes)
+		if (r.stats.passed_fragments == 0 || r.stats.passed_fragments > r.stats.fragments) {
+			throw Test::error("Benchmark '" + r.name + "' passed " + std::to_string(r.stats.passed_fragments) + " of " + std::to_string(r.stats.fragments) + " fragments through an Always depth test.");
+		}
+	}
+
+	//16x16 pixels of 4x4-pixel cells is 16 quads:
+	if (results[0].stats.primitives != 32 * uint64_t(results[0].runs)) {
+		throw Test::error("small_triangles drew " + std::to_string(results[0].stats.primitives / results[0].runs) + " triangles per run, expected 32.");
+	}
+	//32 full-screen quads:
+	if (results[2].stats.primitives != 64 * uint64_t(results[2].runs)) {
+		throw Test::error("overdraw drew " + std::to_string(results[2].stats.primitives / results[2].runs) + " triangles per run, expected 64.");
+	}
+});
+
+/*
+Line workloads run through line pipelines, "Never" depth tests pass nothing, and a filter nothing matches runs nothing
+*/
+Test test_a1_benchmark_lines("a1.benchmark.lines", []() {
+	std::vector< RasterBenchmark::Result > results = RasterBenchmark::run("Lines_Replace_Never", 16, 16, 0.0f);
+	if (results.size() != 2 || results[0].name != "wireframe.Lines_Replace_Never" || results[1].name != "long_lines.Lines_Replace_Never") {
+		throw Test::error("Line benchmarks don't match the filter.");
+	}
+	for (auto const &r : results) {
+		if (r.stats.vertices != 2 * r.stats.primitives) {
+			throw Test::error("Benchmark '" + r.name + "' didn't count its lines.");
+		}
+		if (r.stats.passed_fragments != 0) {
+			throw Test::error("Benchmark '" + r.name + "' has fragments that passed a Never depth test.");
+		}
+	}
+
+	if (!RasterBenchmark::run("no_such_benchmark", 16, 16, 0.0f).empty()) {
+		throw Test::error("A filter that matches nothing still ran benchmarks.");
+	}
+});
@@ -0,0 +1,115 @@
+#include "test.h"
+
+//Actually include the *definitions* (not just the declarations):
+#include "rasterizer/pipeline.cpp"
+// (needed to instantiate Pipeline< > with the Copy program)
+
+//triangle covering (1.5, 1.5) on a 2x2 framebuffer, at requested depth and color:
+template< typename P >
+static std::vector< typename P::Vertex > deferred_test_triangle(float depth, Spectrum color) {
+	using PVertex = typename P::Vertex;
+
+	std::vector< PVertex > vertices;
+	vertices.emplace_back( PVertex{ std::array< float, 8 >{ 0.25f, 0.25f, depth, 1.0f,  color.r, color.g, color.b, 1.0f } } );
+	vertices.emplace_back( PVertex{ std::array< float, 8 >{ 0.75f, 0.50f, depth, 1.0f,  color.r, color.g, color.b, 1.0f } } );
+	vertices.emplace_back( PVertex{ std::array< float, 8 >{ 0.50f, 0.75f, depth, 1.0f,  color.r, color.g, color.b, 1.0f } } );
+	return vertices;
+}
+
+static const Spectrum DeferredBlank(0.31415926f, 0.0f, 0.31415926f);
+
+static Framebuffer deferred_test_fb() {
+	static SamplePattern const *center = SamplePattern::from_id(1);
+	Framebuffer fb(2,2,*center);
+	fb.colors.assign(fb.colors.size(), DeferredBlank);
+	return fb;
+}
+
+Test test_a1_deferred_matches_forward("a1.deferred.matches_forward", []() {
+	using Forward = Pipeline< PrimitiveType::Triangles, Programs::Copy, Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Flat >;
+	using Deferred = Pipeline< PrimitiveType::Triangles, Programs::Copy, Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Flat | Pipeline_GBufferWriteBit >;
+
+	Spectrum first(0.75f, 0.5f, 0.25f);
+	Spectrum second(0.1f, 0.2f, 0.4f);
+
+	Framebuffer forward = deferred_test_fb();
+	Forward::run(deferred_test_triangle< Forward >(0.0f, first), Programs::Copy::Parameters(), &forward);
+	Forward::run(deferred_test_triangle< Forward >(0.0f, second), Programs::Copy::Parameters(), &forward);
+
+	Framebuffer deferred = deferred_test_fb();
+	deferred.clear_gbuffer(Programs::Copy::FA + 2 * Programs::Copy::FD);
+	std::vector< Programs::Copy::Parameters > parameters(2);
+	deferred.gbuffer_id = 0;
+	Deferred::run(deferred_test_triangle< Deferred >(0.0f, first), parameters[0], &deferred);
+	deferred.gbuffer_id = 1;
+	Deferred::run(deferred_test_triangle< Deferred >(0.0f, second), parameters[1], &deferred);
+
+	//nothing should be shaded before the deferred pass:
+	for (auto const &c : deferred.colors) {
+		if (c != DeferredBlank) throw Test::error("G-buffer pipeline wrote colors before shade_deferred.");
+	}
+
+	//shade in two ranges, as a threaded pass would:
+	uint32_t samples = uint32_t(deferred.colors.size());
+	Deferred::shade_deferred(parameters, &deferred, 0, samples / 2);
+	Deferred::shade_deferred(parameters, &deferred, samples / 2, samples);
+
+	for (uint32_t y = 0; y < 2; ++y) {
+		for (uint32_t x = 0; x < 2; ++x) {
+			if (Test::differs(forward.color_at(x,y,0), deferred.color_at(x,y,0))) {
+				throw Test::error("Deferred color at (" + std::to_string(x) + "," + std::to_string(y) + ") is " + to_string(deferred.color_at(x,y,0)) + ", forward shading got " + to_string(forward.color_at(x,y,0)) + ".");
+			}
+			if (forward.depth_at(x,y,0) != deferred.depth_at(x,y,0)) {
+				throw Test::error("Deferred depth differs from forward depth.");
+			}
+		}
+	}
+});
+
+/*
+Forward shading runs in blocks, but fragments still land in the order they were rasterized
+*/
+Test test_a1_deferred_forward_order("a1.deferred.forward_order", []() {
+	using Forward = Pipeline< PrimitiveType::Triangles, Programs::Copy, Pipeline_Blend_Replace | Pipeline_Depth_Always | Pipeline_Interp_Flat >;
+	using FVertex = Forward::Vertex;
+
+	//a 4x4 framebuffer has more samples than a block, so each layer spans several blocks:
+	static SamplePattern const *center = SamplePattern::from_id(1);
+	auto blank_fb = []() {
+		Framebuffer fb(4,4,*center);
+		fb.colors.assign(fb.colors.size(), DeferredBlank);
+		return fb;
+	};
+	auto add_layer = [](std::vector< FVertex > &vertices, Spectrum color) {
+		auto corner = [&](float x, float y) {
+			vertices.emplace_back( FVertex{ std::array< float, 8 >{ x, y, 0.0f, 1.0f,  color.r, color.g, color.b, 1.0f } } );
+		};
+		corner(-0.9f, -0.9f); corner(0.9f, -0.9f); corner(0.9f, 0.9f);
+		corner(-0.9f, -0.9f); corner(0.9f, 0.9f); corner(-0.9f, 0.9f);
+	};
+
+	std::vector< Spectrum > layers = { Spectrum(0.75f, 0.5f, 0.25f), Spectrum(0.1f, 0.2f, 0.4f), Spectrum(0.5f, 0.0f, 1.0f) };
+
+	std::vector< FVertex > all;
+	for (auto const &color : layers) add_layer(all, color);
+	Framebuffer together = blank_fb();
+	Forward::run(all, Programs::Copy::Parameters(), &together);
+
+	//expected: the color of the last layer that covers each sample on its own:
+	std::vector< Spectrum > expected(together.colors.size(), DeferredBlank);
+	for (auto const &color : layers) {
+		std::vector< FVertex > one;
+		add_layer(one, color);
+		Framebuffer alone = blank_fb();
+		Forward::run(one, Programs::Copy::Parameters(), &alone);
+		for (uint32_t i = 0; i < alone.colors.size(); ++i) {
+			if (alone.colors[i] != DeferredBlank) expected[i] = color;
+		}
+	}
+
+	for (uint32_t i = 0; i < together.colors.size(); ++i) {
+		if (together.colors[i] != expected[i]) {
+			throw Test::error("Sample " + std::to_string(i) + " is " + to_string(together.colors[i]) + ", expected " + to_string(expected[i]) + " from the last layer covering it.");
+		}
+	}
+});
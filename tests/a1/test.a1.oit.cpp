@@ -0,0 +1,98 @@
+#include "test.h"
+#include "rasterizer/framebuffer.h"
+#include "rasterizer/sample_pattern.h"
+
+#include <algorithm>
+
+//fragments to composite, given as (color, opacity, depth):
+static std::vector< Framebuffer::OITFragment > const &test_layers() {
+	static std::vector< Framebuffer::OITFragment > layers{
+		{Spectrum(1.0f, 0.0f, 0.0f), 0.5f, 0.25f},
+		{Spectrum(0.0f, 1.0f, 0.0f), 0.25f, 0.75f},
+		{Spectrum(0.0f, 0.0f, 1.0f), 0.75f, 0.5f},
+		{Spectrum(1.0f, 1.0f, 0.0f), 0.5f, 0.125f},
+	};
+	return layers;
+}
+
+static const Spectrum Background(0.2f, 0.2f, 0.2f);
+
+//composites 'layers' (in the given order) into a 2x2 framebuffer, returns resolved color at (1,1):
+static Spectrum composite(std::vector< Framebuffer::OITFragment > const &layers, bool kbuffer) {
+	static SamplePattern const *center = SamplePattern::from_id(1);
+	Framebuffer fb(2, 2, *center);
+	fb.colors.assign(fb.colors.size(), Background);
+
+	fb.clear_oit(kbuffer);
+	for (auto const &f : layers) {
+		if (kbuffer) fb.oit_insert(1, 1, 0, f.color, f.opacity, f.depth);
+		else fb.oit_accumulate(1, 1, 0, f.color, f.opacity, f.depth);
+	}
+	fb.resolve_oit();
+
+	if (fb.color_at(0, 0, 0) != Background) throw Test::error("OIT resolve changed a pixel with no fragments.");
+	return fb.color_at(1, 1, 0);
+}
+
+//reference: sort back-to-front and "over" blend:
+static Spectrum composite_sorted(std::vector< Framebuffer::OITFragment > layers) {
+	std::sort(layers.begin(), layers.end(), [](auto const &a, auto const &b) { return a.depth > b.depth; });
+	Spectrum color = Background;
+	for (auto const &f : layers) {
+		color = f.color * f.opacity + color * (1.0f - f.opacity);
+	}
+	return color;
+}
+
+Test test_a1_oit_weighted_order("a1.oit.weighted.order", []() {
+	std::vector< Framebuffer::OITFragment > layers = test_layers();
+	Spectrum forward = composite(layers, false);
+	std::reverse(layers.begin(), layers.end());
+	Spectrum backward = composite(layers, false);
+	if (Test::differs(forward, backward)) {
+		throw Test::error("Weighted OIT result depends on fragment order: " + to_string(forward) + " vs " + to_string(backward) + ".");
+	}
+	if (!Test::differs(forward, Background)) {
+		throw Test::error("Weighted OIT didn't composite any fragments.");
+	}
+});
+
+Test test_a1_oit_kbuffer_exact("a1.oit.kbuffer.exact", []() {
+	std::vector< Framebuffer::OITFragment > layers = test_layers();
+	static_assert(Framebuffer::KBufferLayers >= 4, "test assumes at least four k-buffer layers");
+	Spectrum expected = composite_sorted(layers);
+	//(next_permutation only visits every order when it starts from the sorted one)
+	auto nearer = [](auto const &a, auto const &b) { return a.depth < b.depth; };
+	std::sort(layers.begin(), layers.end(), nearer);
+	uint32_t orders = 0;
+	do {
+		Spectrum got = composite(layers, true);
+		if (Test::differs(got, expected)) {
+			throw Test::error("K-buffer OIT got " + to_string(got) + ", expected " + to_string(expected) + ".");
+		}
+		++orders;
+	} while (std::next_permutation(layers.begin(), layers.end(), nearer));
+	uint32_t all_orders = 1;
+	for (uint32_t i = 2; i <= layers.size(); ++i) all_orders *= i;
+	if (orders != all_orders) {
+		throw Test::error("Tried " + std::to_string(orders) + " fragment orders, expected " + std::to_string(all_orders) + ".");
+	}
+});
+
+Test test_a1_oit_kbuffer_overflow("a1.oit.kbuffer.overflow", []() {
+	//more layers than fit; nearest layers must still be composited exactly on top:
+	std::vector< Framebuffer::OITFragment > layers;
+	for (uint32_t i = 0; i < Framebuffer::KBufferLayers + 3; ++i) {
+		layers.push_back({Spectrum(0.0f, 0.0f, 1.0f), 0.5f, 0.9f - 0.1f * i});
+	}
+	//nearest fragment is fully opaque red, so the result must be exactly red:
+	layers.back().color = Spectrum(1.0f, 0.0f, 0.0f);
+	layers.back().opacity = 1.0f;
+
+	Spectrum forward = composite(layers, true);
+	std::reverse(layers.begin(), layers.end());
+	Spectrum backward = composite(layers, true);
+	if (Test::differs(forward, Spectrum(1.0f, 0.0f, 0.0f)) || Test::differs(backward, Spectrum(1.0f, 0.0f, 0.0f))) {
+		throw Test::error("K-buffer overflow got " + to_string(forward) + " / " + to_string(backward) + ", expected nearest opaque layer to win.");
+	}
+});
@@ -0,0 +1,90 @@
+#include "test.h"
+
+#include "rasterizer/programs.h"
+
+//image with a distinct color in every texel:
+static HDR_Image texture_block_test_image(uint32_t w, uint32_t h) {
+	HDR_Image image(w, h);
+	for (uint32_t y = 0; y < h; ++y) {
+		for (uint32_t x = 0; x < w; ++x) {
+			image.at(x,y) = Spectrum((x + 0.5f) / w, (y + 0.5f) / h, float(y * w + x));
+		}
+	}
+	return image;
+}
+
+//texture coordinates covering texel centers, texel edges, and out-of-range values:
+static std::vector< Vec2 > texture_block_test_uvs() {
+	std::vector< Vec2 > uvs;
+	for (float v : {-0.5f, 0.0f, 0.1f, 0.5f, 0.99f, 1.0f, 1.5f}) {
+		for (float u : {-0.1f, 0.0f, 0.25f, 0.3f, 0.75f, 1.0f, 2.0f}) {
+			uvs.emplace_back(u, v);
+		}
+	}
+	return uvs;
+}
+
+Test test_a1_texture_block_matches_evaluate("a1.texture_block.matches_evaluate", []() {
+	std::vector< Vec2 > uvs = texture_block_test_uvs();
+	std::vector< float > lods(uvs.size());
+	for (uint32_t i = 0; i < lods.size(); ++i) {
+		lods[i] = 0.25f * (i % 9);
+	}
+
+	for (auto sampler : {Textures::Image::Sampler::nearest, Textures::Image::Sampler::bilinear, Textures::Image::Sampler::trilinear}) {
+		Textures::Image image(sampler, texture_block_test_image(5, 3));
+
+		//evaluate in blocks of every size, including a partial last block:
+		for (uint32_t block = 1; block <= Textures::Image::BlockSize; ++block) {
+			for (uint32_t begin = 0; begin < uvs.size(); begin += block) {
+				uint32_t count = std::min< uint32_t >(block, uint32_t(uvs.size()) - begin);
+				std::array< Spectrum, Textures::Image::BlockSize > out;
+				image.evaluate_block(count, &uvs[begin], &lods[begin], out.data());
+				for (uint32_t i = 0; i < count; ++i) {
+					Spectrum expected = image.evaluate(uvs[begin + i], lods[begin + i]);
+					if (out[i] != expected) {
+						throw Test::error("Block evaluate at uv " + to_string(uvs[begin + i]) + " got " + to_string(out[i]) + ", evaluate got " + to_string(expected) + ".");
+					}
+				}
+			}
+		}
+	}
+});
+
+Test test_a1_texture_block_lambertian("a1.texture_block.lambertian", []() {
+	using P = Programs::Lambertian;
+
+	Textures::Image image(Textures::Image::Sampler::nearest, texture_block_test_image(4, 4));
+
+	P::Parameters parameters;
+	parameters.image = &image;
+	parameters.sun_energy = Spectrum(1.0f, 0.5f, 0.25f);
+	parameters.sun_direction = Vec3(0.0f, 0.0f, 1.0f);
+	parameters.sky_energy = Spectrum(0.25f);
+	parameters.ground_energy = Spectrum(0.125f);
+	parameters.sky_direction = Vec3(0.0f, 1.0f, 0.0f);
+
+	std::vector< Vec2 > uvs = texture_block_test_uvs();
+	uvs.resize(Textures::Image::BlockSize);
+
+	std::array< std::array< float, P::FA >, Textures::Image::BlockSize > fa;
+	std::array< std::array< Vec2, P::FD >, Textures::Image::BlockSize > fd;
+	for (uint32_t i = 0; i < Textures::Image::BlockSize; ++i) {
+		Vec3 normal = Vec3(float(i) - 3.0f, 1.0f, 2.0f);
+		fa[i] = {uvs[i].x, uvs[i].y, normal.x, normal.y, normal.z};
+		fd[i] = {Vec2(0.25f, 0.0f), Vec2(0.0f, 0.25f)};
+	}
+
+	std::array< Spectrum, Textures::Image::BlockSize > colors;
+	std::array< float, Textures::Image::BlockSize > opacities;
+	P::shade_fragment_block(parameters, Textures::Image::BlockSize, fa.data(), fd.data(), colors.data(), opacities.data());
+
+	for (uint32_t i = 0; i < Textures::Image::BlockSize; ++i) {
+		Spectrum color;
+		float opacity;
+		P::shade_fragment(parameters, fa[i], fd[i], &color, &opacity);
+		if (Test::differs(color, colors[i]) || opacity != opacities[i]) {
+			throw Test::error("Block shading of fragment " + std::to_string(i) + " got " + to_string(colors[i]) + ", shade_fragment got " + to_string(color) + ".");
+		}
+	}
+});
@@ -0,0 +1,66 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+#include "geometry/compiled.h"
+#include "geometry/util.h"
+
+/*
+Compiled one-rings and face normals match the Halfedge_Mesh element functions
+*/
+Test test_a2_compiled_matches_mesh("a2.compiled.matches_mesh", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 2));
+	mesh.vertices.front().position += Vec3(0.1f, 0.0f, 0.0f);
+
+	Compiled_Mesh compiled(mesh);
+
+	uint32_t v = 0;
+	for (auto const &vertex : mesh.vertices) {
+		uint32_t r = compiled.ring_begin[v];
+		Halfedge_Mesh::HalfedgeCRef h = vertex.halfedge;
+		do {
+			if (r == compiled.ring_begin[v + 1] || compiled.halfedge_id[compiled.ring_halfedge[r]] != h->id) {
+				throw Test::error("One-ring of vertex " + std::to_string(vertex.id) + " does not match.");
+			}
+			++r;
+			h = h->twin->next;
+		} while (h != vertex.halfedge);
+		++v;
+	}
+
+	std::vector< Vec3 > normals = compiled.face_normals();
+	uint32_t f = 0;
+	for (auto const &face : mesh.faces) {
+		if (normals[f] != face.normal()) {
+			throw Test::error("Normal of face " + std::to_string(face.id) + " does not match.");
+		}
+		++f;
+	}
+});
+
+/*
+Positions written to a compiled mesh can be stored back, but only to a mesh of the same size
+*/
+Test test_a2_compiled_store("a2.compiled.store", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+
+	Compiled_Mesh compiled(mesh);
+	for (uint32_t v = 0; v < compiled.vertices(); ++v) {
+		compiled.x[v] += 1.0f;
+	}
+	compiled.store_positions(mesh);
+
+	uint32_t v = 0;
+	for (auto const &vertex : mesh.vertices) {
+		if (Test::differs(vertex.position, Vec3(compiled.x[v], compiled.y[v], compiled.z[v]))) {
+			throw Test::error("Stored position of vertex " + std::to_string(vertex.id) + " does not match.");
+		}
+		++v;
+	}
+
+	Halfedge_Mesh other = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 1));
+	try {
+		compiled.store_positions(other);
+	} catch (std::runtime_error &) {
+		return;
+	}
+	throw Test::error("Storing positions to a mesh of a different size should throw.");
+});
@@ -0,0 +1,76 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+#include "geometry/util.h"
+
+/*
+Flat mode gives every corner its face's normal
+*/
+Test test_a2_corner_normals_flat("a2.corner_normals.flat", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	mesh.set_corner_normals(0.0f);
+
+	for (auto const &halfedge : mesh.halfedges) {
+		if (halfedge.face->boundary) continue;
+		if (Test::differs(halfedge.corner_normal, halfedge.face->normal())) {
+			throw Test::error("Corner normal of halfedge " + std::to_string(halfedge.id) + " is not its face's normal.");
+		}
+	}
+});
+
+/*
+Smooth mode gives every corner at a vertex the same normal, and auto mode splits it at sharp edges
+*/
+Test test_a2_corner_normals_smooth("a2.corner_normals.smooth", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 2));
+	mesh.set_corner_normals(180.0f);
+
+	for (auto const &vertex : mesh.vertices) {
+		Halfedge_Mesh::HalfedgeCRef h = vertex.halfedge;
+		do {
+			if (Test::differs(h->corner_normal, vertex.halfedge->corner_normal)) {
+				throw Test::error("Corners at vertex " + std::to_string(vertex.id) + " have different normals in smooth mode.");
+			}
+			h = h->twin->next;
+		} while (h != vertex.halfedge);
+	}
+
+	//two sharp edges at one vertex split its corners into two smoothing groups:
+	Halfedge_Mesh::HalfedgeRef out = mesh.halfedges.begin();
+	Halfedge_Mesh::HalfedgeRef next_out = out->twin->next;
+	out->edge->sharp = true;
+	next_out->edge->sharp = true;
+	mesh.set_corner_normals(90.0f);
+
+	//(the corner between the sharp edges is a group of its own, so it gets its face's normal)
+	if (Test::differs(next_out->corner_normal, next_out->face->normal())) {
+		throw Test::error("Corner between two sharp edges does not have its face's normal.");
+	}
+	if (!Test::differs(next_out->corner_normal, out->corner_normal)) {
+		throw Test::error("Corners on either side of a sharp edge share a normal.");
+	}
+});
+
+/*
+Per-face uvs span [0,1] on every face, and boundary corners are cleared
+*/
+Test test_a2_corner_uvs_per_face("a2.corner_uvs.per_face", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_faces({
+		Vec3{-1.0f, 1.0f, 0.0f}, Vec3{ 1.0f, 1.0f, 0.0f},
+		Vec3{-1.0f,-1.0f, 0.0f}, Vec3{ 1.0f,-1.0f, 0.0f}
+	},{
+		{2, 3, 1, 0}
+	});
+	for (auto &halfedge : mesh.halfedges) {
+		halfedge.corner_uv = Vec2(0.5f, 0.5f);
+	}
+	mesh.set_corner_uvs_per_face();
+
+	for (auto const &halfedge : mesh.halfedges) {
+		Vec2 uv = halfedge.corner_uv;
+		if (halfedge.face->boundary) {
+			if (uv != Vec2(0.0f, 0.0f)) throw Test::error("Boundary corner uv was not cleared.");
+		} else if ((uv.x != 0.0f && uv.x != 1.0f) || (uv.y != 0.0f && uv.y != 1.0f)) {
+			throw Test::error("Square corner uv is not at a corner of [0,1]^2.");
+		}
+	}
+});
@@ -0,0 +1,147 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+#include "geometry/util.h"
+
+//do the meshes have the same elements, in the same order, and the same next id?
+static void check_same(Halfedge_Mesh &got, Halfedge_Mesh &expected, std::string const &what) {
+	if (auto diff = Test::differs(got, expected, Test::CheckAllBits)) {
+		throw Test::error(what + ": " + *diff);
+	}
+	auto check_order = [&](auto const &a, auto const &b, std::string const &list) {
+		auto i = a.begin();
+		for (auto const &e : b) {
+			if (i == a.end() || i->id != e.id) {
+				throw Test::error(what + ": " + list + " are in a different order.");
+			}
+			++i;
+		}
+	};
+	check_order(got.vertices, expected.vertices, "vertices");
+	check_order(got.edges, expected.edges, "edges");
+	check_order(got.faces, expected.faces, "faces");
+	check_order(got.halfedges, expected.halfedges, "halfedges");
+
+	if (got.emplace_vertex()->id != expected.emplace_vertex()->id) {
+		throw Test::error(what + ": next id differs.");
+	}
+}
+
+//linear subdivision via catmark_subdivide_helper (linear_subdivide itself is left to students):
+static void linear_subdivide_by_helper(Halfedge_Mesh &mesh) {
+	std::unordered_map< Halfedge_Mesh::VertexCRef, Vec3 > vertex_positions;
+	std::unordered_map< Halfedge_Mesh::EdgeCRef, Vec3 > edge_vertex_positions;
+	std::unordered_map< Halfedge_Mesh::FaceCRef, Vec3 > face_vertex_positions;
+	for (auto v = mesh.vertices.cbegin(); v != mesh.vertices.cend(); ++v) {
+		vertex_positions.emplace(v, v->position);
+	}
+	for (auto e = mesh.edges.cbegin(); e != mesh.edges.cend(); ++e) {
+		edge_vertex_positions.emplace(e, e->center());
+	}
+	for (auto f = mesh.faces.cbegin(); f != mesh.faces.cend(); ++f) {
+		if (!f->boundary) face_vertex_positions.emplace(f, f->center());
+	}
+	mesh.catmark_subdivide_helper(vertex_positions, edge_vertex_positions, face_vertex_positions);
+}
+
+/*
+Deltas turn an edited mesh back into the original and vice versa, ids and list order included
+*/
+Test test_a2_delta_round_trip("a2.delta.round_trip", []() {
+	Halfedge_Mesh original = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 1));
+
+	//an edit with new, erased, changed, and reordered elements:
+	Halfedge_Mesh edited = original.copy();
+	edited.vertices.front().position += Vec3(0.0f, 0.5f, 0.0f);
+	edited.edges.back().sharp = true;
+	edited.vertices.splice(edited.vertices.begin(), edited.vertices, std::prev(edited.vertices.end()));
+	linear_subdivide_by_helper(edited);
+	edited.emplace_vertex()->position = Vec3(2.0f, 0.0f, 0.0f);
+
+	std::optional< Halfedge_Mesh::Delta > undo = Halfedge_Mesh::diff(original, edited);
+	std::optional< Halfedge_Mesh::Delta > redo = Halfedge_Mesh::diff(edited, original);
+	if (!undo || !redo) {
+		throw Test::error("diff failed on meshes with unique ids.");
+	}
+
+	Halfedge_Mesh mesh = edited.copy();
+	mesh.apply(*undo);
+	if (auto msg = mesh.validate()) {
+		throw Test::error("Undone mesh is invalid: " + msg->second);
+	}
+	check_same(mesh, original, "Undo");
+
+	mesh.apply(*redo);
+	check_same(mesh, edited, "Redo");
+});
+
+/*
+A delta for a small edit only holds the elements that changed
+*/
+Test test_a2_delta_small("a2.delta.small", []() {
+	Halfedge_Mesh original = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 3));
+	Halfedge_Mesh edited = original.copy();
+	edited.vertices.front().position += Vec3(0.1f, 0.0f, 0.0f);
+
+	std::optional< Halfedge_Mesh::Delta > undo = Halfedge_Mesh::diff(original, edited);
+	if (!undo) {
+		throw Test::error("diff failed on meshes with unique ids.");
+	}
+	if (undo->vertices.states.size() != 1 || !undo->edges.states.empty()
+	 || !undo->faces.states.empty() || !undo->halfedges.states.empty()) {
+		throw Test::error("Delta for moving one vertex should hold one vertex state.");
+	}
+	if (undo->halfedges.order.size() != 1) {
+		throw Test::error("Unchanged list order should be one step.");
+	}
+
+	edited.apply(*undo);
+	check_same(edited, original, "Undo");
+});
+
+/*
+diff refuses meshes whose links point outside the mesh
+*/
+Test test_a2_delta_unlinked("a2.delta.unlinked", []() {
+	Halfedge_Mesh original = Halfedge_Mesh::cube(1.0f);
+	Halfedge_Mesh edited = original.copy();
+	edited.vertices.front().halfedge = original.halfedges.begin();
+
+	if (Halfedge_Mesh::diff(original, edited)) {
+		throw Test::error("diff should fail when a link points into another mesh.");
+	}
+});
+
+/*
+Diffing the mesh a delta replaced gives the delta back the other way (as undo/redo steps do),
+and applying a delta to a mesh it wasn't made from throws, so the caller can put its copy back
+*/
+Test test_a2_delta_step("a2.delta.step", []() {
+	Halfedge_Mesh original = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 1));
+	Halfedge_Mesh edited = original.copy();
+	linear_subdivide_by_helper(edited);
+
+	std::optional< Halfedge_Mesh::Delta > delta = Halfedge_Mesh::diff(original, edited);
+	if (!delta) throw Test::error("diff failed on meshes with unique ids.");
+
+	Halfedge_Mesh mesh = edited.copy();
+	for (uint32_t step = 0; step < 4; ++step) {
+		Halfedge_Mesh before = mesh.copy();
+		mesh.apply(*delta);
+		//(check_same adds a vertex, so compare without it until the end)
+		if (auto diff = Test::differs(mesh, step % 2 == 0 ? original : edited, Test::CheckAllBits)) {
+			throw Test::error("Step " + std::to_string(step) + ": " + *diff);
+		}
+		delta = Halfedge_Mesh::diff(before, mesh);
+		if (!delta) throw Test::error("diff failed after applying a delta.");
+	}
+	check_same(mesh, edited, "Undo, redo, undo, redo");
+
+	Halfedge_Mesh other = Halfedge_Mesh::cube(1.0f);
+	bool threw = false;
+	try {
+		other.apply(*delta);
+	} catch (std::runtime_error &) {
+		threw = true;
+	}
+	if (!threw) throw Test::error("Applying a delta to the wrong mesh didn't throw.");
+});
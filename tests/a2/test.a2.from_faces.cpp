@@ -0,0 +1,68 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+
+//run from_indexed_faces, expecting it to throw a std::runtime_error whose message mentions 'expected':
+static void from_faces_expect_error(std::string const &what, std::vector< Vec3 > const &positions,
+                                    std::vector< std::vector< Halfedge_Mesh::Index > > const &faces,
+                                    std::string const &expected) {
+	try {
+		Halfedge_Mesh::from_indexed_faces(positions, faces);
+	} catch (std::runtime_error &e) {
+		if (std::string(e.what()).find(expected) == std::string::npos) {
+			throw Test::error(what + ": threw '" + e.what() + "', which doesn't mention '" + expected + "'.");
+		}
+		return;
+	}
+	throw Test::error(what + ": did not throw.");
+}
+
+//a square's corners and center:
+static std::vector< Vec3 > from_faces_test_positions() {
+	return {
+		Vec3(0.0f, 0.0f, 0.0f), Vec3(1.0f, 0.0f, 0.0f), Vec3(1.0f, 1.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f),
+		Vec3(0.5f, 0.5f, 1.0f)
+	};
+}
+
+/*
+Faces that mention a vertex that doesn't exist, or have fewer than three vertices, are refused
+*/
+Test test_a2_from_faces_bad_index("a2.from_faces.bad_index", []() {
+	std::vector< Vec3 > positions = from_faces_test_positions();
+	from_faces_expect_error("Out-of-range index", positions, {{0, 1, 2}, {0, 2, 7}}, "references vertex 7");
+	from_faces_expect_error("Two-vertex face", positions, {{0, 1, 2}, {0, 2}}, "(< 3) vertices");
+});
+
+/*
+Neighboring faces that run their shared edge in the same direction are refused
+*/
+Test test_a2_from_faces_inconsistent_winding("a2.from_faces.inconsistent_winding", []() {
+	std::vector< Vec3 > positions = from_faces_test_positions();
+	//(the second triangle is flipped, so both go from vertex 2 to vertex 0)
+	from_faces_expect_error("Flipped neighbor", positions, {{0, 1, 2}, {0, 3, 2}}, "same direction");
+
+	//...and the consistently wound version builds: (without the unused center vertex, which validate() refuses)
+	positions.pop_back();
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_faces(positions, {{0, 1, 2}, {0, 2, 3}});
+	if (auto msg = mesh.validate()) {
+		throw Test::error("Consistently wound faces gave an invalid mesh: " + msg->second);
+	}
+});
+
+/*
+Edges shared by more than two faces, and vertices where two boundaries meet, are refused
+*/
+Test test_a2_from_faces_non_manifold("a2.from_faces.non_manifold", []() {
+	std::vector< Vec3 > positions = from_faces_test_positions();
+	positions.emplace_back(0.5f, 0.5f, -1.0f);
+
+	//three faces on the edge between vertices 0 and 1 (as a fin):
+	from_faces_expect_error("Fin", positions, {{0, 1, 4}, {1, 0, 5}, {1, 0, 2}}, "(> 2) faces");
+
+	//two triangles that only touch at vertex 0 (a bowtie):
+	std::vector< Vec3 > bowtie = {
+		Vec3(0.0f, 0.0f, 0.0f), Vec3(1.0f, 0.0f, 0.0f), Vec3(1.0f, 1.0f, 0.0f),
+		Vec3(-1.0f, 0.0f, 0.0f), Vec3(-1.0f, -1.0f, 0.0f)
+	};
+	from_faces_expect_error("Bowtie", bowtie, {{0, 1, 2}, {0, 3, 4}}, "on the boundary more than once");
+});
@@ -0,0 +1,54 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+
+/*
+A handle resolves until its element is erased, and stays stale when the node is recycled for a new element
+*/
+Test test_a2_handle_generation("a2.handle.generation", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	Halfedge_Mesh::VertexRef v = mesh.emplace_vertex();
+	Halfedge_Mesh::Handle< Halfedge_Mesh::VertexRef > handle = Halfedge_Mesh::handle(v);
+
+	if (mesh.resolve(handle) != v) {
+		throw Test::error("Handle to a fresh vertex doesn't resolve to it.");
+	}
+
+	mesh.erase_vertex(v);
+	if (mesh.resolve(handle)) {
+		throw Test::error("Handle to an erased vertex still resolves.");
+	}
+
+	//the erased vertex's node is recycled, so the handle's reference points at the new vertex:
+	Halfedge_Mesh::VertexRef recycled = mesh.emplace_vertex();
+	if (recycled != v) {
+		throw Test::error("Test expects emplace_vertex to recycle the erased vertex's node.");
+	}
+	if (mesh.resolve(handle)) {
+		throw Test::error("Handle resolves to a different vertex that reuses its node.");
+	}
+	if (mesh.resolve(Halfedge_Mesh::handle(recycled)) != recycled) {
+		throw Test::error("Handle to the recycled vertex doesn't resolve to it.");
+	}
+});
+
+/*
+Handles into another mesh never resolve, even when that mesh has an element with the same id
+*/
+Test test_a2_handle_other_mesh("a2.handle.other_mesh", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	Halfedge_Mesh copy = mesh.copy();
+
+	auto handle = Halfedge_Mesh::handle(copy.faces.begin());
+	if (mesh.resolve(handle)) {
+		throw Test::error("Handle into a copy resolves in the original.");
+	}
+	if (copy.resolve(handle) != copy.faces.begin()) {
+		throw Test::error("Handle doesn't resolve in its own mesh.");
+	}
+
+	//moving a mesh keeps its elements (and arena), so handles follow:
+	Halfedge_Mesh moved = std::move(copy);
+	if (moved.resolve(handle) != moved.faces.begin()) {
+		throw Test::error("Handle doesn't resolve after its mesh was moved.");
+	}
+});
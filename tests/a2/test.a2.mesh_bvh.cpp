@@ -0,0 +1,142 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+#include "geometry/mesh_bvh.h"
+#include "geometry/util.h"
+
+#include <algorithm>
+
+//ids of vertices, sorted (so results can be compared regardless of order):
+static std::vector< uint32_t > ids_of(std::vector< Halfedge_Mesh::VertexCRef > const &vertices) {
+	std::vector< uint32_t > ids;
+	for (auto v : vertices) {
+		ids.emplace_back(v->id);
+	}
+	std::sort(ids.begin(), ids.end());
+	return ids;
+}
+
+/*
+Closest points and ray hits on a cube land where they should
+*/
+Test test_a2_mesh_bvh_cube("a2.mesh_bvh.cube", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	Mesh_BVH bvh(mesh);
+
+	auto side = bvh.closest_point(Vec3(2.0f, 0.1f, 0.2f));
+	if (!side || Test::differs(side->point, Vec3(1.0f, 0.1f, 0.2f)) || Test::differs(side->distance, 1.0f)) {
+		throw Test::error("Closest point to a point beside the cube is wrong.");
+	}
+	auto corner = bvh.closest_point(Vec3(2.0f, 2.0f, 2.0f));
+	if (!corner || Test::differs(corner->point, Vec3(1.0f, 1.0f, 1.0f))) {
+		throw Test::error("Closest point to a point past a corner is wrong.");
+	}
+	if (bvh.closest_point(Vec3(3.0f, 0.0f, 0.0f), 1.0f)) {
+		throw Test::error("Closest point should respect max_distance.");
+	}
+
+	auto hit = bvh.hit(Ray(Vec3(0.2f, 0.3f, 5.0f), Vec3(0.0f, 0.0f, -1.0f)));
+	if (!hit || Test::differs(hit->distance, 4.0f) || Test::differs(hit->point, Vec3(0.2f, 0.3f, 1.0f))) {
+		throw Test::error("Ray should hit the top of the cube at distance 4.");
+	}
+	if (bvh.hit(Ray(Vec3(2.0f, 0.0f, 5.0f), Vec3(0.0f, 0.0f, -1.0f)))) {
+		throw Test::error("Ray beside the cube should miss.");
+	}
+});
+
+/*
+Radius and segment queries find the same vertices as checking every vertex
+*/
+Test test_a2_mesh_bvh_vertices("a2.mesh_bvh.vertices", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 3));
+	Mesh_BVH bvh(mesh);
+
+	for (Vec3 p : {Vec3(1.0f, 0.0f, 0.0f), Vec3(0.3f, -0.8f, 0.5f), Vec3(0.0f, 0.0f, 0.0f)}) {
+		float radius = 0.4f;
+		std::vector< Halfedge_Mesh::VertexCRef > expected;
+		for (auto v = mesh.vertices.cbegin(); v != mesh.vertices.cend(); ++v) {
+			if ((v->position - p).norm() <= radius) expected.emplace_back(v);
+		}
+		if (ids_of(bvh.vertices_within(p, radius)) != ids_of(expected)) {
+			throw Test::error("vertices_within found different vertices than a linear search.");
+		}
+	}
+
+	Vec3 a(-1.0f, 0.0f, 0.0f), b(1.0f, 0.2f, 0.0f);
+	float radius = 0.3f;
+	std::vector< Halfedge_Mesh::VertexCRef > expected;
+	for (auto v = mesh.vertices.cbegin(); v != mesh.vertices.cend(); ++v) {
+		Vec3 ab = b - a;
+		float t = std::clamp(dot(v->position - a, ab) / ab.norm_squared(), 0.0f, 1.0f);
+		if ((a + ab * t - v->position).norm() <= radius) expected.emplace_back(v);
+	}
+	if (expected.empty() || ids_of(bvh.vertices_near_segment(a, b, radius)) != ids_of(expected)) {
+		throw Test::error("vertices_near_segment found different vertices than a linear search.");
+	}
+});
+
+/*
+update() follows moved, added, and erased elements
+*/
+Test test_a2_mesh_bvh_update("a2.mesh_bvh.update", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	Mesh_BVH bvh(mesh);
+
+	Halfedge_Mesh::VertexRef moved = mesh.vertices.begin();
+	moved->position = Vec3(-3.0f, -3.0f, -3.0f);
+	bvh.update(mesh, {Halfedge_Mesh::VertexCRef(moved)});
+
+	if (ids_of(bvh.vertices_within(moved->position, 0.1f)) != std::vector< uint32_t >{moved->id}) {
+		throw Test::error("Moved vertex not found at its new position.");
+	}
+	auto near = bvh.closest_point(Vec3(-3.0f, -3.0f, -3.1f));
+	if (!near || Test::differs(near->distance, 0.1f)) {
+		throw Test::error("Faces around the moved vertex weren't refit.");
+	}
+
+	Halfedge_Mesh::VertexRef added = mesh.emplace_vertex();
+	added->position = Vec3(5.0f, 0.0f, 0.0f);
+	bvh.update(mesh, {Halfedge_Mesh::VertexCRef(added)});
+	if (ids_of(bvh.vertices_within(added->position, 0.1f)) != std::vector< uint32_t >{added->id}) {
+		throw Test::error("Added vertex not found.");
+	}
+
+	mesh.erase_vertex(added);
+	if (!bvh.vertices_within(Vec3(5.0f, 0.0f, 0.0f), 0.1f).empty()) {
+		throw Test::error("Erased vertex still found.");
+	}
+});
+
+/*
+refit() follows moved vertices in place, and rebuilds for added elements or a replaced mesh
+*/
+Test test_a2_mesh_bvh_refit("a2.mesh_bvh.refit", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	Mesh_BVH bvh(mesh);
+
+	for (auto &v : mesh.vertices) {
+		v.position += Vec3(0.0f, 0.0f, 3.0f);
+	}
+	bvh.refit(mesh);
+	auto hit = bvh.hit(Ray(Vec3(0.2f, 0.3f, 10.0f), Vec3(0.0f, 0.0f, -1.0f)));
+	if (!hit || Test::differs(hit->point, Vec3(0.2f, 0.3f, 4.0f))) {
+		throw Test::error("Ray should hit the top of the moved cube.");
+	}
+
+	Halfedge_Mesh::VertexRef added = mesh.emplace_vertex();
+	added->position = Vec3(5.0f, 0.0f, 0.0f);
+	bvh.refit(mesh);
+	if (ids_of(bvh.vertices_within(added->position, 0.1f)) != std::vector< uint32_t >{added->id}) {
+		throw Test::error("Added vertex not found after refit.");
+	}
+
+	//(the old elements are gone; refit must notice without trusting them)
+	mesh = Halfedge_Mesh::cube(2.0f);
+	bvh.refit(mesh);
+	hit = bvh.hit(Ray(Vec3(0.2f, 0.3f, 10.0f), Vec3(0.0f, 0.0f, -1.0f)));
+	if (!hit || Test::differs(hit->point, Vec3(0.2f, 0.3f, 2.0f))) {
+		throw Test::error("Ray should hit the top of the replacement cube.");
+	}
+	if (bvh.vertices_within(Vec3(5.0f, 0.0f, 0.0f), 0.1f).size() != 0) {
+		throw Test::error("Vertex of the replaced mesh still found.");
+	}
+});
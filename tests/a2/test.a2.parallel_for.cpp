@@ -0,0 +1,33 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+
+#include <atomic>
+
+/*
+parallel_for covers every index exactly once, including when called from inside another parallel_for
+*/
+Test test_a2_parallel_for_nested("a2.parallel_for.nested", []() {
+	constexpr uint32_t Outer = 64 * 1024;
+	constexpr uint32_t Inner = 16 * 1024;
+	std::vector< std::atomic< uint32_t > > visits(Outer);
+	std::atomic< uint64_t > inner_total = 0;
+
+	Halfedge_Mesh::parallel_for(Outer, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			visits[i] += 1;
+		}
+		//would deadlock if this waited on the pool the outer call is running on:
+		Halfedge_Mesh::parallel_for(Inner, [&](uint32_t inner_begin, uint32_t inner_end) {
+			inner_total += inner_end - inner_begin;
+		});
+	});
+
+	for (uint32_t i = 0; i < Outer; ++i) {
+		if (visits[i] != 1) {
+			throw Test::error("Index " + std::to_string(i) + " visited " + std::to_string(visits[i]) + " times.");
+		}
+	}
+	if (inner_total % Inner != 0 || inner_total == 0) {
+		throw Test::error("Nested parallel_for didn't cover its range.");
+	}
+});
@@ -0,0 +1,159 @@
+#include "test.h"
+#include "geometry/simplify.h"
+#include "util/rand.h"
+
+#include <map>
+
+namespace {
+struct Keyed {
+	float key;
+	uint32_t id;
+	bool operator<(Keyed const &o) const {
+		if (key != o.key) return key < o.key;
+		return id < o.id;
+	}
+};
+uint32_t queue_index(Keyed const &k) {
+	return k.id;
+}
+} // namespace
+
+/*
+Items pop smallest-first, and re-inserting under an index moves its item up or down the queue
+*/
+Test test_a2_priority_queue_update_key("a2.priority_queue.update_key", []() {
+	MutablePriorityQueue< Keyed > queue;
+	for (uint32_t i = 0; i < 10; ++i) {
+		queue.insert(Keyed{float(i), i});
+	}
+
+	queue.insert(Keyed{-1.0f, 7}); //decrease
+	queue.insert(Keyed{20.0f, 0}); //increase
+	queue.remove(Keyed{0.0f, 3}); //(removal only looks at the index)
+
+	if (queue.size() != 9) {
+		throw Test::error("Queue has " + std::to_string(queue.size()) + " items, expected 9.");
+	}
+	if (queue.contains(3) || !queue.contains(7)) {
+		throw Test::error("Queue contains the wrong indices.");
+	}
+
+	std::vector< uint32_t > expected = {7, 1, 2, 4, 5, 6, 8, 9, 0};
+	std::vector< uint32_t > popped;
+	while (!queue.empty()) {
+		if (queue.top().id != queue.top_index()) throw Test::error("Top item is filed under the wrong index.");
+		popped.emplace_back(queue.top_index());
+		queue.pop();
+	}
+	if (popped != expected) {
+		std::string got;
+		for (uint32_t i : popped) got += " " + std::to_string(i);
+		throw Test::error("Popped indices in order" + got + ".");
+	}
+});
+
+/*
+A random mix of inserts, re-inserts, removes, and pops matches a std::map of the same items
+*/
+Test test_a2_priority_queue_pop_order("a2.priority_queue.pop_order", []() {
+	RNG rng(0x5eed);
+	MutablePriorityQueue< Keyed > queue;
+	std::map< uint32_t, float > reference;
+
+	auto reference_top = [&]() {
+		auto best = reference.begin();
+		for (auto it = reference.begin(); it != reference.end(); ++it) {
+			if (Keyed{it->second, it->first} < Keyed{best->second, best->first}) best = it;
+		}
+		return best;
+	};
+
+	for (uint32_t step = 0; step < 20000; ++step) {
+		uint32_t op = rng.integer(0, 4);
+		uint32_t id = rng.integer(0, 200);
+		if (op <= 1) {
+			float key = float(rng.integer(0, 50));
+			queue.insert(Keyed{key, id});
+			reference[id] = key;
+		} else if (op == 2) {
+			queue.remove(id);
+			reference.erase(id);
+		} else if (!reference.empty()) {
+			auto best = reference_top();
+			if (queue.top_index() != best->first || queue.top().key != best->second) {
+				throw Test::error("Step " + std::to_string(step) + ": top is " + std::to_string(queue.top_index()) + ", expected " + std::to_string(best->first) + ".");
+			}
+			queue.pop();
+			reference.erase(best);
+		}
+		if (queue.size() != reference.size()) {
+			throw Test::error("Step " + std::to_string(step) + ": queue has " + std::to_string(queue.size()) + " items, expected " + std::to_string(reference.size()) + ".");
+		}
+	}
+});
+
+/*
+A plane's quadric measures squared distance to the plane, sums add, and to_mat4 agrees with error
+*/
+Test test_a2_quadric_error("a2.quadric.error", []() {
+	Quadric ground = Quadric::from_plane(Vec4(0.0f, 1.0f, 0.0f, 0.0f)); //y = 0
+	Quadric wall = Quadric::from_plane(Vec4(1.0f, 0.0f, 0.0f, -2.0f)); //x = 2
+
+	Vec3 p(3.0f, 0.5f, -4.0f);
+	if (Test::differs(ground.error(p), 0.25f) || Test::differs(wall.error(p), 1.0f)) {
+		throw Test::error("Plane quadrics don't measure squared distance.");
+	}
+
+	Quadric sum = ground;
+	sum += wall;
+	if (Test::differs(sum.error(p), 1.25f) || Test::differs((ground + wall).error(p), 1.25f)) {
+		throw Test::error("Sum of quadrics doesn't sum errors.");
+	}
+
+	Vec4 h(p, 1.0f);
+	Mat4 m = sum.to_mat4();
+	if (Test::differs(dot(h, m * h), sum.error(p))) {
+		throw Test::error("to_mat4() disagrees with error().");
+	}
+	if (m != m.T()) {
+		throw Test::error("to_mat4() isn't symmetric.");
+	}
+});
+
+/*
+Id_Map acts like a map, and references to its values survive adding and erasing other ids
+*/
+Test test_a2_id_map_stable("a2.id_map.stable", []() {
+	Id_Map< Quadric > map;
+	Quadric &kept = map[5];
+	kept.q[0] = 1.0f;
+
+	for (uint32_t id = 10; id < 10000; ++id) {
+		map[id].q[0] = float(id);
+	}
+	for (uint32_t id = 10; id < 10000; id += 2) {
+		map.erase(id);
+	}
+	map[3].q[0] = 3.0f; //(re-uses an erased value)
+
+	if (&kept != &map.at(5) || kept.q[0] != 1.0f) {
+		throw Test::error("Reference to a value was invalidated by other ids.");
+	}
+	if (map.size() != 2 + 9990 / 2) {
+		throw Test::error("Map has " + std::to_string(map.size()) + " values.");
+	}
+	if (map.count(10) || !map.count(11) || map.at(11).q[0] != 11.0f) {
+		throw Test::error("Map has the wrong values after erase.");
+	}
+	if (map.at(3).q[1] != 0.0f) {
+		throw Test::error("Re-used value didn't start out default.");
+	}
+
+	bool threw = false;
+	try {
+		map.at(10);
+	} catch (std::out_of_range &) {
+		threw = true;
+	}
+	if (!threw) throw Test::error("at() of an erased id didn't throw.");
+});
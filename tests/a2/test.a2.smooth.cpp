@@ -0,0 +1,94 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+#include "geometry/util.h"
+
+//n x n grid of vertices in the z = 0 plane, as (n-1) x (n-1) quads:
+static Halfedge_Mesh smooth_test_grid(uint32_t n) {
+	std::vector< Vec3 > positions;
+	for (uint32_t y = 0; y < n; ++y) {
+		for (uint32_t x = 0; x < n; ++x) {
+			positions.emplace_back(float(x), float(y), 0.0f);
+		}
+	}
+	std::vector< std::vector< Halfedge_Mesh::Index > > faces;
+	for (uint32_t y = 0; y + 1 < n; ++y) {
+		for (uint32_t x = 0; x + 1 < n; ++x) {
+			faces.emplace_back(std::vector< Halfedge_Mesh::Index >{ y*n+x, y*n+x+1, (y+1)*n+x+1, (y+1)*n+x });
+		}
+	}
+	return Halfedge_Mesh::from_indexed_faces(positions, faces);
+}
+
+/*
+Vertices only move within their tangent planes: a flat mesh stays flat, and the apex of a symmetric cone stays put
+*/
+Test test_a2_smooth_tangential("a2.smooth.tangential", []() {
+	Halfedge_Mesh flat = smooth_test_grid(4);
+	//nudge an interior vertex within the plane:
+	Halfedge_Mesh::VertexRef nudged = std::next(flat.vertices.begin(), 5);
+	nudged->position += Vec3(0.3f, 0.2f, 0.0f);
+	Vec3 before = nudged->position;
+
+	flat.smooth_tangentially(0.5f, 3);
+	for (auto const &v : flat.vertices) {
+		if (v.position.z != 0.0f) {
+			throw Test::error("Vertex " + std::to_string(v.id) + " left the plane: " + to_string(v.position) + ".");
+		}
+	}
+	if ((nudged->position - Vec3(1.0f, 1.0f, 0.0f)).norm() >= (before - Vec3(1.0f, 1.0f, 0.0f)).norm()) {
+		throw Test::error("Nudged vertex did not move back toward its neighbors.");
+	}
+
+	//the apex's neighborhood center is straight below it, so the whole move is along the normal:
+	Halfedge_Mesh cone = smooth_test_grid(3);
+	Halfedge_Mesh::VertexRef apex = std::next(cone.vertices.begin(), 4);
+	apex->position.z = 1.0f;
+	cone.smooth_tangentially(1.0f, 1);
+	if (Test::differs(apex->position, Vec3(1.0f, 1.0f, 1.0f))) {
+		throw Test::error("Cone apex moved to " + to_string(apex->position) + ", along its normal.");
+	}
+});
+
+/*
+With preserve_features, vertices on boundary or sharp edges stay pinned and the rest still move
+*/
+Test test_a2_smooth_preserve_features("a2.smooth.preserve_features", []() {
+	Halfedge_Mesh grid = smooth_test_grid(5);
+	for (auto &v : grid.vertices) {
+		v.position.x += 0.1f * v.position.y * v.position.y;
+	}
+	Halfedge_Mesh original = grid.copy();
+
+	grid.smooth_tangentially(0.5f, 4, true);
+	uint32_t moved = 0;
+	auto o = original.vertices.begin();
+	for (auto v = grid.vertices.begin(); v != grid.vertices.end(); ++v, ++o) {
+		if (v->on_boundary()) {
+			if (v->position != o->position) {
+				throw Test::error("Boundary vertex " + std::to_string(v->id) + " moved.");
+			}
+		} else if (v->position != o->position) {
+			++moved;
+		}
+	}
+	if (moved == 0) throw Test::error("No interior vertex moved.");
+
+	Halfedge_Mesh sphere = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 2));
+	for (auto &v : sphere.vertices) {
+		v.position.y *= 1.5f; //(so vertices aren't already at their neighborhood centers)
+	}
+	Halfedge_Mesh::EdgeRef sharp = sphere.edges.begin();
+	sharp->sharp = true;
+	Vec3 a = sharp->halfedge->vertex->position;
+	Vec3 b = sharp->halfedge->twin->vertex->position;
+	Halfedge_Mesh::VertexRef other = sharp->halfedge->next->next->vertex;
+	Vec3 c = other->position;
+
+	sphere.smooth_tangentially(0.5f, 2, true);
+	if (sharp->halfedge->vertex->position != a || sharp->halfedge->twin->vertex->position != b) {
+		throw Test::error("Vertex on a sharp edge moved.");
+	}
+	if (other->position == c) {
+		throw Test::error("Vertex off the sharp edge did not move.");
+	}
+});
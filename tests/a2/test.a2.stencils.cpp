@@ -0,0 +1,122 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+#include "geometry/subdivision.h"
+
+#include <algorithm>
+
+static std::vector< Vec3 > positions_of(Halfedge_Mesh const &mesh) {
+	std::vector< Vec3 > positions;
+	for (auto const &v : mesh.vertices) {
+		positions.emplace_back(v.position);
+	}
+	return positions;
+}
+
+//does every position in 'a' have a matching position in 'b' (and vice versa)?
+// (vertex order may differ between the two)
+static bool same_positions(std::vector< Vec3 > const &a, std::vector< Vec3 > b) {
+	if (a.size() != b.size()) return false;
+	for (Vec3 const &p : a) {
+		auto match = std::find_if(b.begin(), b.end(), [&](Vec3 const &q) { return !Test::differs(p, q); });
+		if (match == b.end()) return false;
+		b.erase(match);
+	}
+	return true;
+}
+
+//linear subdivision via catmark_subdivide_helper (linear_subdivide itself is left to students):
+static void linear_subdivide_by_helper(Halfedge_Mesh &mesh) {
+	std::unordered_map< Halfedge_Mesh::VertexCRef, Vec3 > vertex_positions;
+	std::unordered_map< Halfedge_Mesh::EdgeCRef, Vec3 > edge_vertex_positions;
+	std::unordered_map< Halfedge_Mesh::FaceCRef, Vec3 > face_vertex_positions;
+	for (auto v = mesh.vertices.cbegin(); v != mesh.vertices.cend(); ++v) {
+		vertex_positions.emplace(v, v->position);
+	}
+	for (auto e = mesh.edges.cbegin(); e != mesh.edges.cend(); ++e) {
+		edge_vertex_positions.emplace(e, e->center());
+	}
+	for (auto f = mesh.faces.cbegin(); f != mesh.faces.cend(); ++f) {
+		if (!f->boundary) face_vertex_positions.emplace(f, f->center());
+	}
+	mesh.catmark_subdivide_helper(vertex_positions, edge_vertex_positions, face_vertex_positions);
+}
+
+/*
+Catmull-Clark stencils on a square match the expected subdivision
+*/
+Test test_a2_stencils_catmark_square("a2.stencils.catmark.square", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_faces({
+		Vec3{-1.0f, 1.0f, 0.0f}, Vec3{ 1.0f, 1.0f, 0.0f},
+		Vec3{-1.0f,-1.0f, 0.0f}, Vec3{ 1.0f,-1.0f, 0.0f}
+	},{
+		{2, 3, 1, 0}
+	});
+
+	Subdivision_Stencils stencils(mesh, 1, Subdivision_Stencils::Catmark);
+	std::vector< Vec3 > refined = stencils.refine_positions(positions_of(mesh));
+
+	std::vector< Vec3 > expected = {
+		Vec3{-0.75f, 0.75f, 0.0f}, Vec3{ 0.75f, 0.75f, 0.0f},
+		Vec3{-0.75f,-0.75f, 0.0f}, Vec3{ 0.75f,-0.75f, 0.0f},
+		Vec3{ 0.0f,-1.0f, 0.0f}, Vec3{ 1.0f, 0.0f, 0.0f},
+		Vec3{ 0.0f, 1.0f, 0.0f}, Vec3{-1.0f, 0.0f, 0.0f},
+		Vec3{ 0.0f, 0.0f, 0.0f}
+	};
+	if (Test::differs(refined, expected)) {
+		throw Test::error("Refined positions do not match expected.");
+	}
+
+	Indexed_Mesh refined_mesh = stencils.refine(positions_of(mesh));
+	if (refined_mesh.tris() != 8) {
+		throw Test::error("Refined mesh should have 8 triangles, has " + std::to_string(refined_mesh.tris()) + ".");
+	}
+});
+
+/*
+Two levels of linear stencils place vertices where catmark_subdivide_helper does
+*/
+Test test_a2_stencils_linear_matches_helper("a2.stencils.linear.matches_helper", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_faces({
+		Vec3{0.0f, 0.0f, 0.0f}, Vec3{1.0f, 0.0f, 0.0f}, Vec3{1.0f, 1.0f, 0.0f},
+		Vec3{0.0f, 1.0f, 0.0f}, Vec3{2.0f, 0.0f, 0.5f}, Vec3{2.0f, 1.0f, 1.0f}
+	},{
+		{0, 1, 2, 3}, {1, 4, 5, 2}, {3, 2, 5}
+	});
+
+	Subdivision_Stencils stencils(mesh, 2, Subdivision_Stencils::Linear);
+	std::vector< Vec3 > refined = stencils.refine_positions(positions_of(mesh));
+
+	for (uint32_t level = 0; level < 2; ++level) {
+		linear_subdivide_by_helper(mesh);
+	}
+	std::vector< Vec3 > expected = positions_of(mesh);
+
+	if (!same_positions(refined, expected)) {
+		throw Test::error("Refined positions do not match subdivided mesh.");
+	}
+});
+
+/*
+Stencils notice when the cage's connectivity changes
+*/
+Test test_a2_stencils_matches("a2.stencils.matches", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	Subdivision_Stencils stencils(mesh, 1);
+
+	if (!stencils.matches(mesh)) {
+		throw Test::error("Stencils don't match the cage they were built from.");
+	}
+	if (!stencils.matches(mesh.copy())) {
+		throw Test::error("Stencils don't match a copy of the cage they were built from.");
+	}
+
+	mesh.vertices.front().position += Vec3(1.0f, 0.0f, 0.0f);
+	if (!stencils.matches(mesh)) {
+		throw Test::error("Stencils should still match a cage whose vertices moved.");
+	}
+
+	mesh.flip_orientation();
+	if (stencils.matches(mesh)) {
+		throw Test::error("Stencils should not match a cage with different connectivity.");
+	}
+});
@@ -0,0 +1,94 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+#include "geometry/util.h"
+
+/*
+Full and local validation both accept a valid mesh
+*/
+Test test_a2_validate_valid("a2.validate.valid", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 2));
+
+	if (auto msg = mesh.validate()) {
+		throw Test::error("Valid mesh failed validate: " + msg->second);
+	}
+	for (auto e = mesh.edges.begin(); e != mesh.edges.end(); ++e) {
+		if (auto msg = mesh.validate_local({Halfedge_Mesh::EdgeCRef(e)})) {
+			throw Test::error("Valid mesh failed validate_local: " + msg->second);
+		}
+	}
+});
+
+/*
+A broken next pointer is caught by validate and by validate_local near it
+*/
+Test test_a2_validate_broken_next("a2.validate.broken_next", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+
+	Halfedge_Mesh::HalfedgeRef h = mesh.halfedges.begin();
+	h->next = h->next->next;
+
+	if (!mesh.validate()) {
+		throw Test::error("validate missed a broken next pointer.");
+	}
+	if (!mesh.validate_local({Halfedge_Mesh::VertexCRef(h->vertex)})) {
+		throw Test::error("validate_local missed a broken next pointer.");
+	}
+});
+
+/*
+validate_local notices references to erased elements
+*/
+Test test_a2_validate_local_erased("a2.validate.local_erased", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_faces({
+		Vec3{-1.0f, 1.0f, 0.0f}, Vec3{ 1.0f, 1.0f, 0.0f},
+		Vec3{-1.0f,-1.0f, 0.0f}, Vec3{ 1.0f,-1.0f, 0.0f}
+	},{
+		{2, 3, 1, 0}
+	});
+
+	Halfedge_Mesh::EdgeRef e = mesh.edges.begin();
+	Halfedge_Mesh::FaceRef f = e->halfedge->face;
+	mesh.erase_edge(e);
+
+	auto msg = mesh.validate_local({Halfedge_Mesh::FaceCRef(f)});
+	if (!msg) {
+		throw Test::error("validate_local missed a reference to an erased edge.");
+	}
+	if (msg->second.find("erased edge") == std::string::npos) {
+		throw Test::error("validate_local reported '" + msg->second + "' instead of the erased edge.");
+	}
+});
+
+/*
+References into a mesh that no longer exists are reported, not followed
+*/
+Test test_a2_validate_other_mesh("a2.validate.other_mesh", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	Halfedge_Mesh::VertexRef v = mesh.vertices.begin();
+	{
+		Halfedge_Mesh other = Halfedge_Mesh::cube(1.0f);
+		v->halfedge = other.halfedges.begin();
+	}
+
+	auto msg = mesh.validate();
+	if (!msg || msg->second.find("out-of-mesh halfedge") == std::string::npos) {
+		throw Test::error("validate didn't report a reference into a destroyed mesh.");
+	}
+	auto local = mesh.validate_local({Halfedge_Mesh::VertexCRef(v)});
+	if (!local || local->second.find("out-of-mesh halfedge") == std::string::npos) {
+		throw Test::error("validate_local didn't report a reference into a destroyed mesh.");
+	}
+});
+
+/*
+An element left in the mesh but disconnected from it (e.g., an edge an operation forgot to erase) fails validate
+*/
+Test test_a2_validate_disconnected("a2.validate.disconnected", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	Halfedge_Mesh::EdgeRef stray = mesh.emplace_edge();
+	stray->halfedge = mesh.halfedges.begin();
+
+	if (!mesh.validate()) {
+		throw Test::error("validate missed an edge that no halfedge references.");
+	}
+});
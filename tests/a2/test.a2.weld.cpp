@@ -0,0 +1,87 @@
+#include "test.h"
+#include "geometry/halfedge.h"
+#include "geometry/indexed.h"
+#include "geometry/util.h"
+
+#include <algorithm>
+#include <array>
+
+//every triangle of an indexed mesh, as the corner data it references (sorted, so triangle order doesn't matter):
+static std::vector< std::array< float, 24 > > triangles_of(Indexed_Mesh const &mesh) {
+	std::vector< std::array< float, 24 > > triangles;
+	for (size_t i = 0; i < mesh.indices().size(); i += 3) {
+		std::array< float, 24 > triangle;
+		for (uint32_t k = 0; k < 3; ++k) {
+			Indexed_Mesh::Vert const &v = mesh.vertices()[mesh.indices()[i + k]];
+			float data[8] = {v.pos.x, v.pos.y, v.pos.z, v.norm.x, v.norm.y, v.norm.z, v.uv.x, v.uv.y};
+			std::copy(data, data + 8, triangle.begin() + 8 * k);
+		}
+		triangles.emplace_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+/*
+Welding a smooth mesh leaves one vertex per mesh vertex, and the same triangles as splitting
+*/
+Test test_a2_weld_smooth("a2.weld.smooth", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 2));
+	mesh.set_corner_normals(180.0f);
+	mesh.set_corner_uvs_project(Vec3{0.0f, 0.0f, 0.0f}, Vec3{1.0f, 0.0f, 0.0f}, Vec3{0.0f, 1.0f, 0.0f});
+
+	Indexed_Mesh split = Indexed_Mesh::from_halfedge_mesh(mesh, Indexed_Mesh::SplitEdges);
+	Indexed_Mesh welded = Indexed_Mesh::from_halfedge_mesh(mesh, Indexed_Mesh::WeldCorners);
+
+	if (welded.vertices().size() != mesh.vertices.size()) {
+		throw Test::error("Welded mesh has " + std::to_string(welded.vertices().size()) + " vertices, expected " + std::to_string(mesh.vertices.size()) + ".");
+	}
+	if (triangles_of(welded) != triangles_of(split)) {
+		throw Test::error("Welded mesh has different triangles than split mesh.");
+	}
+});
+
+/*
+Corners with different normals are not welded
+*/
+Test test_a2_weld_flat("a2.weld.flat", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+
+	Indexed_Mesh split = Indexed_Mesh::from_halfedge_mesh(mesh, Indexed_Mesh::SplitEdges);
+	Indexed_Mesh welded = Indexed_Mesh::from_halfedge_mesh(mesh, Indexed_Mesh::WeldCorners);
+
+	if (welded.vertices().size() != 24) {
+		throw Test::error("Welded cube has " + std::to_string(welded.vertices().size()) + " vertices, expected 24.");
+	}
+	if (triangles_of(welded) != triangles_of(split)) {
+		throw Test::error("Welded cube has different triangles than split cube.");
+	}
+});
+
+/*
+Distinct vertices that share a position are not welded, and welded vertices carry their mesh vertex's id
+*/
+Test test_a2_weld_coincident("a2.weld.coincident", []() {
+	//two triangles touching along an edge whose vertices are duplicated (not connected):
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_faces({
+		Vec3{0.0f, 0.0f, 0.0f}, Vec3{1.0f, 0.0f, 0.0f}, Vec3{0.0f, 1.0f, 0.0f},
+		Vec3{1.0f, 0.0f, 0.0f}, Vec3{1.0f, 1.0f, 0.0f}, Vec3{0.0f, 1.0f, 0.0f}
+	},{
+		{0, 1, 2}, {3, 4, 5}
+	});
+	mesh.set_corner_normals(180.0f);
+
+	Indexed_Mesh welded = Indexed_Mesh::from_halfedge_mesh(mesh, Indexed_Mesh::WeldCorners);
+	if (welded.vertices().size() != 6) {
+		throw Test::error("Welded mesh has " + std::to_string(welded.vertices().size()) + " vertices, expected 6.");
+	}
+
+	std::vector< uint32_t > expected_ids, ids;
+	for (auto const &v : mesh.vertices) expected_ids.emplace_back(v.id);
+	for (auto const &v : welded.vertices()) ids.emplace_back(v.id);
+	std::sort(expected_ids.begin(), expected_ids.end());
+	std::sort(ids.begin(), ids.end());
+	if (ids != expected_ids) {
+		throw Test::error("Welded vertex ids are not the mesh's vertex ids.");
+	}
+});
@@ -0,0 +1,141 @@
+#include "test.h"
+#include "geometry/util.h"
+#include "scene/skeleton.h"
+
+/*
+A Skinning_Table matches the mesh it was built from, and stops matching once the mesh is edited
+*/
+Test test_a4_skinning_table_matches("a4.skinning_table.matches", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 1));
+	mesh.vertices.front().bone_weights.emplace_back(Halfedge_Mesh::Vertex::Bone_Weight{0, 1.0f});
+
+	Skinning_Table table(mesh);
+	if (!table.matches(mesh)) {
+		throw Test::error("Table doesn't match the mesh it was built from.");
+	}
+
+	Halfedge_Mesh moved = mesh.copy();
+	moved.vertices.back().position += Vec3(0.0f, 0.1f, 0.0f);
+	if (table.matches(moved)) {
+		throw Test::error("Table matches a mesh with a moved vertex.");
+	}
+
+	Halfedge_Mesh reweighted = mesh.copy();
+	reweighted.vertices.front().bone_weights[0].weight = 0.5f;
+	if (table.matches(reweighted)) {
+		throw Test::error("Table matches a mesh with different bone weights.");
+	}
+
+	Halfedge_Mesh rotated = mesh.copy();
+	rotated.faces.front().halfedge = rotated.faces.front().halfedge->next;
+	if (table.matches(rotated)) {
+		throw Test::error("Table matches a mesh whose face starts at a different corner.");
+	}
+});
+
+/*
+Skinning a table in the bind pose gives the same mesh as from_halfedge_mesh, and reuses the output
+*/
+Test test_a4_skinning_table_bind("a4.skinning_table.bind", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::from_indexed_mesh(Util::closed_sphere_mesh(1.0f, 1));
+	Skeleton skeleton;
+	skeleton.add_bone(-1U, Vec3(0.0f, 1.0f, 0.0f));
+	for (auto &v : mesh.vertices) {
+		v.bone_weights.emplace_back(Halfedge_Mesh::Vertex::Bone_Weight{0, 1.0f});
+	}
+
+	Indexed_Mesh expected = Indexed_Mesh::from_halfedge_mesh(mesh, Indexed_Mesh::SplitEdges);
+
+	Skinning_Table table(mesh);
+	Indexed_Mesh posed;
+	for (uint32_t frame = 0; frame < 2; ++frame) {
+		Skeleton::skin(table, skeleton.bind_pose(), skeleton.current_pose(), posed);
+		if (posed.indices() != expected.indices()) {
+			throw Test::error("Skinned triangles differ from from_halfedge_mesh.");
+		}
+		if (posed.vertices().size() != expected.vertices().size()) {
+			throw Test::error("Skinned mesh has the wrong number of vertices.");
+		}
+		for (uint32_t i = 0; i < posed.vertices().size(); ++i) {
+			auto const &a = posed.vertices()[i];
+			auto const &b = expected.vertices()[i];
+			if (Test::differs(a.pos, b.pos) || Test::differs(a.norm, b.norm) || a.uv != b.uv || a.id != b.id) {
+				throw Test::error("Skinned vertex " + std::to_string(i) + " differs from from_halfedge_mesh.");
+			}
+		}
+	}
+});
+
+/*
+The table kernel blends bone transforms by weight and leaves unweighted vertices in place
+*/
+Test test_a4_skinning_table_blend("a4.skinning_table.blend", []() {
+	Halfedge_Mesh mesh = Halfedge_Mesh::cube(1.0f);
+	auto v = mesh.vertices.begin();
+	v->bone_weights = {{0, 1.0f}};
+	++v;
+	v->bone_weights = {{0, 0.5f}, {1, 0.5f}};
+	++v;
+	v->bone_weights.clear();
+
+	std::vector< Mat4 > bind = {Mat4::I, Mat4::translate(Vec3(0.0f, 1.0f, 0.0f))};
+	std::vector< Mat4 > current = {Mat4::translate(Vec3(1.0f, 0.0f, 0.0f)), Mat4::translate(Vec3(3.0f, 1.0f, 0.0f))};
+
+	Skinning_Table table(mesh);
+	Indexed_Mesh posed;
+	Skeleton::skin(table, bind, current, posed);
+
+	Vec3 offsets[3] = {Vec3(1.0f, 0.0f, 0.0f), Vec3(2.0f, 0.0f, 0.0f), Vec3(0.0f, 0.0f, 0.0f)};
+	for (uint32_t c = 0; c < table.corner_vertex.size(); ++c) {
+		uint32_t i = table.corner_vertex[c];
+		if (i >= 3) continue;
+		if (Test::differs(posed.vertices()[c].pos, table.positions[i] + offsets[i])) {
+			throw Test::error("Vertex " + std::to_string(i) + " was not moved by its blended bone transforms.");
+		}
+		if (Test::differs(posed.vertices()[c].norm, table.corner_normals[c])) {
+			throw Test::error("Translating bones should not change normals.");
+		}
+	}
+});
+
+/*
+Skinned_Mesh reuses its table until mesh_changed() is called
+*/
+Test test_a4_skinning_table_mesh_changed("a4.skinning_table.mesh_changed", []() {
+	Skinned_Mesh skinned;
+	skinned.mesh = Halfedge_Mesh::cube(1.0f);
+	Vec3 before = skinned.posed_mesh().vertices()[0].pos;
+
+	//the first corner's vertex is the first face's halfedge's vertex:
+	skinned.mesh.faces.front().halfedge->vertex->position += Vec3(0.0f, 5.0f, 0.0f);
+	if (Test::differs(skinned.posed_mesh().vertices()[0].pos, before)) {
+		throw Test::error("Posed mesh changed without mesh_changed().");
+	}
+
+	skinned.mesh_changed();
+	if (Test::differs(skinned.posed_mesh().vertices()[0].pos, before + Vec3(0.0f, 5.0f, 0.0f))) {
+		throw Test::error("Posed mesh didn't follow the edit after mesh_changed().");
+	}
+});
+
+/*
+Skinned_Mesh::table() hands out the same table until mesh_changed(), so callers can tell when to re-pose
+*/
+Test test_a4_skinning_table_identity("a4.skinning_table.identity", []() {
+	Skinned_Mesh skinned;
+	skinned.mesh = Halfedge_Mesh::cube(1.0f);
+	std::shared_ptr< Skinning_Table const > table = skinned.table();
+	skinned.posed_mesh();
+	if (skinned.table() != table) {
+		throw Test::error("Table was rebuilt without mesh_changed().");
+	}
+	Skinned_Mesh copied = skinned.copy();
+	if (copied.table() != table) {
+		throw Test::error("Copy doesn't share the table.");
+	}
+
+	skinned.mesh_changed();
+	if (skinned.table() == table || !skinned.table()->matches(skinned.mesh)) {
+		throw Test::error("mesh_changed() didn't lead to a new table for the mesh.");
+	}
+});